@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// The part of a frame that made an allocation. The game, render and audio threads mark their phases with an AllocationTracker::Scope.
+/// </summary>
+enum class AllocationPhase : u8
+{
+	Other,
+	Input,
+	Tick,
+	Publish,
+	Render,
+	Audio,
+	Count
+};
+
+/// <summary>
+/// Opt-in heap allocation tracker, for finding allocations in the frame loop.
+/// Building with TETRIS_TRACK_ALLOCATIONS replaces the global operator new and delete, and every allocation is counted against the phase
+/// of the thread that made it and against its call site (the return address of operator new). Counting is lock free, and never allocates itself.
+/// Without TETRIS_TRACK_ALLOCATIONS the scopes still mark phases, but nothing is counted and every count reads as zero.
+/// </summary>
+class AllocationTracker
+{
+public:
+#ifdef TETRIS_TRACK_ALLOCATIONS
+	static constexpr bool enabled = true;
+#else
+	static constexpr bool enabled = false;
+#endif
+
+	struct Counts
+	{
+		u64 allocations = 0;
+		u64 frees = 0;
+		u64 bytes = 0;
+	};
+
+	struct CallSite
+	{
+		const void* address = nullptr;
+		AllocationPhase phase = AllocationPhase::Other; //The phase it was first seen in
+		u64 allocations = 0;
+		u64 bytes = 0;
+	};
+
+	/// <summary>
+	/// Marks the calling thread as being in a phase until the scope ends
+	/// </summary>
+	class Scope
+	{
+	public:
+		Scope(const AllocationPhase);
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		const AllocationPhase m_previous;
+	};
+
+	static void recordAllocation(const std::size_t size, const void* const callSite);
+	static void recordFree();
+
+	static Counts getCounts(const AllocationPhase);
+	static Counts getTotal();
+	static u64 getThreadAllocations();
+	static std::vector<CallSite> getCallSites();
+	static const char* getPhaseName(const AllocationPhase);
+	static void report(std::ostream&, const size_t maxCallSites = 20);
+private:
+	static constexpr size_t phaseCount = static_cast<size_t>(AllocationPhase::Count);
+	static constexpr size_t callSiteBits = 10;
+	static constexpr size_t callSiteSlots = 1 << callSiteBits; //Open addressing on a power of two table
+
+	struct alignas(64) PhaseCounters
+	{
+		std::atomic<u64> allocations{ 0 };
+		std::atomic<u64> frees{ 0 };
+		std::atomic<u64> bytes{ 0 };
+	};
+
+	struct CallSiteSlot
+	{
+		std::atomic<const void*> address{ nullptr };
+		std::atomic<u8> phase{ 0 };
+		std::atomic<u64> allocations{ 0 };
+		std::atomic<u64> bytes{ 0 };
+	};
+
+	static PhaseCounters m_phases[phaseCount];
+	static CallSiteSlot m_callSites[callSiteSlots];
+	static std::atomic<u64> m_droppedCallSites; //Allocations from call sites that didn't fit in the table
+	static thread_local AllocationPhase t_phase;
+	static thread_local u64 t_allocations;
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <random>
+#include <span>
 
 #include "Globals.hpp"
 #include "PieceState.hpp"
@@ -12,7 +13,16 @@ class Blocks
 {
 public:
 	Blocks();
+	Blocks(const u32 seed);
+	void reseed();
+	void reseed(const u32 seed);
+	void restore(const u32 seed, const u64 blocksDrawn);
+	const u32 getSeed() const;
+	const u64 getBlocksDrawn() const;
+	const u8 getBlockTypeCount() const;
 	const PieceState::Piece& getBlock();
+	const PieceState::Piece& getBlock(const u8 type) const;
+	void peek(std::span<u8> types) const;
 private:
 	const std::vector<u8> oBlock = {
 		1, 1,
@@ -50,15 +60,17 @@ private:
 		0, 0, 0, 0
 	};
 	const std::vector<PieceState::Piece> m_blocks = {
-		PieceState::Piece(oBlock, 2),
-		PieceState::Piece(sBlock, 3),
-		PieceState::Piece(zBlock, 3),
-		PieceState::Piece(lBlock, 3),
-		PieceState::Piece(jBlock, 3),
-		PieceState::Piece(tBlock, 3),
-		PieceState::Piece(iBlock, 4)
+		PieceState::Piece(oBlock, 2, 0),
+		PieceState::Piece(sBlock, 3, 1),
+		PieceState::Piece(zBlock, 3, 2),
+		PieceState::Piece(lBlock, 3, 3),
+		PieceState::Piece(jBlock, 3, 4),
+		PieceState::Piece(tBlock, 3, 5),
+		PieceState::Piece(iBlock, 4, 6)
 	};
 
 	std::random_device m_dev;
 	std::mt19937 m_rng;
+	u32 m_seed;
+	u64 m_blocksDrawn;
 };
\ No newline at end of file
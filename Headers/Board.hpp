@@ -2,7 +2,6 @@
 #include <vector>
 
 #include "Globals.hpp"
-#include "Renderer.hpp"
 
 class Board
 {
@@ -11,8 +10,44 @@ public:
 	void resetBoard();
 	u8 getBoardPosition(const s8 x, const u8 y);
 	void setBoardPosition(const u8 x, const u8 y, const u8 value);
-	void renderBoard(Renderer* const, const std::vector<PlayerColor>&);
+	const std::vector<u8>& getBoardData() const;
+	const u8 getBoardHeight() const;
+	const u8 getStackHeight() const;
+	u64 getRowMask(const s8 y) const;
+	u64 getHash() const;
+	u64 computeHash() const;
+	bool isRowEmpty(const u8 y) const;
+	u32 getFullRows(const u8 rows) const;
+	void clearRows(const u32 fullRows);
+	void raiseRows(const u8 rows, const u8 floor, const u8 holeColumn, const u8 value);
+
+	/// <summary>
+	/// Column x of the board is bit (x + rowMaskMargin) of a row mask. The bits left and right of the board are always set,
+	/// so a shifted piece mask that overlaps them is outside the board.
+	/// </summary>
+	static constexpr u8 rowMaskMargin = 8;
 private:
+	/// <summary>
+	/// The operations that loop over every cell of a row. They are instantiated once for each board width the game uses,
+	/// so the cell loops have a trip count the compiler knows and can unroll, and picked by width when the board is made.
+	/// A width of 0 is the fallback for any other width, which reads the width at runtime.
+	/// </summary>
+	struct RowKernels
+	{
+		void (Board::*clearRows)(const u32 fullRows);
+		void (Board::*raiseRows)(const u8 rows, const u8 floor, const u8 holeColumn, const u8 value);
+	};
+	static const RowKernels& selectRowKernels(const u8 width);
+	template <u8 Width> static constexpr RowKernels rowKernelsFor();
+	template <u8 Width> void copyRow(const u8 from, const u8 to);
+	template <u8 Width> void emptyRow(const u8 y);
+	template <u8 Width> void clearRowsOf(const u32 fullRows);
+	template <u8 Width> void raiseRowsOf(const u8 rows, const u8 floor, const u8 holeColumn, const u8 value);
+
 	std::vector<u8> m_board;
+	std::vector<u64> m_rowMasks;
+	u64 m_hash = 0; //The Zobrist hash of every cell, kept up to date by setBoardPosition
 	const u8 m_boardWidth, m_boardHeight;
+	const u64 m_wallMask;
+	const RowKernels& m_rowKernels;
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Globals.hpp"
+#include "PieceState.hpp"
+#include "Board.hpp"
+#include "Blocks.hpp"
+
+/// <summary>
+/// Lets an engine running as a separate process play as one of the players, talking a line based text protocol over its stdin and stdout.
+/// The game never waits on the engine: replies are read without blocking once per tick, and an engine that hasn't answered a turn by its
+/// deadline forfeits it, leaving the piece to fall on its own. Only what changed since the last turn is sent.
+///
+/// The game sends:
+///     rules {width} {height} {player} {players}     once per game, followed by a shape line for every piece type and then start
+///     shape {type} {size} {cells}                  the piece in rotation 0, size*size cells of 0 or 1, row by row. Rotation r is turned clockwise r times
+///     start
+///     row {y} {cells}                              a board row that changed since the last turn, . for an empty cell, anything else is filled
+///     piece {type} {rotation} {x} {y}              the piece to place, and the board position of the top left of its shape
+///     next {type}, hold {type or -}, canhold {0 or 1}     sent when they change
+///     go {turn} {deadline in ms}                    answer this turn before the deadline
+///     quit
+///
+/// The engine answers with one of:
+///     ready {name}                                 optional, once it has started
+///     place {turn} {rotation} {x} [hold]           hold first if asked, turn to the rotation, move to column x and hard drop
+///     keys {turn} {keys}                           a sequence of L R D (soft drop) C A F (clockwise, anticlockwise, 180) H (hold) X (hard drop)
+///     info {text}                                  printed to the console
+///
+/// Only available where processes can be started with POSIX pipes, elsewhere the engine is never started and the player stays idle.
+/// </summary>
+class BotPlayer
+{
+public:
+	static constexpr std::chrono::milliseconds defaultDeadline{ 200 };
+
+	BotPlayer(const std::string& command, const u8 playerIndex, const std::chrono::milliseconds deadline = defaultDeadline);
+	~BotPlayer();
+	const bool isRunning() const;
+	const bool isThinking() const;
+	const u32 getMissedDeadlines() const;
+
+	void startGame(const u8 numPlayers, const u8 boardWidth, const u8 boardHeight, const Blocks&);
+	void beginTurn(const Board&, const PieceState::State&);
+	const Move nextMove(const PieceState::State&);
+	void waitForReply();
+private:
+	static constexpr u8 maxKeys = 64;
+	static constexpr size_t maxReplyLength = 4096; //No valid reply line is anywhere near this long
+	static constexpr size_t maxReadPerCall = 4096; //How much of the engine's output is read per tick at most
+
+	/// <summary>
+	/// A placement being worked towards a move per tick
+	/// </summary>
+	struct Placement
+	{
+		bool active = false;
+		bool hold = false;
+		u8 rotation = 0;
+		s8 x = 0;
+		s8 lastX = 0;
+		u8 rotationTries = 0;
+		bool moved = false;
+	};
+
+	void launch();
+	void readReplies();
+	void handleLines();
+	void handleReply(std::string_view line);
+	void queueKeys(std::string_view keys);
+	void send();
+	void appendNumber(const s32);
+	void stop(const char* const reason);
+
+	std::string m_command;
+	const u8 m_playerIndex;
+	const std::chrono::milliseconds m_deadline;
+	int m_processId = -1;
+	int m_toBot = -1, m_fromBot = -1;
+
+	std::string m_message; //Composed here and written in one go, reserved up front so turns don't allocate
+	std::string m_replies; //Read but not yet complete lines
+	std::string m_name;
+
+	u8 m_boardWidth = 0, m_boardHeight = 0;
+	std::vector<u8> m_sentBoard; //The board as the engine knows it, so only changed rows are sent
+	s16 m_sentNext = -1, m_sentHeld = -1, m_sentCanHold = -1;
+
+	u32 m_turn = 0;
+	bool m_thinking = false;
+	std::chrono::steady_clock::time_point m_turnStart;
+	u32 m_missedDeadlines = 0;
+
+	Placement m_placement;
+	std::array<Move, maxKeys> m_keys{};
+	u8 m_keyCount = 0, m_nextKey = 0;
+};
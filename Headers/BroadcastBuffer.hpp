@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <atomic>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// A lock-free buffer for handing data from exactly one writer thread to several reader threads, like a TripleBuffer with more readers.
+/// The writer fills writeBuffer() and calls publish(), and each reader calls read() with its own index to get the most recently published buffer.
+/// Nobody ever blocks: a reader marks the buffer it is reading as in use, and the writer only ever fills a buffer that is neither in use nor
+/// the newest, so with two more buffers than readers there is always one free. A slow reader only keeps its own buffer, never holds up the others.
+/// </summary>
+template <typename T, u8 Readers>
+class BroadcastBuffer
+{
+public:
+	static constexpr u8 readers = Readers;
+
+	/// <summary>
+	/// The buffer the writer is allowed to fill. Its previous contents are stale and must be fully overwritten.
+	/// </summary>
+	T& writeBuffer()
+	{
+		return m_buffers[m_writeIndex];
+	}
+
+	/// <summary>
+	/// Makes the filled write buffer the newest for every reader, then picks a buffer no reader is using to fill next
+	/// </summary>
+	void publish()
+	{
+		m_newest.store(m_writeIndex);
+		m_writeIndex = findFreeBuffer();
+	}
+
+	/// <summary>
+	/// Takes the newest published buffer. It stays valid, and unchanged, until the same reader calls read again.
+	/// </summary>
+	/// <param name="reader">The calling reader's index, below Readers. Every reader thread must use its own</param>
+	const T& read(const u8 reader)
+	{
+		std::atomic<u8>& inUse = m_inUse[reader];
+		u8 newest = m_newest.load();
+		//Marks the buffer as in use before reading it, then checks it is still the newest, so the writer either saw the mark or never picks it
+		while (newest != inUse.load(std::memory_order_relaxed))
+		{
+			inUse.store(newest);
+			newest = m_newest.load();
+		}
+		return m_buffers[newest];
+	}
+
+private:
+	static constexpr u8 bufferCount = Readers + 2;
+
+	/// <summary>
+	/// Finds a buffer that is neither the newest nor being read. Only called by the writer.
+	/// </summary>
+	u8 findFreeBuffer() const
+	{
+		std::array<bool, bufferCount> taken{};
+		taken[m_newest.load(std::memory_order_relaxed)] = true;
+		for (const std::atomic<u8>& inUse : m_inUse)
+		{
+			taken[inUse.load()] = true;
+		}
+		u8 buffer = 0;
+		while (taken[buffer]) ++buffer;
+		return buffer;
+	}
+
+	std::array<T, bufferCount> m_buffers{};
+	std::atomic<u8> m_newest = 0;
+	std::array<std::atomic<u8>, Readers> m_inUse{}; //Every reader starts on buffer 0, the newest until the first publish
+	u8 m_writeIndex = 1;
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <barrier>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Game.hpp"
+#include "TetrisEnv.h"
+
+/// <summary>
+/// A batch of headless games for training agents, behind the C API in TetrisEnv.h. Every environment is a full Game with its own board
+/// and block generator, driven a tick at a time with queued moves like a replay, so it plays by exactly the game's rules.
+///
+/// Steps are split into contiguous ranges of environments, one per thread. The calling thread steps the first range and the workers
+/// the rest, waiting on a pair of barriers between steps the way VersusGame's workers wait between ticks. The barriers also order
+/// every access to the games and the caller's buffers between the threads.
+/// </summary>
+class EnvironmentBatch
+{
+public:
+	EnvironmentBatch(const TetrisEnvConfig&);
+	~EnvironmentBatch();
+	void reset(const u32 seed, const TetrisEnvBuffers&);
+	void resetOne(const u32 index, const u32 seed, const TetrisEnvBuffers&);
+	void step(const u8* const actions, const TetrisEnvBuffers&);
+
+	const u32 getCount() const;
+	const u8 getPlayers() const;
+	const u8 getBoardWidth() const;
+	const u8 getBoardHeight() const;
+
+	static bool isValid(const TetrisEnvConfig&);
+
+	static constexpr u8 gameHeight = 20, boardHeight = 22; //The same board sizes as the main menu
+private:
+	/// <summary>
+	/// One game and everything it plays on
+	/// </summary>
+	struct Environment
+	{
+		std::unique_ptr<Board> board;
+		std::unique_ptr<Blocks> blocks;
+		std::unique_ptr<Game> game;
+		u32 firstSeed = 0;
+		u32 episode = 0;
+	};
+
+	enum class Job : u8 { Reset, Step, Stop };
+
+	void run(const Job);
+	void runRange(const u32 thread);
+	void worker(const u32 thread);
+	void resetEnvironment(const u32 index, const u32 seed);
+	void stepEnvironment(const u32 index);
+	void writeObservation(const u32 index, const float reward);
+
+	const u32 m_count;
+	const u8 m_players;
+	const u8 m_boardWidth;
+	const u16 m_ticksPerStep;
+	const bool m_autoReset;
+	PieceState m_pieceState;
+	std::vector<Environment> m_environments;
+
+	//The job the threads run next, set by the calling thread before it releases the workers
+	Job m_job = Job::Step;
+	u32 m_seed = 0;
+	const u8* m_actions = nullptr;
+	TetrisEnvBuffers m_buffers{};
+
+	const u32 m_threadCount;
+	std::barrier<> m_jobStart;
+	std::barrier<> m_jobDone;
+	std::vector<std::thread> m_workers;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "Globals.hpp"
+#include "SpscQueue.hpp"
+
+/// <summary>
+/// Something that happened in the game, as published to the event bus
+/// </summary>
+struct GameEvent
+{
+	enum class Type : u8 { NewGame, Spawn, Move, Rotate, Lock, LineClear, LevelUp, Hold, GameOver };
+
+	Type type;
+	u8 player = 0;
+	u8 piece = 0; //The type of the player's piece, for the events about a piece
+	u8 rotation = 0;
+	s8 x = 0; //Where the player's piece is, for the events about a piece
+	u8 y = 0;
+	u8 value = 0; //How many lines were cleared at once for LineClear, the new level for LevelUp, and the number of players for NewGame
+	u32 tick = 0;
+};
+
+/// <summary>
+/// Fans the game's events out to the subsystems that react to them: audio, telemetry, recording and so on.
+/// Every subscriber gets its own single-producer/single-consumer queue, which it drains on its own thread whenever it likes.
+/// The game thread is the only producer, and publishing never blocks or allocates: a subscriber that falls behind
+/// loses the events that don't fit in its queue rather than slowing the tick down.
+/// Subscribers must all subscribe before the game starts publishing.
+/// </summary>
+class EventBus
+{
+public:
+	static constexpr u32 queueCapacity = 1024; //Several seconds of events at the fastest anyone can play
+	static constexpr u8 maxSubscribers = 8;
+	using Queue = SpscQueue<GameEvent, queueCapacity>;
+
+	Queue* subscribe();
+	void publish(const GameEvent&);
+	const u64 getDroppedEvents() const;
+private:
+	std::array<std::unique_ptr<Queue>, maxSubscribers> m_queues;
+	u8 m_subscriberCount = 0;
+	std::atomic<u64> m_droppedEvents = 0;
+};
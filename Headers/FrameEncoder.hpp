@@ -0,0 +1,63 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// Encodes rendered RGBA frames on a pool of worker threads, so encoding overlaps with simulating and rasterizing the next frames.
+/// Frames are written in the order they were submitted:
+///     Png - one PNG file per frame in the output directory (frame-000000.png, frame-000001.png, ...)
+///     Y4m - a single YUV4MPEG2 video (4:2:0, full range), which ffmpeg and most players read directly
+///     Raw - a single file of raw RGBA frames, back to back
+/// At most a few frames per worker are in flight at once. submit blocks until one of them has been written.
+/// </summary>
+class FrameEncoder
+{
+public:
+	enum class Format : u8 { Png, Y4m, Raw };
+
+	FrameEncoder(const std::filesystem::path& output, const Format, const u16 width, const u16 height, const u32 frameRateNumerator, const u32 frameRateDenominator, const u8 threads);
+	~FrameEncoder();
+	const bool isOpen() const;
+	void submit(const std::vector<u8>& pixels);
+	bool finish();
+	const u32 getFramesWritten() const;
+
+	static std::vector<u8> encodePng(const u8* pixels, const u16 width, const u16 height);
+	static bool savePng(const std::filesystem::path&, const u8* pixels, const u16 width, const u16 height);
+private:
+	struct Frame
+	{
+		u32 index;
+		std::vector<u8> pixels;
+	};
+
+	void worker();
+	void encodeY4m(const u8* pixels, std::vector<u8>& encoded) const;
+
+	const std::filesystem::path m_output;
+	const Format m_format;
+	const u16 m_width, m_height;
+	std::ofstream m_file;
+	bool m_open = false;
+	bool m_failed = false;
+
+	std::mutex m_mutex;
+	std::condition_variable m_workAvailable;
+	std::condition_variable m_spaceAvailable;
+	std::deque<Frame> m_queue;
+	std::map<u32, std::vector<u8>> m_encoded; //Encoded frames waiting for an earlier frame to be written first
+	std::vector<std::vector<u8>> m_freeBuffers;
+	u32 m_submitted = 0;
+	u32 m_written = 0;
+	const u32 m_maxInFlight;
+	bool m_stopping = false;
+	std::vector<std::thread> m_workers;
+};
@@ -1,6 +1,8 @@
 #pragma once
 #include <vector>
 #include <array>
+#include <atomic>
+#include <thread>
 
 #include "Globals.hpp"
 #include "PieceState.hpp"
@@ -9,6 +11,21 @@
 #include "MusicController.hpp"
 #include "InputController.hpp"
 #include "Board.hpp"
+#include "RotationSystem.hpp"
+#include "Gravity.hpp"
+#include "AllocationTracker.hpp"
+#include "Tracer.hpp"
+#include "GameSnapshot.hpp"
+#include "ParticleSystem.hpp"
+#include "BroadcastBuffer.hpp"
+#include "SpectatorFeed.hpp"
+#include "Replay.hpp"
+#include "SaveGame.hpp"
+#include "Leaderboard.hpp"
+#include "Telemetry.hpp"
+#include "BotPlayer.hpp"
+#include "EventBus.hpp"
+#include "PerfectClearSolver.hpp"
 
 using State = PieceState::State;
 using Piece = PieceState::Piece;
@@ -21,40 +38,117 @@ class Game
 {
 public:
 	Game(const u8 numPlayers, const u8 gameWidth, const u8 gameHeight, const u16 boardXOffset, const u16 boardYOffset, const u16 windowWidth, const u16 windowHeight,
-		 Renderer* const, Board* const, InputController* const, MusicController* const, PieceState* const, Blocks* const);
+		 Renderer* const, Board* const, InputController* const, MusicController* const, PieceState* const, Blocks* const, const bool interpolatePieces = true);
+	~Game();
+	void run();
+	void restart(const u32 seed);
+	void setSpectatorFeed(SpectatorFeed* const);
+	void setSaveGame(SaveGame* const);
+	void setLeaderboard(Leaderboard* const);
+	void setTelemetry(Telemetry* const);
+	void setEventBus(EventBus* const);
+	void setGravity(const Gravity&);
+	void setBot(const u8 playerIndex, BotPlayer* const);
+	void setPerfectClearSolver(PerfectClearSolver* const);
+	void addView(Renderer* const, const u8 followedPlayer = allPlayers);
+	bool loadGame(const SaveGame&);
+
+	//Used to drive the game without a window, e.g. when replaying recorded games
+	void queueMove(const PlayerMove);
+	void tick();
+	const bool isGameOver() const;
+	const u32 getTick() const;
+	const u32 getLines() const;
+	const u8 getLevel() const;
+	const State& getPlayerState(const u8 playerIndex) const;
+	const u64 getStateHash() const;
+	const bool isStateHashValid() const;
+	const Replay& getReplay() const;
+	void renderFrame();
+
+	//Used by versus mode, which runs one game per player
+	static PlayerColor getPlayerColor(const u8 colorIndex);
+	void setPlayerColor(const u8 playerIndex, const PlayerColor&);
+	void addGarbage(u8 rows, const u8 holeColumn);
+	void publishSnapshot();
+	void drawLatestSnapshot();
+
+	static constexpr u8 maxViews = maxPlayers + 2; //The main window, a window per player and a spectator window
+	static constexpr u8 allPlayers = 0xFF; //A view that follows every player, like the main window
 private: //Private functions - Only the game class should be calling these
+	/// <summary>
+	/// Where a session is. A finished game waits on its game over screen until it is restarted in place, or closed.
+	/// </summary>
+	enum class SessionState : u8 { Playing, GameOver, Closed };
+
+	/// <summary>
+	/// A window the game is drawn to by its own render thread, reading the same published snapshots as every other view.
+	/// Everything in it besides the renderer's window is only touched by that thread while the game is running.
+	/// </summary>
+	struct View
+	{
+		View(Renderer* const renderer, const u8 followedPlayer) : renderer(renderer), followedPlayer(followedPlayer) {}
+
+		Renderer* const renderer;
+		const u8 followedPlayer; //The player whose previews and ghost piece are shown, or allPlayers
+		std::thread thread;
+		ParticleSystem particles;
+		u32 effectsPlayed = 0;
+		float particleTime = 0.0f;
+		u64 allocationsAtFrameStart = 0; //For the debug allocation counter
+		u64 frameAllocations = 0;
+	};
+
 	void loop();
+	void endGame();
+	const u64 hashState(const bool fromScratch) const;
+	std::string saveReplay();
+	void submitScore(const std::string& replay);
+	void saveGame();
 
 	void newPiece(const u8 playerIndex);
 
 	void updateLevel();
-	void setTimeNextDrop(const u8 playerIndex);
+	bool applyGravity(const u8 playerIndex);
+	void resetLockDelay(const u8 playerIndex);
 	void updateBoard(const u8 playerIndex);
-	bool isFullRow(const u8 y);
-	void clearLines();
+	void commitLocks();
+	void clearLines(const u8 playerIndex);
+	void addEffect(const EffectEvent&);
+	void publishEvent(const GameEvent::Type, const u8 playerIndex = 0, const u8 value = 0);
+	void updateBots();
+	void updateHints();
 
 	bool hasCollided(const u8 playerIndex);
-	void movePlayerPieces(const u8 playerIndex);
+	void movePlayerPieces();
 	bool hasLost();
 
 	bool validRotateStatus(const std::unique_ptr<State>&, const u8 nextRotation, const s8 xMovement = 0, const s8 yMovement = 0);
-	void tryRotate(const u8 playerIndex);
-	void rotatePiece(const u8 playerIndex, const u8 x, const u8 y);
+	bool tryRotate(const u8 playerIndex, const RotationDirection);
+	void rotatePiece(const u8 playerIndex, const u8 rotation, const s8 x, const s8 y);
 
 	bool isValidMove(const Move move, const u8 playerIndex);
 	void input();
+	void applyMove(const PlayerMove move);
 	void dropPiece(const u8 playerIndex);
+	void softDrop(const u8 playerIndex);
 	const u8 getBottom(const u8 playerIndex);
 	void holdPiece(const u8 playerIndex);
 	const u8 getPlayerStartingXOffset(const u8 playerIndex, const u8 pieceWidth);
 
 
-	void renderGame();
-	void renderText();
-	void restart();
+	void startRenderThreads();
+	void renderLoop(const u8 viewIndex);
+	void stopRenderThreads();
+	void renderGame(View&, const GameSnapshot&);
+	void drawGame(View&, const GameSnapshot&);
+	void renderText(View&, const GameSnapshot&);
+	void drawEffects(View&, const GameSnapshot&);
 
 private: //Private variables
 	bool m_quit = false;
+	SessionState m_session = SessionState::Playing;
+	sf::Time m_accumulator = sf::Time::Zero;
 	const u8 m_numPlayers;
 
 	static constexpr u8 linesToNextLevel = 10;
@@ -63,13 +157,11 @@ private: //Private variables
 	u8 m_clearedLines = 0;
 	u8 m_yClearLevel = 0;
 
+	static constexpr u8 maxLevel = 255;
 	static constexpr double m_framesPerSecond = 60.0;
-	const std::array<u8, 30> m_framesPerDrop = { //From the tetris wiki
-		48, 43, 38, 33, 28, 23, 18, 13, 8, 6,
-		5, 5, 5, 4, 4, 4, 3, 3, 3, 2, 2, 2, 2,
-		2, 2, 2, 2, 2, 2, 1
-	};
-	double m_timeToNextDrop;
+	Gravity m_gravity;
+	const sf::Time m_timePerTick = sf::microseconds(static_cast<sf::Int64>(1000000 / m_framesPerSecond));
+	u32 m_tick = 0;
 
 	Renderer* const m_renderer;
 	MusicController* const m_musicController;
@@ -77,11 +169,37 @@ private: //Private variables
 	Board* const m_board;
 	PieceState* const m_pieceState;
 	Blocks* const m_blockGenerator;
+	const RotationSystem m_rotationSystem;
+	SpectatorFeed* m_spectatorFeed = nullptr;
 
 	std::vector<std::unique_ptr<State>> m_playerStates;
 
-	std::vector<sf::Time> m_playerTimes;
+	std::vector<Gravity::Fall> m_playerFalls;
+	std::vector<PlayerMove> m_pendingMoves;
+	std::array<BotPlayer*, maxPlayers> m_bots{};
+	std::array<bool, maxPlayers> m_locking{}; //Set for the players whose piece came to rest this tick, until they are locked
+	std::array<bool, maxPlayers> m_botTurns{}; //Set when a bot's player gets a new piece to place
+	PerfectClearSolver* m_solver = nullptr;
+	u32 m_solverRequest = 0; //The request whose solution is shown as hints
+	bool m_hintsStale = false; //Set when the player's pieces change, so the solver is asked again
+	Replay m_replay;
+	SaveGame* m_saveGame = nullptr;
+	std::vector<u8> m_saveBuffer;
+	bool m_resumed = false;
+	Leaderboard* m_leaderboard = nullptr;
+	u64 m_leaderboardTicket = 0;
+	Leaderboard::Result m_leaderboardResult;
+	Telemetry* m_telemetry = nullptr;
+	EventBus* m_eventBus = nullptr;
 	sf::Clock m_clock;
+	const sf::Clock m_gameClock; //Never restarted, so the game and render threads all read the same timeline
+
+	BroadcastBuffer<GameSnapshot, maxViews> m_snapshots; //Read by every view's render thread, each with the view's index
+	std::vector<std::unique_ptr<View>> m_views; //The first draws to the renderer the game was made with, if it was given one
+	std::atomic<bool> m_rendering = false;
+	const bool m_interpolatePieces;
+	std::array<EffectEvent, GameSnapshot::effectHistory> m_effects{};
+	u32 m_effectCount = 0;
 
 	std::vector<PlayerColor> m_playerColors;
 
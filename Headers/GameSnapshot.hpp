@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <SFML/System/Time.hpp>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// Everything the renderer needs to know about one player for a single simulation tick.
+/// Pieces are stored by their type so the snapshot never owns or points at simulation memory.
+/// </summary>
+struct PlayerSnapshot
+{
+	static constexpr u8 noPiece = 0xFF;
+
+	u8 piece = noPiece;
+	u8 nextPiece = noPiece;
+	u8 heldPiece = noPiece;
+
+	u8 rotation = 0;
+	s8 xOffset = 0;
+	u8 yOffset = 0;
+	u8 ghostOffset = 0;
+	s8 nextXOffset = 0;
+	s8 heldXOffset = 0;
+
+	float dropProgress = 0.0f; //How far (0 to 1) the piece is through its current drop interval
+};
+
+/// <summary>
+/// A placement suggested by the perfect clear solver, drawn as a ghost piece
+/// </summary>
+struct HintSnapshot
+{
+	u8 piece = 0;
+	u8 rotation = 0;
+	s8 xOffset = 0;
+	u8 yOffset = 0;
+};
+
+/// <summary>
+/// Something that happened in the simulation that the renderer plays an effect for. Effects are only ever drawn, so they never change how a game plays out.
+/// </summary>
+struct EffectEvent
+{
+	enum class Type : u8 { LineClear, HardDrop, LevelUp };
+
+	Type type = Type::LineClear;
+	u8 player = 0; //Whose color the effect is drawn in
+	s8 x = 0; //The leftmost column of a hard dropped piece
+	u8 y = 0; //The cleared row, or the lowest row of a hard dropped piece
+	u8 width = 0; //How many columns a hard dropped piece covers
+};
+
+/// <summary>
+/// An immutable copy of the game state, published by the simulation once per tick and read by the render threads
+/// </summary>
+struct GameSnapshot
+{
+	std::array<u8, maxBoardWidth * maxBoardHeight> board{};
+	std::array<PlayerSnapshot, maxPlayers> players{};
+
+	u8 numPlayers = 0;
+	u8 boardWidth = 0;
+	u8 level = 0;
+	u32 lines = 0;
+	u32 tick = 0;
+	u64 stateHash = 0; //Game::getStateHash, for comparing the game against another run of it
+	bool gameOver = false;
+	u32 rank = 0; //The finished game's leaderboard rank, 0 until it has been ranked
+	u32 rankedGames = 0;
+
+	static constexpr u8 effectHistory = 32; //More than a tick can queue, so a frame that falls a tick or two behind doesn't miss any
+	std::array<EffectEvent, effectHistory> effects{}; //The newest effects. Effect n is stored at n % effectHistory
+	u32 effectCount = 0; //How many effects the game has queued in total
+
+	static constexpr u8 maxHints = 16;
+	std::array<HintSnapshot, maxHints> hints{}; //The placements of the current perfect clear solution, up to its first line clear
+	u8 hintCount = 0;
+
+	sf::Time publishTime;
+	sf::Time dropInterval;
+};
@@ -6,13 +6,17 @@
 using u8 = std::uint8_t;
 using u16 = std::uint16_t;
 using u32 = std::uint32_t;
+using u64 = std::uint64_t;
 using s8 = std::int8_t;
+using s16 = std::int16_t;
+using s32 = std::int32_t;
+using s64 = std::int64_t;
 
 /**
 * This header defines global variables used by multiple/all other classes.
 * Also defines the typedefs above.
 */
-enum Move { Right = 0, Left = 1, Down = 2, Rotate = 3, HardDrop = 4, HoldPiece = 5, PlayAgain = 6, None };
+enum Move { Right = 0, Left = 1, Down = 2, Rotate = 3, HardDrop = 4, HoldPiece = 5, RotateCounterClockwise = 6, Rotate180 = 7, PlayAgain = 8, Quit = 9, SaveTrace = 10, ReturnToMenu = 11, None };
 enum class PieceToDraw { NormalPiece, GhostPiece, HeldPiece, NextPiece };
 
 
@@ -26,6 +30,7 @@ static const sf::Color RedPlayerGhostFill = sf::Color(150, 0, 0, 100);
 static const sf::Color BluePlayerGhostFill = sf::Color(0, 0, 150, 100);
 static const sf::Color YellowPlayerGhostFill = sf::Color(150, 150, 0, 100);
 static const sf::Color MagentaPlayerGhostFill = sf::Color(100, 0, 50, 100);
+static const sf::Color GarbageFill = sf::Color(120, 120, 120);
 
 struct PlayerColor
 {
@@ -34,4 +39,12 @@ struct PlayerColor
 };
 
 static constexpr u8 sideBuffer = 8;
-static constexpr s8 verticalBuffer = 6;
\ No newline at end of file
+static constexpr s8 verticalBuffer = 6;
+
+static constexpr u8 maxPlayers = 4;
+static constexpr u8 baseBoardWidth = 10;
+static constexpr u8 maxBoardWidth = 20;
+static constexpr u8 maxBoardHeight = 22;
+//Co-op boards are 3.4 columns wider for every player after the first, giving 10, 13, 16 and 20 columns
+constexpr u8 coopBoardWidth(const u8 numPlayers) { return static_cast<u8>(baseBoardWidth + (numPlayers - 1) * 3.4); }
+static constexpr u8 garbageCell = maxPlayers + 1; //Board value of garbage rows sent by an opponent in versus mode
\ No newline at end of file
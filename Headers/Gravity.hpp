@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// The gravity and lock delay settings of a game.
+/// Gravity is fixed point: how far a piece falls every tick, in 1/65536ths of a cell. One cell per tick is 1G, and 20G drops a piece
+/// to the bottom of the board on the tick it spawns. The speed curve gives the gravity of every level, and its last entry carries
+/// on for every level after it, so levels never run out.
+/// Everything is integer arithmetic on ticks, so a game with the same settings, seed and moves plays out the same way everywhere.
+/// </summary>
+class Gravity
+{
+public:
+	static constexpr u32 oneCell = 1 << 16;
+	static constexpr u32 twentyG = 20 * oneCell;
+	static constexpr u16 defaultLockDelay = 30; //Ticks, half a second
+	static constexpr u8 defaultMaxLockResets = 15;
+
+	/// <summary>
+	/// How far a player's piece has fallen, and how long it has been resting on something
+	/// </summary>
+	struct Fall
+	{
+		u32 progress = 0; //Fraction of the next cell, in 1/65536ths
+		u16 lockTicks = 0; //Ticks spent resting since the last reset
+		u8 lockResets = 0; //How many times moving or rotating has restarted the lock delay for this piece
+		u8 lowestRow = 0; //The lowest row the piece has reached. Only reaching a new lowest row restarts the lock delay by falling
+		bool forceLock = false; //Set by hard drops and soft drops onto the stack, so the piece locks on the next tick without waiting
+	};
+
+	Gravity();
+	Gravity(const std::vector<u32>& curve, const u16 lockDelay, const u8 maxLockResets);
+	static std::vector<u32> classicCurve();
+	static std::vector<u32> standardCurve();
+
+	const u32 getCellsPerTick(const u32 level) const;
+	const std::vector<u32>& getCurve() const;
+	const u16 getLockDelay() const;
+	const u8 getMaxLockResets() const;
+private:
+	std::vector<u32> m_curve;
+	u16 m_lockDelay;
+	u8 m_maxLockResets;
+};
@@ -1,6 +1,7 @@
 #pragma once
 #include <SFML/Window.hpp>
 #include <fstream>
+#include <vector>
 
 #include "Globals.hpp"
 
@@ -12,6 +13,7 @@ class InputController
 public:
 	InputController(sf::Window* const);
 	PlayerMove input(const bool = false);
+	void setDisplayWindows(const std::vector<sf::Window*>&);
 private:
 	struct PlayerKeyboardControls
 	{
@@ -30,6 +32,9 @@ private:
 	std::vector<PlayerKeyboardControls> m_playerKeyboardControls;
 	std::vector<PlayerJoystickControls> m_playerJoystickControls;
 
+	bool pollEvent();
+
 	sf::Event m_event;
 	sf::Window* m_window;
+	std::vector<sf::Window*> m_displayWindows; //Polled after the main window, see setDisplayWindows
 };
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// A persistent high-score table of every finished game.
+/// Games are appended to a log file, which is the source of truth. A sorted index of every game is kept in memory and on disk so
+/// top-K lists and rank queries are a binary search instead of a scan. If the index file is missing, stale or damaged (e.g. after a crash)
+/// it is rebuilt from the log, and any half-written record at the end of the log is dropped.
+/// All disk work happens on a background thread so finishing a game never waits on it.
+/// Scores are only compared between games with the same number of players: more lines is better, and a shorter game breaks ties.
+/// </summary>
+class Leaderboard
+{
+public:
+	struct Record
+	{
+		u32 magic;
+		u32 lines;
+		u32 durationTicks;
+		u8 numPlayers;
+		u8 gameWidth;
+		u8 level;
+		u8 reserved;
+		s64 finishedAt; //Unix time
+		char replay[48]; //File name of the game's replay, empty if it has none
+		u32 reserved2;
+		u32 checksum;
+	};
+
+	/// <summary>
+	/// Where a submitted game placed among all games with the same number of players
+	/// </summary>
+	struct Result
+	{
+		u32 rank = 0;
+		u32 rankedGames = 0;
+		u32 bestLines = 0;
+	};
+
+	Leaderboard(const std::filesystem::path& directory);
+	~Leaderboard();
+
+	u64 submit(const u8 numPlayers, const u8 gameWidth, const u32 lines, const u8 level, const u32 durationTicks, const std::string& replay);
+	bool getResult(const u64 ticket, Result& result);
+	std::vector<Record> getTopGames(const u8 numPlayers, const u32 count);
+	u32 getRank(const u8 numPlayers, const u32 lines, const u32 durationTicks);
+private:
+	struct IndexEntry
+	{
+		u8 numPlayers;
+		u8 reserved[3];
+		u32 lines;
+		u32 durationTicks;
+		u32 recordIndex;
+	};
+	struct IndexHeader
+	{
+		u32 magic;
+		u16 version;
+		u16 reserved;
+		u32 recordCount;
+		u32 checksum;
+	};
+
+	void worker();
+	void recover();
+	void appendRecord(Record& record);
+	void insertEntry(const IndexEntry& entry);
+	void saveIndex();
+	bool readRecord(const u32 recordIndex, Record& record);
+
+	static bool isBetter(const IndexEntry& a, const IndexEntry& b);
+	static u32 checksum(const u8* data, const size_t size);
+	static IndexEntry toIndexEntry(const Record& record, const u32 recordIndex);
+
+	const std::filesystem::path m_logPath, m_indexPath;
+	std::ofstream m_log;
+	u32 m_recordCount = 0;
+	std::vector<IndexEntry> m_index;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	std::deque<std::pair<u64, Record>> m_pending;
+	u64 m_nextTicket = 1;
+	u64 m_finishedTicket = 0;
+	Result m_lastResult;
+	bool m_stopping = false;
+	std::thread m_worker;
+};
@@ -0,0 +1,128 @@
+#pragma once
+#include <array>
+#include <span>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Blocks.hpp"
+#include "PieceState.hpp"
+#include "RotationSystem.hpp"
+
+/// <summary>
+/// Plays many independent single player games at once, one piece placement per game per step, for evaluating bots and sweeping their
+/// parameters without the game loop. The games are kept in lanes, structure-of-arrays style: row y of every lane's board is stored
+/// side by side as row bitmasks, so dropping the pieces, locking them and finding the full rows is the same few bitwise operations
+/// for every lane, done with AVX2 or SSE2 registers when the build targets them and with plain loops elsewhere.
+///
+/// The rules are the game's: a piece drops until it would collide (Game::hasCollided), full rows are cleared and the rows above drop
+/// down (Game::clearLines), the level goes up every linesToNextLevel lines (Game::updateLevel) and a game is lost when a block is left
+/// in the top row (Game::hasLost). The pieces come from a Blocks generator per lane, so a lane plays the same pieces as the game does
+/// from the same seed, and holding works as Game::holdPiece does.
+/// A placement is a rotation and a column the piece is hard dropped from, like a bot's place reply. It is assumed to be reachable
+/// if the piece fits there in the top row; a placement that doesn't fit there ends the lane's game.
+/// </summary>
+class LockstepSimulator
+{
+public:
+	static constexpr u8 lanes = 16;
+	static constexpr u8 maxHeight = 28;
+	static constexpr u8 maxWidth = 20;
+	static constexpr u8 linesToNextLevel = 10;
+	static constexpr u8 maxLevel = 255;
+	static constexpr u8 noPiece = 0xFF;
+
+	/// <summary>
+	/// Column x of a board is bit (x + rowMaskMargin) of a row mask. The bits left and right of the board are always set.
+	/// </summary>
+	static constexpr u8 rowMaskMargin = 4;
+	static constexpr s8 minColumn = -static_cast<s8>(rowMaskMargin);
+
+	using LaneValues = std::array<u32, lanes>;
+
+	/// <summary>
+	/// Every lane's board. Row y of lane l is rows[y][l], row 0 is the top. The rows below the board are completely filled.
+	/// </summary>
+	struct alignas(64) Boards
+	{
+		std::array<LaneValues, maxHeight + 4> rows{};
+	};
+
+	/// <summary>
+	/// Where to place a lane's piece: the rotation and the board column of the left of the piece's data, as in PieceState::State
+	/// </summary>
+	struct Action
+	{
+		u8 rotation = 0;
+		s8 x = 0;
+		bool hold = false; //Hold first, then place the piece that comes out
+	};
+	using Actions = std::array<Action, lanes>;
+
+	/// <summary>
+	/// The boards after a placement was tried in every lane, without playing it
+	/// </summary>
+	struct Trial
+	{
+		Boards boards;
+		LaneValues linesCleared{};
+		u32 placed = 0; //Bit l is set if the placement fit in lane l
+	};
+
+	/// <summary>
+	/// What a heuristic bot usually scores a board by, for every lane
+	/// </summary>
+	struct Features
+	{
+		LaneValues aggregateHeight{}; //The heights of every column, added up
+		LaneValues holes{}; //Empty cells with a block somewhere above them
+		LaneValues bumpiness{}; //The differences between the heights of neighbouring columns, added up
+	};
+
+	/// <summary>
+	/// A lane's game
+	/// </summary>
+	struct Lane
+	{
+		u32 seed = 0;
+		bool playing = false;
+		u8 piece = noPiece;
+		u8 nextPiece = noPiece;
+		u8 heldPiece = noPiece;
+		u8 level = 0;
+		u32 lines = 0;
+		u64 pieces = 0; //How many pieces have been placed
+	};
+
+	LockstepSimulator(PieceState* const, const Blocks* const, const u8 width = 10, const u8 height = 20);
+	void reset(std::span<const u32> seeds);
+	void resetLane(const u8 lane, const u32 seed);
+	void stopLane(const u8 lane);
+	void step(const Actions&);
+	void tryPlacements(const Actions&, Trial&) const;
+	void getFeatures(const Boards&, Features&) const;
+	const u32 getPlayingLanes() const;
+	const Lane& getLane(const u8 lane) const;
+	const Boards& getBoards() const;
+	const bool isFilled(const u8 lane, const u8 x, const u8 y) const;
+	const u8 getWidth() const;
+	const u8 getHeight() const;
+	static const char* getInstructionSet();
+
+private:
+	using PieceRows = std::array<LaneValues, 4>;
+	using ShiftedPiece = std::array<u32, 4>; //A rotated piece's rows as row masks, at one column
+	static constexpr u8 columns = maxWidth - minColumn + 1;
+
+	const u8 getPlacedPiece(const u8 lane, const bool hold) const;
+	const u32 getPieceRows(const Actions&, PieceRows&) const;
+	u8 getEmptyRows(const Boards&) const;
+	u32 placePieces(const Boards& source, Boards& destination, const PieceRows&, LaneValues& fullRows) const;
+	void clearRows(Boards&, const u8 lane, const u32 fullRows) const;
+
+	const u8 m_width, m_height;
+	const u32 m_wallMask;
+	std::vector<std::array<std::array<ShiftedPiece, columns>, 4>> m_pieces; //Indexed [pieceType][rotation][x - minColumn]
+	Boards m_boards;
+	std::array<Lane, lanes> m_lanes;
+	std::array<Blocks, lanes> m_blocks;
+};
@@ -1,8 +1,9 @@
 #pragma once
-#include <SFML/Audio.hpp>
+#include "MusicStream.hpp"
 
 /// <summary>
-/// This class abstracts the sf::Music away from the Game class
+/// This class abstracts the music stream away from the Game class.
+/// The theme speeds up with the level and crossfades into the danger theme while the stack is near the top of the board.
 /// Will add sf::Sound to this class as well in the future for drop/line-cleared sounds.
 /// </summary>
 class MusicController
@@ -11,7 +12,13 @@ public:
 	MusicController();
 	void startMusic();
 	void stopMusic();
+	void update(const u8 level, const u8 stackHeight, const u8 boardHeight);
+	void subscribe(EventBus&);
 private:
-	sf::Music m_theme;
+	static constexpr float tempoPerLevel = 0.02f;
+	static constexpr u8 fastestLevel = 20; //The theme is 40% faster from here on
+
+	MusicStream m_theme;
 	bool musicAvailable;
-};
\ No newline at end of file
+	bool m_danger = false;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <SFML/Audio.hpp>
+
+#include "Globals.hpp"
+#include "TimeStretch.hpp"
+#include "EventBus.hpp"
+
+/// <summary>
+/// Streams the looping theme to SFML's audio thread, sped up without changing its pitch, and crossfaded into a danger stem on request.
+/// Both stems are decoded into memory when they are opened, so the audio thread never reads files. It mixes the stems, time stretches
+/// the mix and converts it to 16 bit samples, all in buffers allocated up front.
+/// The game thread only sets targets through atomics, and the audio thread eases towards them, so nothing is shared under a lock.
+/// The audio thread also drains the game's events, and fades the music out and stops when the game is over.
+/// </summary>
+class MusicStream : public sf::SoundStream
+{
+public:
+	~MusicStream();
+	bool openFromFiles(const std::string& themeFile, const std::string& dangerFile);
+	void setTempo(const float tempo);
+	void setDanger(const bool danger);
+	const bool hasDangerStem() const;
+	void setEventQueue(EventBus::Queue* const);
+protected:
+	bool onGetData(Chunk& data) override;
+	void onSeek(sf::Time timeOffset) override;
+private:
+	static constexpr u32 hopsPerChunk = 4; //About 93ms of audio per chunk at 44.1kHz, SFML keeps three chunks queued
+	static constexpr float tempoStep = 0.002f; //The most the tempo changes per hop, a whole level's speed up takes about a quarter of a second
+	static constexpr float crossfadeSeconds = 1.5f;
+
+	/// <summary>
+	/// A decoded stem and how far into it the mix has read
+	/// </summary>
+	struct Stem
+	{
+		std::vector<s16> samples;
+		size_t position = 0; //In samples, always a whole frame
+	};
+
+	bool loadStem(const std::string& file, Stem& stem, u32& channelCount, u32& sampleRate) const;
+	void mixInput();
+	void readEvents();
+
+	Stem m_theme, m_danger;
+	u32 m_channelCount = 0;
+	TimeStretch m_stretch;
+	std::vector<float> m_mix; //One hop of mixed input
+	std::vector<float> m_stretched; //One hop of output
+	std::vector<s16> m_samples; //The chunk handed to SFML, which reads it until the next onGetData
+
+	std::atomic<float> m_targetTempo = 1.0f;
+	std::atomic<bool> m_targetDanger = false;
+	float m_tempo = 1.0f; //Audio thread only
+	float m_dangerMix = 0.0f; //Audio thread only, 0 is all theme and 1 is all danger stem
+	float m_dangerStep = 0.0f;
+	std::atomic<EventBus::Queue*> m_events = nullptr; //Popped by the audio thread, and by onSeek while it is stopped
+	bool m_fadingOut = false; //Audio thread only, set once the game is over
+};
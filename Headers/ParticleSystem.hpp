@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <SFML/Graphics/Color.hpp>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// A fixed size pool of short lived particles, for the line clear, hard drop and level up effects.
+/// Particles are stored as a structure of arrays and updated a field at a time, so the update loops vectorize, and the renderers draw
+/// the whole pool as one batch. Positions and speeds are in board cells, so the effects follow the board wherever it is drawn.
+/// All memory is allocated up front. Once the pool is full, new particles are dropped until old ones fade out.
+/// Only ever touched by the thread that renders the game.
+/// </summary>
+class ParticleSystem
+{
+public:
+	static constexpr u32 capacity = 8192; //Enough for four lines cleared by four players on the widest board at once
+
+	ParticleSystem();
+	void clear();
+	void update(const float deltaSeconds);
+
+	void emitLineClear(const u8 row, const u8 boardWidth, const sf::Color);
+	void emitHardDrop(const s8 x, const u8 y, const u8 width, const sf::Color);
+	void emitLevelUp(const u8 boardWidth, const u8 boardHeight);
+
+	const u32 getCount() const;
+	const float* getX() const;
+	const float* getY() const;
+	const float* getSizes() const;
+	const sf::Color* getColors() const;
+	const u8* getAlphas() const;
+private:
+	static constexpr float gravity = 24.0f; //Cells per second squared
+	static constexpr float drag = 1.5f; //How much of its speed a particle loses per second
+
+	void emit(const float x, const float y, const float xSpeed, const float ySpeed, const float lifetime, const float size, const sf::Color);
+	float random(const float min, const float max);
+
+	u32 m_count = 0;
+	std::vector<float> m_x, m_y; //The center of the particle
+	std::vector<float> m_xSpeed, m_ySpeed;
+	std::vector<float> m_age, m_inverseLifetime; //A particle dies once its age times its inverse lifetime reaches 1
+	std::vector<float> m_size;
+	std::vector<sf::Color> m_color;
+	std::vector<u8> m_alpha; //Fades from 255 to 0 over the particle's life, worked out by update()
+	u32 m_random = 0x9E3779B9;
+};
@@ -0,0 +1,152 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Board.hpp"
+#include "Blocks.hpp"
+#include "PieceState.hpp"
+#include "RotationSystem.hpp"
+#include "TripleBuffer.hpp"
+
+/// <summary>
+/// Looks for ways to clear the whole board (a perfect clear) with the pieces a player has coming, for training mode hints.
+/// The bottom rows of the board are searched as bitboards, one bitmask per row, placing the current piece, the held piece and the
+/// preview queue in every order the hold allows. Every placement is a hard drop from above the stack, so a hint can always be played
+/// by rotating, moving sideways and dropping.
+/// The first placements are split between worker threads, which search depth first and share a transposition table of the states
+/// already explored, so no state is searched twice. Dead ends are pruned early: a board whose empty areas can't be filled
+/// with whole pieces, or that needs more pieces than are left, is never searched.
+///
+/// The game thread never waits on the search. request() hands a new position to the solver and returns straight away,
+/// cancelling any search that is still running, and getSolution() returns the newest result without blocking.
+/// </summary>
+class PerfectClearSolver
+{
+public:
+	static constexpr u8 maxLines = 6; //The most rows a solution may use
+	static constexpr u8 maxQueue = 16; //The current piece and the preview queue
+	static constexpr u8 maxPlacements = maxQueue;
+	static constexpr u8 noPiece = 0xFF;
+
+	/// <summary>
+	/// One piece of a solution: which piece goes where, and whether it is reached by holding first
+	/// </summary>
+	struct Placement
+	{
+		u8 piece = 0;
+		u8 rotation = 0;
+		s8 xOffset = 0;
+		u8 yOffset = 0; //Where the piece lands on the board as it is now. Only meaningful while linesClearedBefore is 0
+		bool hold = false; //The player holds before placing this piece
+		u8 linesClearedBefore = 0; //How many lines the earlier placements of the solution clear
+	};
+
+	struct Solution
+	{
+		enum class Status : u8 { Idle, Searching, Found, NotFound };
+
+		u32 request = 0; //The request the result is for
+		Status status = Status::Idle;
+		u8 lines = 0; //How many rows the solution clears
+		u8 placementCount = 0;
+		std::array<Placement, maxPlacements> placements{};
+	};
+
+	PerfectClearSolver(PieceState* const, const Blocks* const, const u8 lines = 4, const u8 threads = 0);
+	~PerfectClearSolver();
+	u32 request(const Board&, const u8 width, const u8 height, const PieceState::State&, std::span<const u8> preview);
+	const Solution& getSolution();
+	const u8 getLines() const;
+
+private:
+	/// <summary>
+	/// A piece in one rotation as bitmasks, one per occupied row from the bottom up, shifted to start at column 0
+	/// </summary>
+	struct Shape
+	{
+		std::array<u32, 4> rows{};
+		u8 rotation = 0;
+		u8 height = 0;
+		u8 width = 0;
+		u8 leftColumn = 0; //The column of the piece's data its leftmost cell is in
+		u8 bottomRow = 0; //The row of the piece's data its lowest cell is in
+	};
+
+	/// <summary>
+	/// A position in the search. Row 0 of the field is the bottom row of the board.
+	/// </summary>
+	struct Node
+	{
+		std::array<u32, maxLines> rows{};
+		u8 height = 0; //Rows at or above this must stay empty. 0 once every row has been cleared
+		u8 queueIndex = 0; //The next piece to come out of the queue
+		u8 hold = noPiece;
+		bool canHold = true;
+		u8 linesCleared = 0;
+	};
+
+	/// <summary>
+	/// A first move, which one worker searches everything after
+	/// </summary>
+	struct Task
+	{
+		Node node;
+		Placement placement;
+	};
+
+	struct Request
+	{
+		u32 id = 0;
+		u8 width = 0;
+		u8 height = 0;
+		std::array<u32, maxLines> rows{}; //The bottom rows of the board
+		u8 stackHeight = 0;
+		u8 queueLength = 0;
+		std::array<u8, maxQueue> queue{};
+		u8 hold = noPiece;
+		bool canHold = true;
+	};
+
+	void coordinate();
+	void help();
+	void search(const Request&, const u8 lines);
+	void runTasks(const Request&);
+	bool searchNode(const Request&, const Node&, std::array<Placement, maxPlacements>& path, const u8 depth);
+	u8 getPiece(const Request&, const Node&, const bool hold, u8& queueIndex) const;
+	bool place(const Request&, const Node&, const u8 piece, const Shape&, const u8 column, Node& result, Placement&) const;
+	bool isSolvable(const Request&, const Node&) const;
+	bool isCancelled(const u32 requestId) const;
+	bool markVisited(const Node&);
+	void publish(const Solution&);
+
+	std::array<std::vector<Shape>, 8> m_shapes; //The distinct rotations of every piece type
+	const u8 m_lines;
+
+	TripleBuffer<Request> m_requests; //Written by the game thread, read by the coordinator
+	std::atomic<u32> m_requestCount = 0;
+	TripleBuffer<Solution> m_solutions; //Written by the search threads under m_solutionMutex, read by the game thread
+	std::mutex m_solutionMutex;
+
+	//The search the helpers are working on. Only changed by the coordinator while no helper is searching.
+	const Request* m_activeRequest = nullptr;
+	std::vector<Task> m_tasks;
+	std::atomic<u32> m_nextTask = 0;
+	std::atomic<bool> m_found = false;
+	std::vector<std::atomic<u64>> m_visited; //The transposition table. Keys include the search number, so it never needs clearing
+	u64 m_searchNumber = 0;
+	u8 m_searchLines = 0;
+
+	std::mutex m_poolMutex;
+	std::condition_variable m_poolCondition;
+	u32 m_searchesStarted = 0;
+	u8 m_helpersSearching = 0;
+	std::atomic<bool> m_stopping = false;
+	std::thread m_coordinator;
+	std::vector<std::thread> m_helpers;
+};
@@ -7,35 +7,49 @@ class PieceState
 {
 public:
 	/// <summary>
-	/// The Piece information, including the piece data and the width of the piece
+	/// The Piece information, including the piece data, the width of the piece, and which of the block types it is
 	/// </summary>
 	struct Piece
 	{
-		Piece() : width(0), data(0) {}
-		Piece(const std::vector<u8> data, const u8 width) : width(width), data(data) {}
+		Piece() : width(0), data(0), type(0) {}
+		Piece(const std::vector<u8> data, const u8 width, const u8 type) : width(width), data(data), type(type) {}
 
 		std::vector<u8> data;
 		u8 width;
+		u8 type;
 	};
 
 	/// <summary>
 	/// The state of the piece. Which rotation it is in, how far left/right it has moved, and how far down it has moved.
+	/// The pieces point at the block generator's piece data, which never changes, so spawning a piece doesn't allocate.
+	/// The fields can be read directly, but must only be changed through the setters, which keep the Zobrist hash of the state up to date.
 	/// </summary>
 	struct State
 	{
-		std::unique_ptr<Piece> piece;
-		std::unique_ptr<Piece> nextPiece;
-		std::unique_ptr<Piece> heldPiece;
+		const Piece* piece = nullptr;
+		const Piece* nextPiece = nullptr;
+		const Piece* heldPiece = nullptr;
 
-		u8 rotation;
-		s8 xOffset;
-		u8 yOffset;
-		bool canHoldPiece;
+		u8 rotation = 0;
+		s8 xOffset = 0;
+		u8 yOffset = 0;
+		bool canHoldPiece = false;
+		u64 hash = 0;
+
+		void setPiece(const Piece* const);
+		void setNextPiece(const Piece* const);
+		void setHeldPiece(const Piece* const);
+		void swapHeldPiece();
+		void setRotation(const u8);
+		void setPosition(const s8 x, const u8 y);
+		void move(const s8 x, const s8 y);
+		void setCanHoldPiece(const bool);
+		u64 computeHash() const;
 	};
 
 public:
-	void renderPiece(Renderer* const, const std::unique_ptr<Piece>&, const u8 rotation, const s8 xOffset, const u8 yOffset, PlayerColor* const, const PieceToDraw, const u8 ghostPieceOffset = 0);
-	bool getPieceData(const u8 x, const u8 y, const std::unique_ptr<Piece>&, const u8 rotation);
+	void renderPiece(Renderer* const, const Piece&, const u8 rotation, const s8 xOffset, const float yOffset, const PlayerColor* const, const PieceToDraw, const u8 ghostPieceOffset = 0);
+	bool getPieceData(const u8 x, const u8 y, const Piece&, const u8 rotation);
 
 private:
 	const sf::Color m_ghostOutlineColor = sf::Color(50, 50, 50, 50);
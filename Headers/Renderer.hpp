@@ -1,29 +1,40 @@
 #pragma once
-#include <string>
-#include <SFML/Graphics/RenderWindow.hpp>
-#include <SFML/Graphics/Font.hpp>
-#include <SFML/Graphics/Text.hpp>
-#include <SFML/Graphics/RectangleShape.hpp>
+#include <string_view>
+#include <SFML/Graphics/Color.hpp>
 
 #include "Globals.hpp"
 
+class ParticleSystem;
+
 /// <summary>
-/// This class abstracts the rendering information away from the Game class
+/// This class abstracts the rendering information away from the Game class.
+/// WindowRenderer draws to an SFML window, SoftwareRenderer rasterizes into a pixel buffer without needing a display.
 /// </summary>
 class Renderer
 {
 public:
-	Renderer(const u8 pieceSize, sf::RenderWindow* const window);
-	const bool isWindowOpen();
-	void clearRenderer();
-	void showRenderer();
+	Renderer(const u8 pieceSize);
+	virtual ~Renderer() = default;
+	virtual const bool isWindowOpen() = 0;
+	virtual void setActive(const bool active) = 0;
+	virtual void closeWindow() = 0;
+	virtual void clearRenderer() = 0;
+	virtual void showRenderer() = 0;
 	void drawBorder(const u8 gameWidth, const u8 gameHeight);
-	void drawPiece(const s8 x, const s8 y, const sf::Color fill, const sf::Color outline);
-	void drawText(const u16 x, const u16 y, const std::string& strToDisplay);
-private:
-	sf::Font m_font;
-	sf::Text m_text;
-	sf::RenderWindow* m_window;
-	const u8 m_pieceSize;
-};
+	void setBoardOffset(const u16 xOffset);
+	virtual void setPieceSize(const u8 pieceSize);
+	virtual void drawPiece(const float x, const float y, const sf::Color fill, const sf::Color outline) = 0;
+	virtual void drawText(const u16 x, const u16 y, const std::string_view strToDisplay) = 0;
+	virtual void drawParticles(const ParticleSystem&) = 0;
 
+	static constexpr u8 referencePieceSize = 28; //Text positions and sizes are laid out for this piece size and scaled to the actual one
+protected:
+	float getPieceX(const float x) const;
+	float getPieceY(const float y) const;
+	float getTextX(const u16 x) const;
+	float getTextY(const u16 y) const;
+	float getTextScale() const;
+
+	u8 m_pieceSize;
+	u16 m_boardOffset = 0;
+};
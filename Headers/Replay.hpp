@@ -0,0 +1,62 @@
+#pragma once
+#include <filesystem>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Gravity.hpp"
+
+/// <summary>
+/// A single recorded move, applied at the start of the given simulation tick
+/// </summary>
+struct ReplayMove
+{
+	u32 tick;
+	u8 player;
+	u8 move;
+	u16 reserved;
+};
+
+/// <summary>
+/// A recorded game: the settings, gravity and block seed it started with, and every move that was applied during it.
+/// Feeding the moves back into a Game built with the same settings, gravity and seed reproduces the game exactly.
+/// Stored as a fixed header followed by the gravity curve and then the moves, so a file can be read or memory-mapped directly.
+/// </summary>
+class Replay
+{
+public:
+	struct Header
+	{
+		u32 magic;
+		u16 version;
+		u8 numPlayers;
+		u8 gameWidth;
+		u8 gameHeight;
+		u8 boardHeight;
+		u16 lockDelay;
+		u32 seed;
+		u32 ticks;
+		u32 moveCount;
+		u8 maxLockResets;
+		u8 reserved;
+		u16 gravityLevels;
+	};
+	static constexpr u32 replayMagic = 0x4C505254; //"TRPL"
+	static constexpr u16 replayVersion = 5; //Bumped whenever the rules change, so older replays are rejected instead of playing out differently
+
+	Replay();
+	void reset(const u32 seed, const u8 numPlayers, const u8 gameWidth, const u8 gameHeight, const u8 boardHeight, const Gravity&);
+	void recordMove(const u32 tick, const PlayerMove move);
+	void setTicks(const u32 ticks);
+	const Header& getHeader() const;
+	const std::vector<ReplayMove>& getMoves() const;
+	Gravity getGravity() const;
+
+	bool saveToFile(const std::filesystem::path&) const;
+	bool loadFromFile(const std::filesystem::path&);
+	size_t loadFromMemory(const u8* data, const size_t size);
+	static size_t measure(const u8* data, const size_t size);
+private:
+	Header m_header;
+	std::vector<u32> m_gravityCurve;
+	std::vector<ReplayMove> m_moves;
+};
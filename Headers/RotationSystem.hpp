@@ -0,0 +1,60 @@
+#pragma once
+#include <array>
+#include <span>
+#include <vector>
+
+#include "Globals.hpp"
+#include "PieceState.hpp"
+#include "Blocks.hpp"
+#include "Board.hpp"
+
+enum class RotationDirection : u8 { Clockwise = 1, Half = 2, CounterClockwise = 3 };
+
+/// <summary>
+/// A table-driven Super Rotation System (https://tetris.wiki/Super_Rotation_System).
+/// The kick offsets for every rotation transition live in compile-time tables, one for the J, L, S, T and Z pieces and one for the I piece.
+/// The O piece never rotates. 180 degree rotations use the six-test SRS+ table for every piece.
+/// Every kick test is a handful of bitmask ANDs of the rotated piece against the board's row masks, instead of a cell-by-cell check.
+/// </summary>
+class RotationSystem
+{
+public:
+	/// <summary>
+	/// A kick offset, as written on the Tetris wiki: +x is right and +y is up
+	/// </summary>
+	struct Kick
+	{
+		s8 x;
+		s8 y;
+	};
+
+	/// <summary>
+	/// One bitmask per row of a rotated piece. Bit x is set if column x of that row is filled.
+	/// </summary>
+	using PieceMask = std::array<u8, 4>;
+
+	RotationSystem(PieceState* const, const Blocks* const);
+	std::span<const Kick> getKicks(const PieceState::Piece&, const u8 fromRotation, const RotationDirection) const;
+	bool fits(const Board&, const u8 pieceType, const u8 rotation, const s8 x, const s8 y, const u8 floor) const;
+	const PieceMask& getMask(const u8 pieceType, const u8 rotation) const;
+
+private:
+	static constexpr u8 kickTests = 5;
+	static constexpr u8 halfKickTests = 6;
+
+	//Indexed [fromRotation][toRotation]. Rotations are 0 (spawn), 1 (R), 2 and 3 (L). Entries where from == to are never used.
+	static constexpr Kick m_jlstzKicks[4][4][halfKickTests] = {
+		{ {}, { {0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2} }, { {0, 0}, {0, 1}, {1, 1}, {-1, 1}, {1, 0}, {-1, 0} }, { {0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2} } },
+		{ { {0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2} }, {}, { {0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2} }, { {0, 0}, {1, 0}, {1, 2}, {1, 1}, {0, 2}, {0, 1} } },
+		{ { {0, 0}, {0, -1}, {-1, -1}, {1, -1}, {-1, 0}, {1, 0} }, { {0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2} }, {}, { {0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2} } },
+		{ { {0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2} }, { {0, 0}, {-1, 0}, {-1, 2}, {-1, 1}, {0, 2}, {0, 1} }, { {0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2} }, {} }
+	};
+	static constexpr Kick m_iKicks[4][4][halfKickTests] = {
+		{ {}, { {0, 0}, {-2, 0}, {1, 0}, {-2, -1}, {1, 2} }, { {0, 0}, {0, 1}, {1, 1}, {-1, 1}, {1, 0}, {-1, 0} }, { {0, 0}, {-1, 0}, {2, 0}, {-1, 2}, {2, -1} } },
+		{ { {0, 0}, {2, 0}, {-1, 0}, {2, 1}, {-1, -2} }, {}, { {0, 0}, {-1, 0}, {2, 0}, {-1, 2}, {2, -1} }, { {0, 0}, {1, 0}, {1, 2}, {1, 1}, {0, 2}, {0, 1} } },
+		{ { {0, 0}, {0, -1}, {-1, -1}, {1, -1}, {-1, 0}, {1, 0} }, { {0, 0}, {1, 0}, {-2, 0}, {1, -2}, {-2, 1} }, {}, { {0, 0}, {2, 0}, {-1, 0}, {2, 1}, {-1, -2} } },
+		{ { {0, 0}, {1, 0}, {-2, 0}, {1, -2}, {-2, 1} }, { {0, 0}, {-1, 0}, {-1, 2}, {-1, 1}, {0, 2}, {0, 1} }, { {0, 0}, {-2, 0}, {1, 0}, {-2, -1}, {1, 2} }, {} }
+	};
+
+	std::vector<std::array<PieceMask, 4>> m_masks; //Indexed [pieceType][rotation]
+};
@@ -0,0 +1,81 @@
+#pragma once
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// Stores an in-progress game on disk so it can be suspended and resumed.
+/// The file is a fixed header, the board cells, and one record per player. Saves are written on a background thread into a
+/// temporary file that is then renamed over the old save, so a crash mid-write never leaves a broken save behind.
+/// Loading memory-maps the file, so resuming doesn't have to read or parse anything up front.
+/// </summary>
+class SaveGame
+{
+public:
+	struct Header
+	{
+		u32 magic;
+		u16 version;
+		u8 numPlayers;
+		u8 gameWidth;
+		u8 gameHeight;
+		u8 boardHeight;
+		u8 level;
+		u8 reserved;
+		u32 lines;
+		u32 tick;
+		u32 seed;
+		u64 blocksDrawn;
+	};
+	struct PlayerRecord
+	{
+		u8 piece;
+		u8 nextPiece;
+		u8 heldPiece;
+		u8 rotation;
+		s8 xOffset;
+		u8 yOffset;
+		u8 canHoldPiece;
+		u8 lockResets;
+		u32 fallProgress;
+		u16 lockTicks;
+		u8 forceLock;
+		u8 lowestRow;
+	};
+	static constexpr u32 saveMagic = 0x56415354; //"TSAV"
+	static constexpr u16 saveVersion = 2;
+
+	/// <summary>
+	/// The size of the board section. Padded so the player records that follow it stay 8-byte aligned.
+	/// </summary>
+	static constexpr size_t boardSize(const u8 width, const u8 height)
+	{
+		return (static_cast<size_t>(width) * height + 7) & ~static_cast<size_t>(7);
+	}
+
+	SaveGame(const std::filesystem::path&);
+	~SaveGame();
+	const bool exists() const;
+	void writeAsync(const std::vector<u8>& data);
+	void waitForWrite();
+	void remove();
+
+	bool map();
+	void unmap();
+	const Header* getHeader() const;
+	const u8* getBoard() const;
+	const PlayerRecord* getPlayers() const;
+private:
+	std::filesystem::path m_path;
+	std::vector<u8> m_writeBuffer;
+	std::thread m_writer;
+
+	const u8* m_mapped = nullptr;
+	size_t m_mappedSize = 0;
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#endif
+};
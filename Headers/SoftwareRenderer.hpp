@@ -0,0 +1,44 @@
+#pragma once
+#include <string_view>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Renderer.hpp"
+
+class FrameEncoder;
+
+/// <summary>
+/// Rasterizes the game on the CPU into an RGBA pixel buffer, so frames can be rendered on machines without a display.
+/// Text is drawn with a built-in 5x7 bitmap font instead of the game's TrueType font.
+/// Every shown frame is handed to the attached FrameEncoder, if there is one.
+/// </summary>
+class SoftwareRenderer : public Renderer
+{
+public:
+	SoftwareRenderer(const u8 pieceSize, const u16 width, const u16 height);
+	const bool isWindowOpen() override;
+	void setActive(const bool active) override;
+	void closeWindow() override;
+	void clearRenderer() override;
+	void showRenderer() override;
+	void drawPiece(const float x, const float y, const sf::Color fill, const sf::Color outline) override;
+	void drawText(const u16 x, const u16 y, const std::string_view strToDisplay) override;
+	void drawParticles(const ParticleSystem&) override;
+
+	void setFrameEncoder(FrameEncoder* const);
+	const std::vector<u8>& getPixels() const;
+	const u16 getWidth() const;
+	const u16 getHeight() const;
+	const u32 getFramesShown() const;
+private:
+	void fillRect(s32 left, s32 top, s32 right, s32 bottom, const sf::Color);
+
+	static constexpr u8 glyphWidth = 5, glyphHeight = 7;
+	static constexpr u8 textScale = 3;
+	const sf::Color m_textColor = sf::Color::Cyan;
+
+	std::vector<u8> m_pixels;
+	const u16 m_width, m_height;
+	FrameEncoder* m_frameEncoder = nullptr;
+	u32 m_framesShown = 0;
+};
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+
+#include "Globals.hpp"
+#include "GameSnapshot.hpp"
+#include "SpectatorFeedLayout.hpp"
+
+/// <summary>
+/// Publishes every tick of the game into a POSIX shared-memory ring buffer so overlay/stream processes can follow the game live.
+/// The game is the only writer and never waits on readers, so any number of them can attach without slowing it down.
+/// On platforms without POSIX shared memory the feed is simply never opened.
+/// </summary>
+class SpectatorFeed
+{
+public:
+	SpectatorFeed(const std::string& name = SpectatorFeedLayout::defaultName);
+	~SpectatorFeed();
+	const bool isOpen();
+	void publish(const GameSnapshot&);
+private:
+	std::string m_name;
+	SpectatorFeedLayout::Feed* m_feed = nullptr;
+	u64 m_publishedFrames = 0;
+};
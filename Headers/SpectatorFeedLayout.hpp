@@ -0,0 +1,103 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+/**
+* The binary layout of the shared-memory spectator feed.
+* Shared between the game (the only writer) and any number of reader processes, so it only uses fixed-width types and no SFML headers.
+* Any change to the layout must bump feedVersion.
+*/
+namespace SpectatorFeedLayout
+{
+	static constexpr const char* defaultName = "/coop-tetris-feed";
+	static constexpr std::uint32_t feedMagic = 0x54455446; //"FTET"
+	static constexpr std::uint16_t feedVersion = 2;
+	static constexpr std::uint16_t slotCount = 64;
+
+	static constexpr std::uint8_t maxPlayers = 4;
+	static constexpr std::uint8_t maxBoardWidth = 20;
+	static constexpr std::uint8_t maxBoardHeight = 22;
+	static constexpr std::uint8_t noPiece = 0xFF;
+
+	static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "The feed needs address-free atomics to work across processes");
+
+	struct Player
+	{
+		std::uint8_t piece;
+		std::uint8_t rotation;
+		std::int8_t xOffset;
+		std::uint8_t yOffset;
+		std::uint8_t nextPiece;
+		std::uint8_t heldPiece;
+		std::uint8_t reserved[2];
+	};
+
+	/// <summary>
+	/// One tick of game state. sequence is odd while the game is writing the frame and even once it is complete,
+	/// so a reader can tell whether the copy it made was torn.
+	/// </summary>
+	struct Frame
+	{
+		std::atomic<std::uint64_t> sequence;
+		std::uint64_t stateHash; //The game's state hash on this tick. Two runs of a game with the same moves have the same hash on every tick
+		std::uint32_t tick;
+		std::uint32_t lines;
+		std::uint8_t level;
+		std::uint8_t numPlayers;
+		std::uint8_t boardWidth;
+		std::uint8_t boardHeight;
+		std::uint8_t gameOver;
+		std::uint8_t reserved[7];
+		Player players[maxPlayers];
+		std::uint8_t board[maxBoardWidth * maxBoardHeight]; //Row-major with a stride of boardWidth. 0 is empty, otherwise the index + 1 of the player who placed it
+	};
+
+	struct Header
+	{
+		std::uint32_t magic;
+		std::uint16_t version;
+		std::uint16_t slotCount;
+		std::uint32_t frameSize;
+		std::uint32_t reserved;
+		std::atomic<std::uint64_t> publishedFrames; //The number of frames written so far. The newest frame is in slot (publishedFrames - 1) % slotCount
+	};
+
+	struct Feed
+	{
+		Header header;
+		Frame frames[slotCount];
+	};
+
+	/// <summary>
+	/// Copies the newest complete frame out of the feed. Never writes to the shared memory, so it works on a read-only mapping.
+	/// </summary>
+	/// <param name="feed">The mapped feed</param>
+	/// <param name="out">Where the frame is copied to. Its sequence member is left untouched</param>
+	/// <returns>The feed-wide frame number that was copied, or 0 if nothing has been published yet</returns>
+	inline std::uint64_t readLatest(const Feed& feed, Frame& out)
+	{
+		while (true)
+		{
+			const std::uint64_t published = feed.header.publishedFrames.load(std::memory_order_acquire);
+			if (published == 0) return 0;
+
+			const Frame& frame = feed.frames[(published - 1) % slotCount];
+			const std::uint64_t before = frame.sequence.load(std::memory_order_acquire);
+			if (before != published * 2) continue; //Being rewritten with a newer frame, try again with the new newest one
+
+			out.stateHash = frame.stateHash;
+			out.tick = frame.tick;
+			out.lines = frame.lines;
+			out.level = frame.level;
+			out.numPlayers = frame.numPlayers;
+			out.boardWidth = frame.boardWidth;
+			out.boardHeight = frame.boardHeight;
+			out.gameOver = frame.gameOver;
+			for (std::uint8_t i = 0; i < maxPlayers; ++i) out.players[i] = frame.players[i];
+			for (std::uint16_t i = 0; i < maxBoardWidth * maxBoardHeight; ++i) out.board[i] = frame.board[i];
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (frame.sequence.load(std::memory_order_relaxed) == before) return published;
+		}
+	}
+}
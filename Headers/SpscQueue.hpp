@@ -0,0 +1,61 @@
+#pragma once
+#include <array>
+#include <atomic>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// A lock-free bounded queue for handing items from exactly one producer thread to exactly one consumer thread.
+/// push() never blocks: when the queue is full the item is rejected and the producer carries on.
+/// The two indices live on their own cache lines, and each side keeps a cached copy of the other side's index,
+/// so the threads only touch each other's cache line when the queue looks full or empty.
+/// </summary>
+template <typename T, u32 Capacity>
+class SpscQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "The capacity must be a power of two");
+public:
+	/// <summary>
+	/// Adds an item to the back of the queue. Producer thread only.
+	/// </summary>
+	/// <returns>Returns false if the queue was full and the item was dropped</returns>
+	bool push(const T& item)
+	{
+		const u32 tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_cachedHead == Capacity)
+		{
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if (tail - m_cachedHead == Capacity) return false;
+		}
+		m_items[tail & m_indexMask] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// <summary>
+	/// Takes the item at the front of the queue. Consumer thread only.
+	/// </summary>
+	/// <returns>Returns false if the queue was empty</returns>
+	bool pop(T& item)
+	{
+		const u32 head = m_head.load(std::memory_order_relaxed);
+		if (head == m_cachedTail)
+		{
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if (head == m_cachedTail) return false;
+		}
+		item = m_items[head & m_indexMask];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	static constexpr u32 m_indexMask = Capacity - 1;
+
+	//Both indices only ever count up and wrap around together, so tail - head is always the number of queued items
+	alignas(64) std::atomic<u32> m_tail = 0;
+	u32 m_cachedHead = 0; //The producer's copy of m_head
+	alignas(64) std::atomic<u32> m_head = 0;
+	u32 m_cachedTail = 0; //The consumer's copy of m_tail
+	alignas(64) std::array<T, Capacity> m_items{};
+};
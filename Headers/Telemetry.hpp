@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <SFML/System/Time.hpp>
+
+#include "Globals.hpp"
+#include "EventBus.hpp"
+
+/// <summary>
+/// Per-session gameplay counters and gauges for monitoring cabinets.
+/// Every update is a single relaxed atomic operation with no locks, so the game and render threads can report from their hot paths.
+/// Gameplay counters come from the game's events, which the background thread drains from the event bus every few milliseconds.
+/// The same thread periodically writes the values in the Prometheus text format to a file (for a textfile collector to pick up).
+/// </summary>
+class Telemetry
+{
+public:
+	Telemetry(const std::filesystem::path& file, const sf::Time flushInterval = sf::seconds(5));
+	~Telemetry();
+
+	void subscribe(EventBus&);
+	void startSession(const u8 numPlayers);
+	void piecePlaced(const u8 playerIndex);
+	void linesCleared(const u8 count);
+	void levelChanged(const u8 level, const sf::Time gameTime);
+	void inputQueueDepth(const u32 depth);
+	void frameRendered(const sf::Time frameTime);
+
+	std::string exportText() const;
+private:
+	void exporter();
+	void readEvents();
+	void flush();
+
+	static constexpr u8 maxClearSize = 4;
+	static constexpr u8 trackedLevels = 30;
+	static constexpr sf::Int64 droppedFrameMicroseconds = 1000000 / 30; //Anything slower than 30 fps missed at least one refresh
+	static constexpr sf::Int64 microsecondsPerTick = 1000000 / 60; //The game's fixed tick, for turning event ticks into game time
+	static constexpr std::chrono::milliseconds eventInterval{ 20 }; //How often the event queue is drained
+
+	//Written by the game thread
+	alignas(64) std::array<std::atomic<u64>, maxPlayers> m_piecesPlaced{};
+	std::array<std::atomic<u64>, maxClearSize> m_clears{};
+	std::array<std::atomic<s64>, trackedLevels> m_levelMicroseconds{};
+	std::atomic<u8> m_level = 0;
+	std::atomic<u8> m_numPlayers = 0;
+	std::atomic<s64> m_levelStartMicroseconds = 0;
+	std::atomic<u32> m_inputQueueDepth = 0;
+	std::atomic<u32> m_maxInputQueueDepth = 0;
+	std::atomic<s64> m_sessionStart = 0;
+
+	//Written by the render thread. Kept on its own cache line so the two threads never contend
+	alignas(64) std::atomic<u64> m_frames = 0;
+	std::atomic<u64> m_droppedFrames = 0;
+
+	//Set before the game starts, then only read by the exporter thread
+	std::atomic<EventBus::Queue*> m_events = nullptr;
+	std::atomic<const EventBus*> m_eventBus = nullptr;
+
+	const std::filesystem::path m_file;
+	const sf::Time m_flushInterval;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_stopping = false;
+	std::thread m_exporter;
+};
@@ -0,0 +1,125 @@
+#pragma once
+#include <stdint.h>
+
+/*
+* The C API of libtetris_env: a batch of headless games for training agents, played by the same rules as the game,
+* co-op games with several players included.
+*
+* Every call works on the whole batch. reset and step write the observations and rewards straight into buffers the caller owns,
+* laid out as contiguous arrays indexed by environment (and then player), so they can be wrapped as arrays without copying:
+*
+*     boards    uint8_t  [envs][height][width]   0 for an empty cell, otherwise the player + 1 whose piece filled it
+*     players   TetrisEnvPlayer [envs][players]
+*     games     TetrisEnvGame   [envs]
+*     rewards   float    [envs]                  lines cleared during the step
+*     dones     uint8_t  [envs]                  1 once the game is over
+*
+* Any buffer may be NULL, and is then not written. The environments are stepped on an internal thread pool, and a step doesn't allocate
+* once the games' replay buffers have grown to the length of an episode. The functions must not be called from more than one thread at once.
+*
+*     TetrisEnvConfig config = { .envs = 64, .players = 1, .threads = 0, .ticksPerStep = 1, .autoReset = 1 };
+*     TetrisEnv* env = tetris_env_create(&config);
+*     tetris_env_reset(env, 1, &buffers);
+*     tetris_env_step(env, actions, &buffers);    (actions: uint8_t[envs][players] of TetrisEnvAction)
+*     tetris_env_destroy(env);
+*/
+
+#if defined(_WIN32)
+#if defined(TETRIS_ENV_BUILD)
+#define TETRIS_ENV_API __declspec(dllexport)
+#else
+#define TETRIS_ENV_API __declspec(dllimport)
+#endif
+#else
+#define TETRIS_ENV_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Changes whenever a struct layout or a function's meaning changes */
+#define TETRIS_ENV_API_VERSION 1
+
+#define TETRIS_ENV_NO_PIECE 0xFF
+
+typedef struct TetrisEnv TetrisEnv;
+
+typedef struct TetrisEnvConfig
+{
+	uint32_t envs; /* How many games are played side by side */
+	uint8_t players; /* 1 to 4. Co-op games share one board that gets wider with every player, as in the game */
+	uint8_t autoReset; /* 1 restarts a finished game with its next seed at the start of the following step */
+	uint16_t ticksPerStep; /* How many 60Hz game ticks a step lasts. The actions are applied on the first. 0 is treated as 1 */
+	uint32_t threads; /* How many threads step the batch, counting the caller's. 0 uses every core */
+} TetrisEnvConfig;
+
+typedef enum TetrisEnvAction
+{
+	TETRIS_ENV_ACTION_NONE = 0,
+	TETRIS_ENV_ACTION_LEFT,
+	TETRIS_ENV_ACTION_RIGHT,
+	TETRIS_ENV_ACTION_SOFT_DROP,
+	TETRIS_ENV_ACTION_ROTATE_CLOCKWISE,
+	TETRIS_ENV_ACTION_ROTATE_COUNTER_CLOCKWISE,
+	TETRIS_ENV_ACTION_ROTATE_180,
+	TETRIS_ENV_ACTION_HARD_DROP,
+	TETRIS_ENV_ACTION_HOLD,
+	TETRIS_ENV_ACTION_COUNT
+} TetrisEnvAction;
+
+/* A player's falling piece. Piece types are 0 to 6: O, S, Z, L, J, T, I */
+typedef struct TetrisEnvPlayer
+{
+	uint8_t piece;
+	uint8_t rotation; /* 0 to 3, clockwise from the spawn rotation */
+	int8_t x; /* The board column of the left of the piece's data */
+	uint8_t y; /* The board row of the top of the piece's data, 0 is the top row */
+	uint8_t nextPiece;
+	uint8_t heldPiece; /* TETRIS_ENV_NO_PIECE if nothing is held */
+	uint8_t canHold;
+	uint8_t reserved;
+} TetrisEnvPlayer;
+
+typedef struct TetrisEnvGame
+{
+	uint32_t seed; /* The seed of the game's pieces, for replaying it */
+	uint32_t tick;
+	uint32_t lines;
+	uint8_t level;
+	uint8_t gameOver;
+	uint16_t reserved;
+} TetrisEnvGame;
+
+typedef struct TetrisEnvBuffers
+{
+	uint8_t* boards;
+	TetrisEnvPlayer* players;
+	TetrisEnvGame* games;
+	float* rewards;
+	uint8_t* dones;
+} TetrisEnvBuffers;
+
+TETRIS_ENV_API uint32_t tetris_env_api_version(void);
+
+/* Returns NULL if the config isn't valid or the batch couldn't be created, for example when its memory or threads can't be allocated */
+TETRIS_ENV_API TetrisEnv* tetris_env_create(const TetrisEnvConfig* config);
+TETRIS_ENV_API void tetris_env_destroy(TetrisEnv* env);
+
+TETRIS_ENV_API uint32_t tetris_env_count(const TetrisEnv* env);
+TETRIS_ENV_API uint8_t tetris_env_players(const TetrisEnv* env);
+TETRIS_ENV_API uint8_t tetris_env_board_width(const TetrisEnv* env);
+TETRIS_ENV_API uint8_t tetris_env_board_height(const TetrisEnv* env);
+
+/* Starts a new game in every environment. Environment i plays seed + i, and with autoReset its later games seed + i + k * envs */
+TETRIS_ENV_API void tetris_env_reset(TetrisEnv* env, uint32_t seed, const TetrisEnvBuffers* buffers);
+
+/* Starts a new game in one environment and writes its observations, leaving the others alone */
+TETRIS_ENV_API void tetris_env_reset_one(TetrisEnv* env, uint32_t index, uint32_t seed, const TetrisEnvBuffers* buffers);
+
+/* Applies an action per player and advances every game. actions may be NULL for no actions */
+TETRIS_ENV_API void tetris_env_step(TetrisEnv* env, const uint8_t* actions, const TetrisEnvBuffers* buffers);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+#include <array>
+#include <vector>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// Changes the tempo of streamed audio without changing its pitch, using WSOLA (waveform similarity overlap-add).
+/// Every output hop overlap-adds a Hann windowed segment of the input, read from around where the tempo says the input should be.
+/// The exact segment is searched for within a small tolerance, picking the one that lines up best with the end of the last segment,
+/// so the waveforms join without the phasing artifacts of plain overlap-add. At a tempo of 1 it reproduces its input exactly.
+///
+/// All buffers are allocated by initialize(), and writing and processing never allocate or lock, so it can run on the audio thread.
+/// </summary>
+class TimeStretch
+{
+public:
+	static constexpr u32 windowFrames = 2048; //About 46ms at 44.1kHz, long enough to keep the notes of the theme intact
+	static constexpr u32 hopFrames = windowFrames / 2;
+	static constexpr float minTempo = 0.5f;
+	static constexpr float maxTempo = 2.0f;
+
+	void initialize(const u32 channelCount);
+	void reset();
+	const u32 getFreeFrames() const;
+	void write(const float* const frames, const u32 frameCount);
+	bool process(float* const output, const float tempo);
+private:
+	static constexpr u32 searchFrames = 512; //How far from the ideal position a segment may be taken from
+	static constexpr u32 coarseStep = 8; //The search first checks every 8th position, comparing every 4th frame
+	static constexpr u32 coarseStride = 4;
+	static constexpr u32 capacityFrames = 8 * windowFrames;
+
+	const u32 getDroppableFrames() const;
+	const s64 findBestSegment(const s64 ideal, const s64 continuation) const;
+	const float getSimilarity(const s64 candidate, const s64 continuation, const u32 stride) const;
+	void compact();
+
+	u32 m_channelCount = 0;
+	std::array<float, windowFrames> m_window{};
+	std::vector<float> m_input; //Interleaved frames, starting at frame m_inputStart of the stream
+	std::vector<float> m_mono; //The channels of m_input summed, for the similarity search
+	std::vector<float> m_overlap; //The second half of the last windowed segment, added to the first half of the next one
+	s64 m_inputStart = 0;
+	u32 m_inputFrames = 0;
+	double m_position = 0; //Where the next segment ideally starts in the input
+	s64 m_previous = 0; //Where the last segment started
+	bool m_started = false;
+};
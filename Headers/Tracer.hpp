@@ -0,0 +1,91 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// Records begin/end and instant events from the game loop, for finding rare hitches offline.
+/// Every thread writes into its own fixed size ring buffer with no locks, and the newest events of every thread can be written to a
+/// Chrome trace JSON file at any time (open it in chrome://tracing or ui.perfetto.dev). Tracing is off until start() is called,
+/// and while it is off every event costs a single relaxed load.
+/// Event and thread names must be string literals (or otherwise outlive the tracer), since only the pointers are recorded.
+/// </summary>
+class Tracer
+{
+public:
+	static constexpr s64 noArg = std::numeric_limits<s64>::min();
+
+	static void start(const std::filesystem::path& file);
+	static void stop();
+	static bool flush();
+	static inline bool isEnabled()
+	{
+		return m_enabled.load(std::memory_order_relaxed);
+	}
+
+	static void begin(const char* const name, const s64 arg = noArg);
+	static void end(const char* const name);
+	static void instant(const char* const name, const s64 arg = noArg);
+	static void setThreadName(const char* const name);
+
+	/// <summary>
+	/// Records a begin event now and the matching end event when the scope ends. Does nothing if tracing was off when it was created.
+	/// </summary>
+	class Scope
+	{
+	public:
+		inline Scope(const char* const name, const s64 arg = noArg) : m_name(isEnabled() ? name : nullptr)
+		{
+			if (m_name != nullptr) begin(m_name, arg);
+		}
+		inline ~Scope()
+		{
+			if (m_name != nullptr) end(m_name);
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	private:
+		const char* const m_name;
+	};
+private:
+	static constexpr size_t eventsPerThread = 1 << 15; //About a minute and a half of the game and render threads at 60 fps
+
+	/// <summary>
+	/// One recorded event. The fields are atomics so the events can be copied out while the thread that owns them keeps writing.
+	/// </summary>
+	struct Event
+	{
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<u64> timestamp{ 0 }; //Nanoseconds since tracing started
+		std::atomic<s64> arg{ noArg };
+		std::atomic<char> phase{ 0 };
+	};
+
+	/// <summary>
+	/// A single producer ring buffer. Only the owning thread writes, and head counts every event it has ever written.
+	/// </summary>
+	struct ThreadBuffer
+	{
+		std::array<Event, eventsPerThread> events;
+		std::atomic<u64> head{ 0 };
+		std::atomic<const char*> name{ nullptr };
+		u32 threadId = 0;
+	};
+
+	static void record(const char phase, const char* const name, const s64 arg);
+	static ThreadBuffer* getThreadBuffer();
+
+	static std::atomic<bool> m_enabled;
+	static std::chrono::steady_clock::time_point m_start;
+	static std::filesystem::path m_file;
+	static std::mutex m_mutex; //Guards the list of buffers and the file, never taken while recording
+	static std::vector<std::unique_ptr<ThreadBuffer>> m_buffers;
+	static thread_local ThreadBuffer* t_buffer;
+};
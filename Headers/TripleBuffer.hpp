@@ -0,0 +1,54 @@
+#pragma once
+#include <array>
+#include <atomic>
+
+#include "Globals.hpp"
+
+/// <summary>
+/// A lock-free triple buffer for handing data from exactly one writer thread to exactly one reader thread.
+/// The writer fills writeBuffer() and calls publish(), the reader calls read() and always gets the most recently published buffer.
+/// Neither side ever blocks the other, and the buffer being read is never touched by the writer.
+/// </summary>
+template <typename T>
+class TripleBuffer
+{
+public:
+	/// <summary>
+	/// The buffer the writer is allowed to fill. Its previous contents are stale and must be fully overwritten.
+	/// </summary>
+	T& writeBuffer()
+	{
+		return m_buffers[m_writeIndex];
+	}
+
+	/// <summary>
+	/// Swaps the filled write buffer with the shared middle buffer, marking it as new data for the reader
+	/// </summary>
+	void publish()
+	{
+		const u8 previous = m_middleIndex.exchange(m_writeIndex | m_newDataFlag, std::memory_order_acq_rel);
+		m_writeIndex = previous & m_indexMask;
+	}
+
+	/// <summary>
+	/// Takes the newest published buffer if there is one, otherwise keeps returning the last one read
+	/// </summary>
+	const T& read()
+	{
+		if (m_middleIndex.load(std::memory_order_relaxed) & m_newDataFlag)
+		{
+			const u8 previous = m_middleIndex.exchange(m_readIndex, std::memory_order_acq_rel);
+			m_readIndex = previous & m_indexMask;
+		}
+		return m_buffers[m_readIndex];
+	}
+
+private:
+	static constexpr u8 m_indexMask = 0x03;
+	static constexpr u8 m_newDataFlag = 0x04;
+
+	std::array<T, 3> m_buffers{};
+	std::atomic<u8> m_middleIndex = 1;
+	u8 m_writeIndex = 0;
+	u8 m_readIndex = 2;
+};
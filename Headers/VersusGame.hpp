@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <barrier>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Game.hpp"
+
+/// <summary>
+/// Competitive mode. Every player gets their own board and their own single player Game, all fed the same piece sequence.
+/// Clearing lines sends garbage rows to the next player still in the game, and the last player standing wins.
+///
+/// Every tick, each board is simulated on its own worker thread. Once all of them are done, garbage is exchanged on the
+/// calling thread in player order with a seeded hole generator, so a versus game plays out the same way no matter how the
+/// workers were scheduled. A separate thread renders all boards side by side through the shared renderer.
+/// </summary>
+class VersusGame
+{
+public:
+	VersusGame(const u8 numPlayers, const u8 gameWidth, const u8 gameHeight, const u8 boardHeight, const u16 panelWidth, const u16 panelHeight,
+		Renderer* const, InputController* const, MusicController* const, PieceState* const, const u32 seed = std::random_device()());
+	~VersusGame();
+	void run();
+
+	//Used to drive the game without a window
+	void queueMove(const PlayerMove);
+	void tick();
+	const bool isGameOver() const;
+	const u8 getWinner() const;
+	const u32 getTick() const;
+	const u64 getStateHash() const;
+	const Game& getGame(const u8 playerIndex) const;
+	static const u8 getAttack(const u32 linesCleared);
+
+	static constexpr u8 noWinner = 0xFF;
+private:
+	/// <summary>
+	/// Everything that belongs to one player's side of the match
+	/// </summary>
+	struct Player
+	{
+		std::unique_ptr<Board> board;
+		std::unique_ptr<Blocks> blocks;
+		std::unique_ptr<Game> game;
+		u32 lines = 0;
+	};
+
+	void setUp(const u32 seed);
+	void startWorkers();
+	void stopWorkers();
+	void worker(const u8 playerIndex);
+	void exchangeGarbage();
+	void updateWinner();
+	void updateMusic();
+
+	void loop();
+	void input();
+	void restart();
+	void startRenderThread();
+	void renderLoop();
+	void stopRenderThread();
+	void render();
+
+	const u8 m_numPlayers;
+	const u8 m_gameWidth, m_gameHeight, m_boardHeight;
+	const u16 m_panelWidth, m_panelHeight;
+	Renderer* const m_renderer;
+	InputController* const m_inputController;
+	MusicController* const m_musicController;
+	PieceState* const m_pieceState;
+
+	std::vector<Player> m_players;
+	std::mt19937 m_garbageGenerator;
+	u32 m_tick = 0;
+	std::atomic<bool> m_gameOver = false;
+	std::atomic<u8> m_winner = noWinner;
+	bool m_quit = false;
+	const sf::Time m_timePerTick = sf::microseconds(1000000 / 60);
+
+	std::barrier<> m_tickStart;
+	std::barrier<> m_tickDone;
+	std::vector<std::thread> m_workers;
+	bool m_stopWorkers = false;
+
+	std::thread m_renderThread;
+	std::atomic<bool> m_rendering = false;
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <SFML/Graphics/RenderWindow.hpp>
+#include <SFML/Graphics/Font.hpp>
+#include <SFML/Graphics/Text.hpp>
+#include <SFML/Graphics/RectangleShape.hpp>
+#include <SFML/Graphics/Vertex.hpp>
+
+#include "Globals.hpp"
+#include "Renderer.hpp"
+
+/// <summary>
+/// Draws the game to an SFML window
+/// </summary>
+class WindowRenderer : public Renderer
+{
+public:
+	WindowRenderer(const u8 pieceSize, sf::RenderWindow* const window);
+	const bool isWindowOpen() override;
+	void setActive(const bool active) override;
+	void closeWindow() override;
+	void clearRenderer() override;
+	void showRenderer() override;
+	void setPieceSize(const u8 pieceSize) override;
+	void drawPiece(const float x, const float y, const sf::Color fill, const sf::Color outline) override;
+	void drawText(const u16 x, const u16 y, const std::string_view strToDisplay) override;
+	void drawParticles(const ParticleSystem&) override;
+private:
+	sf::Font m_font;
+	bool m_fontLoaded;
+	sf::Text m_text;
+	sf::String m_string; //Reused for every drawText call so drawing text doesn't allocate once it has grown
+	sf::RectangleShape m_rect;
+	std::vector<sf::Vertex> m_particleVertices; //Four corners for every particle the pool can hold, drawn in one call
+	sf::RenderWindow* m_window;
+};
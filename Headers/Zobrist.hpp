@@ -0,0 +1,39 @@
+#pragma once
+#include "Globals.hpp"
+
+/// <summary>
+/// Keys for the incremental Zobrist hashes of the board and the players' pieces.
+/// Every feature of the game state (a cell holding a value, a piece in a slot, a rotation, a position) has its own 64-bit key, and a
+/// hash is the XOR of the keys of every feature, so a change is hashed by XORing out the old feature's key and XORing in the new one's.
+/// Keys are worked out from the feature with a fixed mixing function instead of being drawn into a random table, so they are the same
+/// in every build and on every machine, and hashes can be compared between processes.
+/// A feature with the value 0 has the key 0, so an empty board and a fresh piece state both hash to 0.
+/// </summary>
+namespace Zobrist
+{
+	enum class Feature : u8 { Cell = 1, Piece, NextPiece, HeldPiece, Rotation, XOffset, YOffset, CanHoldPiece, Player, Fall, ForceLock, Score };
+
+	/// <summary>
+	/// The splitmix64 finalizer. Every bit of the input affects every bit of the output, and no two inputs share an output.
+	/// </summary>
+	constexpr u64 mix(u64 value)
+	{
+		value ^= value >> 30;
+		value *= 0xBF58476D1CE4E5B9ull;
+		value ^= value >> 27;
+		value *= 0x94D049BB133111EBull;
+		value ^= value >> 31;
+		return value;
+	}
+
+	/// <summary>
+	/// The key of a feature
+	/// </summary>
+	/// <param name="feature">What kind of feature it is</param>
+	/// <param name="position">Where it is, e.g. the index of a board cell or a player. 0 for features that only exist once</param>
+	/// <param name="value">Its value. Up to 24 bits</param>
+	constexpr u64 key(const Feature feature, const u32 position, const u32 value)
+	{
+		return value == 0 ? 0 : mix((static_cast<u64>(feature) << 56) ^ (static_cast<u64>(position) << 24) ^ value);
+	}
+}
@@ -1,36 +1,75 @@
 #pragma once
+#include <array>
 #include <fstream>
+#include <memory>
+#include <string>
 #include <SFML/Window.hpp>
 #include <SFML/Graphics/Image.hpp>
 #include <SFML/Graphics/Sprite.hpp>
 
 #include "../../Headers/Globals.hpp"
 #include "../../Headers/Game.hpp"
+#include "../../Headers/WindowRenderer.hpp"
+#include "../../Headers/VersusGame.hpp"
 #include "MainMenuEventHandler.hpp"
 
+/// <summary>
+/// Which screen the application is on. Game over and restarting are handled inside a game, which returns to the menu when it is left.
+/// </summary>
+enum class AppState { Menu, Playing, Resuming, Versus, Exit };
+
+/// <summary>
+/// The extra windows co-op games are shown in besides the main window, e.g. to put every player on their own monitor
+/// </summary>
+struct DisplayWindowSettings
+{
+	bool perPlayer = false; //A window for each player, showing only their next, held and ghost pieces
+	bool spectator = false; //A window showing everything, like the main window
+};
+
 class MainMenu
 {
 public:
-	MainMenu();
+	MainMenu(const std::array<std::string, maxPlayers>& botCommands = {}, const u8 hintLines = 0, const DisplayWindowSettings& displayWindows = {});
 	void showMainMenu();
+	AppState updateMainMenu();
+	AppState returnToMainMenu();
 	void renderMainMenu();
+	void resizeWindow(const u16 width, const u16 height, const char* const title);
 	void setNumPlayers(const u8 numPlayers);
 	void setPlayerControl(const u8 player, const u8 controllerType, const u8 input, const u8 moveToMake);
 	void calculateGameSizes();
-	void startGame();
+	void startGame(const bool resume = false);
+	void startVersusGame();
 private:
 	sf::RenderWindow window;
+
+	//Created once and shared by every game, so restarting or starting a new game never reopens the window or the audio device
+	WindowRenderer m_renderer;
+	InputController m_inputController;
+	EventBus m_eventBus; //Co-op games publish their events here, for the music and telemetry to pick up on their own threads
+	MusicController m_musicController;
+	PieceState m_pieceState;
+	Blocks m_blockGenerator;
+	SpectatorFeed m_spectatorFeed;
+	Leaderboard m_leaderboard;
+	Telemetry m_telemetry;
+	SaveGame m_saveGame;
+	std::array<std::string, maxPlayers> m_botCommands; //The engine playing each player in co-op games, empty for a person
+	const u8 m_hintLines; //How many rows perfect clear hints may use in single player games, 0 for no hints
+	const DisplayWindowSettings m_displayWindows;
+
 	MainMenuEventHandler m_eventHandler;
 	MainMenuAction m_menuAction;
 
-	static constexpr u8 m_baseWidth = 10;
-	static constexpr double m_scalingFactor = 3.4;
+	static constexpr u8 minVersusPieceSize = 12;
 	static constexpr u8 pieceSize = 28;
 	static constexpr u8 gameHeight = 20;
 	static constexpr u8 boardHeight = 22;
 
 	static constexpr u16 mainMenuWindowHeight = 600;
 	static constexpr u16 mainMenuWindowWidth = 600;
+	static constexpr const char* saveFileName = "savegame.sav";
 
 
 	u8 m_numPlayers;
@@ -9,6 +9,9 @@ class MainMenuEventHandler
 public:
 	MainMenuEventHandler(sf::Window* const);
 	uint8_t handleInput();
+
+	static constexpr uint8_t resumeGame = 0xFE;
+	static constexpr uint8_t versusGame = 0x80; //Set along with the player count when Shift is held
 private:
 	sf::Event m_event;
 	sf::Window* m_window;
@@ -1,8 +1,13 @@
 #include "../Headers/MainMenu.hpp"
 
+#include <algorithm>
 #include <iostream>
 
-MainMenu::MainMenu() : m_numPlayers(1), window(sf::VideoMode(mainMenuWindowWidth, mainMenuWindowHeight), "TETRIS"), m_eventHandler(&window)
+MainMenu::MainMenu(const std::array<std::string, maxPlayers>& botCommands, const u8 hintLines, const DisplayWindowSettings& displayWindows) :
+	window(sf::VideoMode(mainMenuWindowWidth, mainMenuWindowHeight), "TETRIS"), m_renderer(pieceSize, &window), m_inputController(&window),
+	m_leaderboard(std::filesystem::current_path() / "leaderboard"), m_telemetry(std::filesystem::current_path() / "metrics" / "tetris.prom"),
+	m_saveGame(std::filesystem::current_path() / saveFileName), m_botCommands(botCommands), m_hintLines(hintLines), m_displayWindows(displayWindows),
+	m_eventHandler(&window), m_numPlayers(1)
 {
 	if (!bgImage.loadFromFile("../../../../Images/bg-image.jpg"))
 	{
@@ -14,25 +19,90 @@ MainMenu::MainMenu() : m_numPlayers(1), window(sf::VideoMode(mainMenuWindowWidth
 		bgSprite.setTexture(bgTexture, true);
 	}
 	window.setPosition(sf::Vector2i(sf::VideoMode::getDesktopMode().width / 2 - mainMenuWindowWidth / 2, sf::VideoMode::getDesktopMode().height / 2 - mainMenuWindowHeight / 2));
+	m_musicController.subscribe(m_eventBus);
+	m_telemetry.subscribe(m_eventBus);
+	window.setVerticalSyncEnabled(true); //Paces the menu, and the render thread in game, to the monitor's refresh rate
 	window.clear();
 	window.display();
 	showMainMenu();
 }
 
+/// <summary>
+/// The application's state machine: menu, then a game (which handles its own game over screen and restarts), then back to the menu.
+/// Every state shares the one window and the subsystems created with the menu, so nothing is torn down or rebuilt between games
+/// and the call stack never grows.
+/// </summary>
 void MainMenu::showMainMenu()
 {
-	while (window.isOpen())
+	AppState state = AppState::Menu;
+	while (state != AppState::Exit)
 	{
-		renderMainMenu();
-		uint8_t num = m_eventHandler.handleInput();
-		if (num > 0 && num < 5)
+		switch (state)
 		{
-			setNumPlayers(num);
-			startGame();
+		case AppState::Menu:
+			state = updateMainMenu();
+			break;
+
+		case AppState::Playing:
+		case AppState::Resuming:
+			startGame(state == AppState::Resuming);
+			state = returnToMainMenu();
+			break;
+
+		case AppState::Versus:
+			startVersusGame();
+			state = returnToMainMenu();
+			break;
+
+		case AppState::Exit:
+			break;
 		}
 	}
 }
 
+/// <summary>
+/// Draws the menu and handles its input once
+/// </summary>
+/// <returns>The state to move to</returns>
+AppState MainMenu::updateMainMenu()
+{
+	renderMainMenu();
+	uint8_t num = m_eventHandler.handleInput();
+	if (!window.isOpen())
+	{
+		return AppState::Exit;
+	}
+	else if (num == MainMenuEventHandler::resumeGame)
+	{
+		return AppState::Resuming;
+	}
+	else if (num & MainMenuEventHandler::versusGame)
+	{
+		setNumPlayers(num & ~MainMenuEventHandler::versusGame);
+		return AppState::Versus;
+	}
+	else if (num > 0 && num < 5)
+	{
+		setNumPlayers(num);
+		return AppState::Playing;
+	}
+	return AppState::Menu;
+}
+
+/// <summary>
+/// Puts the window back to the menu's size once a game has been left
+/// </summary>
+/// <returns>The menu, or exit if the window was closed during the game</returns>
+AppState MainMenu::returnToMainMenu()
+{
+	if (!window.isOpen()) return AppState::Exit;
+
+	m_renderer.setPieceSize(pieceSize);
+	m_renderer.setBoardOffset(0);
+	resizeWindow(mainMenuWindowWidth, mainMenuWindowHeight, "TETRIS");
+	return AppState::Menu;
+}
+
 void MainMenu::renderMainMenu()
 {
 	window.clear();
@@ -40,6 +110,17 @@ void MainMenu::renderMainMenu()
 	window.display();
 }
 
+/// <summary>
+/// Resizes the window in place and centers it on the screen. The view is reset too, so one pixel is still one unit.
+/// </summary>
+void MainMenu::resizeWindow(const u16 width, const u16 height, const char* const title)
+{
+	window.setSize(sf::Vector2u(width, height));
+	window.setView(sf::View(sf::FloatRect(0, 0, width, height)));
+	window.setTitle(title);
+	window.setPosition(sf::Vector2i(sf::VideoMode::getDesktopMode().width / 2 - width / 2, sf::VideoMode::getDesktopMode().height / 2 - height / 2));
+}
+
 void MainMenu::setNumPlayers(const u8 numPlayers)
 {
 	m_numPlayers = numPlayers;
@@ -52,22 +133,101 @@ void MainMenu::setPlayerControl(const u8 player, const u8 controllerType, const
 
 void MainMenu::calculateGameSizes()
 {
-	gameWidth = m_baseWidth + ((m_numPlayers - 1) * m_scalingFactor);
+	gameWidth = coopBoardWidth(m_numPlayers);
 	gameWindowWidth = (sideBuffer * 2 + gameWidth) * pieceSize;
 	gameWindowHeight = (verticalBuffer * 2 + gameHeight + 2) * pieceSize;
 }
 
-void MainMenu::startGame()
+void MainMenu::startGame(const bool resume)
 {
+	if (resume)
+	{
+		if (!m_saveGame.map())
+		{
+			std::cout << "No saved game to resume" << std::endl;
+			return;
+		}
+		setNumPlayers(m_saveGame.getHeader()->numPlayers);
+	}
+
 	calculateGameSizes();
-	window.close();
-	sf::RenderWindow gameWindow = sf::RenderWindow(sf::VideoMode(gameWindowWidth, gameWindowHeight), "TETRIS");
-	gameWindow.setPosition(sf::Vector2i(sf::VideoMode::getDesktopMode().width / 2 - gameWindowWidth / 2, sf::VideoMode::getDesktopMode().height / 2 - gameWindowHeight / 2));
-	Renderer mainRenderer = Renderer(pieceSize, &gameWindow);
+	resizeWindow(gameWindowWidth, gameWindowHeight, "TETRIS");
+
+	//The display windows are opened for this game only, and outlive it so its render threads are stopped before they close
+	std::vector<std::unique_ptr<sf::RenderWindow>> displayWindows;
+	std::vector<std::unique_ptr<WindowRenderer>> displayRenderers;
+	std::vector<sf::Window*> displayInputs;
+	std::vector<u8> displayPlayers;
+	const auto openDisplayWindow = [&](const std::string& title, const u8 followedPlayer)
+	{
+		displayWindows.push_back(std::make_unique<sf::RenderWindow>(sf::VideoMode(gameWindowWidth, gameWindowHeight), title));
+		const int cascade = static_cast<int>(displayWindows.size()) * 32; //Staggered so every window can be picked up and moved to its monitor
+		displayWindows.back()->setPosition(sf::Vector2i(cascade, cascade));
+		displayWindows.back()->setVerticalSyncEnabled(true);
+		displayRenderers.push_back(std::make_unique<WindowRenderer>(pieceSize, displayWindows.back().get()));
+		displayInputs.push_back(displayWindows.back().get());
+		displayPlayers.push_back(followedPlayer);
+	};
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers && m_displayWindows.perPlayer; ++playerIndex)
+	{
+		openDisplayWindow("TETRIS - Player " + std::to_string(playerIndex + 1), playerIndex);
+	}
+	if (m_displayWindows.spectator) openDisplayWindow("TETRIS - Spectator", Game::allPlayers);
+	m_inputController.setDisplayWindows(displayInputs);
+
 	Board mainBoard = Board(gameWidth, boardHeight);
-	InputController mainInputController = InputController(&gameWindow);
-	MusicController mainMusicController;
-	PieceState mainPieceState;
-	Blocks mainBlockGenerator;
-	Game game(m_numPlayers, gameWidth, gameHeight, sideBuffer, verticalBuffer, gameWindowWidth, gameWindowHeight, &mainRenderer, &mainBoard, &mainInputController, &mainMusicController, &mainPieceState, &mainBlockGenerator);
+	m_blockGenerator.reseed(); //The generator is shared by every game, and every game starts a new sequence
+	Game game(m_numPlayers, gameWidth, gameHeight, sideBuffer, verticalBuffer, gameWindowWidth, gameWindowHeight, &m_renderer, &mainBoard, &m_inputController, &m_musicController, &m_pieceState, &m_blockGenerator);
+	if (m_spectatorFeed.isOpen()) game.setSpectatorFeed(&m_spectatorFeed);
+	game.setSaveGame(&m_saveGame);
+	game.setLeaderboard(&m_leaderboard);
+	game.setTelemetry(&m_telemetry);
+	game.setEventBus(&m_eventBus);
+	if (resume && !game.loadGame(m_saveGame))
+	{
+		std::cout << "Saved game doesn't match this game, starting a new one" << std::endl;
+	}
+	m_saveGame.unmap();
+
+	std::vector<std::unique_ptr<BotPlayer>> bots;
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		if (m_botCommands[playerIndex].empty()) continue;
+		bots.push_back(std::make_unique<BotPlayer>(m_botCommands[playerIndex], playerIndex));
+		game.setBot(playerIndex, bots.back().get());
+	}
+
+	std::unique_ptr<PerfectClearSolver> solver;
+	if (m_hintLines > 0 && m_numPlayers == 1)
+	{
+		solver = std::make_unique<PerfectClearSolver>(&m_pieceState, &m_blockGenerator, m_hintLines);
+		game.setPerfectClearSolver(solver.get());
+	}
+	for (size_t display = 0; display < displayRenderers.size(); ++display)
+	{
+		game.addView(displayRenderers[display].get(), displayPlayers[display]);
+	}
+	game.run();
+	m_inputController.setDisplayWindows({});
 }
+
+
+/// <summary>
+/// Starts a versus match with one standard width board per player, laid out side by side.
+/// The pieces are drawn smaller when that is what it takes for every board to fit on the screen.
+/// </summary>
+void MainMenu::startVersusGame()
+{
+	const u16 panelCells = sideBuffer * 2 + baseBoardWidth;
+	const u16 panelHeightCells = verticalBuffer * 2 + gameHeight + 2;
+	const u32 availableWidth = sf::VideoMode::getDesktopMode().width * 9 / 10;
+	const u8 versusPieceSize = static_cast<u8>(std::clamp<u32>(availableWidth / (panelCells * m_numPlayers), minVersusPieceSize, pieceSize));
+	const u16 versusWindowWidth = panelCells * m_numPlayers * versusPieceSize;
+	const u16 versusWindowHeight = panelHeightCells * versusPieceSize;
+
+	m_renderer.setPieceSize(versusPieceSize);
+	resizeWindow(versusWindowWidth, versusWindowHeight, "TETRIS VERSUS");
+	VersusGame game(m_numPlayers, baseBoardWidth, gameHeight, boardHeight, panelCells * pieceSize, panelHeightCells * pieceSize,
+		&m_renderer, &m_inputController, &m_musicController, &m_pieceState);
+	game.run();
+}
\ No newline at end of file
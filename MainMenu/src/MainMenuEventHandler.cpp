@@ -15,6 +15,8 @@ uint8_t MainMenuEventHandler::handleInput()
 			break;
 
 		case sf::Event::EventType::KeyPressed:
+		{
+			const uint8_t versus = m_event.key.shift ? versusGame : 0;
 			switch (m_event.key.code)
 			{
 			case sf::Keyboard::Num1:
@@ -22,20 +24,23 @@ uint8_t MainMenuEventHandler::handleInput()
 			case sf::Keyboard::Numpad1:
 				return 1;
 			case sf::Keyboard::Num2:
-				return 2;
+				return versus | 2;
 			case sf::Keyboard::Numpad2:
-				return 2;
+				return versus | 2;
 			case sf::Keyboard::Num3:
-				return 3;
+				return versus | 3;
 			case sf::Keyboard::Numpad3:
-				return 3;
+				return versus | 3;
 			case sf::Keyboard::Numpad4:
-				return 4;
+				return versus | 4;
 			case sf::Keyboard::Num4:
-				return 4;
+				return versus | 4;
+			case sf::Keyboard::R:
+				return resumeGame;
 			default:
 				return 0;
 			}
+		}
 		default:
 			return 0;
 		}
@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../../../Headers/Game.hpp"
+
+/**
+* Plays a co-op game headlessly with every player handed to a bot engine, for testing engines and the bot protocol without a window.
+* The game waits for every engine to answer (up to its deadline) before each tick, so a deterministic engine plays the same game
+* every time for the same seed. The game can be saved as a replay, which ReplayRunner and FrameExporter can then play back.
+*
+* Usage: BotRunner <engine command> [--players N] [--seed N] [--ticks N] [--deadline ms] [--replay file]
+*/
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: BotRunner <engine command> [--players N] [--seed N] [--ticks N] [--deadline ms] [--replay file]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const std::string command = argv[1];
+	u8 numPlayers = 1;
+	u32 seed = 1, maxTicks = 60 * 60 * 10;
+	std::chrono::milliseconds deadline = BotPlayer::defaultDeadline;
+	std::filesystem::path replayPath;
+	for (int i = 2; i + 1 < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--players") == 0) numPlayers = static_cast<u8>(std::clamp(std::stoi(argv[++i]), 1, static_cast<int>(maxPlayers)));
+		else if (std::strcmp(argv[i], "--seed") == 0) seed = static_cast<u32>(std::stoul(argv[++i]));
+		else if (std::strcmp(argv[i], "--ticks") == 0) maxTicks = static_cast<u32>(std::stoul(argv[++i]));
+		else if (std::strcmp(argv[i], "--deadline") == 0) deadline = std::chrono::milliseconds(std::stoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--replay") == 0) replayPath = argv[++i];
+	}
+
+	//The same board sizes as the main menu
+	constexpr u8 gameHeight = 20, boardHeight = 22;
+	const u8 gameWidth = coopBoardWidth(numPlayers);
+
+	Board board(gameWidth, boardHeight);
+	PieceState pieceState;
+	Blocks blocks(seed);
+	Game game(numPlayers, gameWidth, gameHeight, sideBuffer, verticalBuffer, 0, 0, nullptr, &board, nullptr, nullptr, &pieceState, &blocks);
+
+	std::vector<std::unique_ptr<BotPlayer>> bots;
+	for (u8 playerIndex = 0; playerIndex < numPlayers; ++playerIndex)
+	{
+		bots.push_back(std::make_unique<BotPlayer>(command, playerIndex, deadline));
+		if (!bots.back()->isRunning())
+		{
+			std::cerr << "Could not start " << command << std::endl;
+			return EXIT_FAILURE;
+		}
+		game.setBot(playerIndex, bots.back().get());
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	while (game.getTick() < maxTicks && !game.isGameOver())
+	{
+		for (const std::unique_ptr<BotPlayer>& bot : bots)
+		{
+			bot->waitForReply();
+		}
+		game.tick();
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	u32 missedDeadlines = 0;
+	for (const std::unique_ptr<BotPlayer>& bot : bots)
+	{
+		missedDeadlines += bot->getMissedDeadlines();
+	}
+	std::cout << (game.isGameOver() ? "Topped out" : "Survived") << " after " << game.getTick() << " ticks: lines " << game.getLines()
+		<< ", level " << game.getLevel() + 1 << ", " << missedDeadlines << " missed deadlines, " << seconds << "s" << std::endl;
+
+	if (!replayPath.empty() && !game.getReplay().saveToFile(replayPath))
+	{
+		std::cerr << "Could not save the replay to " << replayPath << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "../../../Headers/Game.hpp"
+#include "../../../Headers/SoftwareRenderer.hpp"
+#include "../../../Headers/FrameEncoder.hpp"
+
+/**
+* Renders a recorded game without a window, through the same Game code and layout the real game uses.
+* The game is replayed headlessly and drawn with the CPU renderer, while the frames are encoded on worker threads.
+*
+* Usage: FrameExporter <replay file> <output> [--format png|y4m|raw] [--every N] [--threads N] [--tick N]
+*     --format    png writes one image per frame into the output directory, y4m and raw write a single video file (default y4m)
+*     --every     Only render every Nth tick (default 1, which is 60 frames per second)
+*     --threads   How many frames to encode at once
+*     --tick      Only write a PNG screenshot of the game after N ticks to the output file
+*/
+
+namespace
+{
+	constexpr u8 pieceSize = 28; //The same size the game window uses
+
+	bool parseFormat(const char* name, FrameEncoder::Format& format)
+	{
+		if (std::strcmp(name, "png") == 0) format = FrameEncoder::Format::Png;
+		else if (std::strcmp(name, "y4m") == 0) format = FrameEncoder::Format::Y4m;
+		else if (std::strcmp(name, "raw") == 0) format = FrameEncoder::Format::Raw;
+		else return false;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		std::cerr << "Usage: FrameExporter <replay file> <output> [--format png|y4m|raw] [--every N] [--threads N] [--tick N]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const std::filesystem::path replayPath = argv[1], output = argv[2];
+	FrameEncoder::Format format = FrameEncoder::Format::Y4m;
+	u32 every = 1;
+	u8 threadCount = static_cast<u8>(std::clamp(std::thread::hardware_concurrency(), 1u, 16u));
+	s64 screenshotTick = -1;
+	for (int i = 3; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			if (!parseFormat(argv[++i], format))
+			{
+				std::cerr << "Unknown format " << argv[i] << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		else if (std::strcmp(argv[i], "--every") == 0 && i + 1 < argc) every = std::max(1, std::stoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threadCount = static_cast<u8>(std::clamp(std::stoi(argv[++i]), 1, 64));
+		else if (std::strcmp(argv[i], "--tick") == 0 && i + 1 < argc) screenshotTick = std::max(0, std::stoi(argv[++i]));
+	}
+
+	Replay replay;
+	if (!replay.loadFromFile(replayPath))
+	{
+		std::cerr << "Could not read replay " << replayPath << std::endl;
+		return EXIT_FAILURE;
+	}
+	const Replay::Header& header = replay.getHeader();
+	if (header.numPlayers == 0 || header.numPlayers > maxPlayers || header.gameWidth > maxBoardWidth || header.boardHeight > maxBoardHeight)
+	{
+		std::cerr << "Replay " << replayPath << " doesn't describe a valid game" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const u16 width = (sideBuffer * 2 + header.gameWidth) * pieceSize;
+	const u16 height = (verticalBuffer * 2 + header.gameHeight + 2) * pieceSize;
+	SoftwareRenderer renderer(pieceSize, width, height);
+	Board board(header.gameWidth, header.boardHeight);
+	PieceState pieceState;
+	Blocks blocks(header.seed);
+	Game game(header.numPlayers, header.gameWidth, header.gameHeight, sideBuffer, verticalBuffer, width, height,
+		&renderer, &board, nullptr, nullptr, &pieceState, &blocks, false);
+	game.setGravity(replay.getGravity());
+
+	std::unique_ptr<FrameEncoder> encoder;
+	if (screenshotTick < 0)
+	{
+		encoder = std::make_unique<FrameEncoder>(output, format, width, height, 60, every, threadCount);
+		if (!encoder->isOpen()) return EXIT_FAILURE;
+		renderer.setFrameEncoder(encoder.get());
+	}
+
+	const auto start = std::chrono::steady_clock::now();
+	const std::vector<ReplayMove>& moves = replay.getMoves();
+	size_t nextMove = 0;
+	if (encoder != nullptr) game.renderFrame(); //The game before the first tick
+	for (u32 tick = 0; tick < header.ticks && !game.isGameOver(); ++tick)
+	{
+		if (tick == screenshotTick) break;
+		for (; nextMove < moves.size() && moves[nextMove].tick == tick; ++nextMove)
+		{
+			game.queueMove(PlayerMove{ static_cast<Move>(moves[nextMove].move), moves[nextMove].player });
+		}
+		game.tick();
+
+		if (encoder != nullptr && (tick + 1) % every == 0) game.renderFrame();
+	}
+
+	if (encoder == nullptr)
+	{
+		game.renderFrame();
+		if (!FrameEncoder::savePng(output, renderer.getPixels().data(), width, height))
+		{
+			std::cerr << "Could not write " << output << std::endl;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Wrote tick " << game.getTick() << " to " << output.string() << std::endl;
+		return EXIT_SUCCESS;
+	}
+
+	const bool written = encoder->finish();
+	const u32 frames = encoder->getFramesWritten();
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Wrote " << frames << " " << width << "x" << height << " frames to " << output.string() << " in " << seconds << "s on "
+		<< static_cast<int>(threadCount) << " threads" << std::endl;
+	return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
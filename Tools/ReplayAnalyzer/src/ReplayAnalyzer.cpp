@@ -0,0 +1,517 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "../../../Headers/Game.hpp"
+
+/**
+* Replay corpus analyzer.
+* Memory-maps a corpus of recorded games and re-simulates every game through the same Game code the real game runs, on every core.
+* The game's event bus is drained after every tick, and what it reports is added up into:
+*     heatmap.csv  How often each cell of the board was filled by a locked piece, per piece type, player and number of players
+*     levels.csv   How many games reached each level, and how long they spent there
+*     summary.csv  Totals, hole creation rate and the distribution of clear types
+* Every worker thread keeps its own totals, which are only added together at the end, so workers never contend with each other.
+*
+* A corpus is any mix of replay files, folders of replay files, and packs of replays written one after another (e.g. cat *.replay > games.pack).
+* Large packs are split between workers at replay boundaries.
+*
+* Usage: ReplayAnalyzer <corpus>... [--threads N] [--out directory]
+*/
+
+namespace
+{
+	constexpr u8 pieceTypes = 7;
+	constexpr char pieceNames[pieceTypes + 1] = "OSZLJTI"; //In the order of Blocks::m_blocks
+	constexpr u8 maxClear = 4;
+	constexpr u8 trackedLevels = 32; //Games that get further than this are counted in the last level
+	constexpr size_t packChunkSize = 1 << 20; //Packs bigger than this are split into jobs of about this size
+	constexpr double ticksPerSecond = 60;
+
+	/// <summary>
+	/// A file memory-mapped read-only for as long as the object lives
+	/// </summary>
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::filesystem::path& path)
+		{
+			std::error_code error;
+			const size_t size = static_cast<size_t>(std::filesystem::file_size(path, error));
+			if (error || size == 0) return;
+
+#ifdef _WIN32
+			HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (file == INVALID_HANDLE_VALUE) return;
+			HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			const void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			if (view == nullptr)
+			{
+				if (mapping != nullptr) CloseHandle(mapping);
+				CloseHandle(file);
+				return;
+			}
+			m_fileHandle = file;
+			m_mappingHandle = mapping;
+#else
+			const int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0) return;
+			void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (view == MAP_FAILED) return;
+			madvise(view, size, MADV_SEQUENTIAL);
+#endif
+			m_data = static_cast<const u8*>(view);
+			m_size = size;
+		}
+
+		~MappedFile()
+		{
+			if (m_data == nullptr) return;
+#ifdef _WIN32
+			UnmapViewOfFile(m_data);
+			CloseHandle(m_mappingHandle);
+			CloseHandle(m_fileHandle);
+#else
+			munmap(const_cast<u8*>(m_data), m_size);
+#endif
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const u8* data() const { return m_data; }
+		size_t size() const { return m_size; }
+	private:
+		const u8* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef _WIN32
+		void* m_fileHandle = nullptr;
+		void* m_mappingHandle = nullptr;
+#endif
+	};
+
+	/// <summary>
+	/// Everything the analyzer counts. Every worker has its own, and they are added together once every worker is done.
+	/// </summary>
+	struct Stats
+	{
+		struct Level
+		{
+			u64 games = 0; //Games that reached the level
+			u64 ticks = 0;
+			u64 pieces = 0;
+			u64 lines = 0;
+		};
+
+		u64 games = 0;
+		u64 invalidReplays = 0;
+		u64 ticks = 0;
+		u64 pieces = 0;
+		u64 lines = 0;
+		u64 holesCreated = 0;
+		u64 perfectClears = 0;
+		std::array<u64, maxClear + 1> clears{}; //Indexed by the number of lines cleared at once
+		std::array<Level, trackedLevels> levels{};
+		std::array<u8, maxPlayers> boardWidths{}; //The board width of the games with each number of players
+		std::vector<u64> heatmap = std::vector<u64>(maxPlayers * maxPlayers * pieceTypes * maxBoardHeight * maxBoardWidth);
+
+		static size_t heatmapIndex(const u8 numPlayers, const u8 player, const u8 piece, const u8 y, const u8 x)
+		{
+			return ((((numPlayers - 1) * maxPlayers + player) * pieceTypes + piece) * maxBoardHeight + y) * maxBoardWidth + x;
+		}
+
+		void add(const Stats& other)
+		{
+			games += other.games;
+			invalidReplays += other.invalidReplays;
+			ticks += other.ticks;
+			pieces += other.pieces;
+			lines += other.lines;
+			holesCreated += other.holesCreated;
+			perfectClears += other.perfectClears;
+			for (u8 clear = 0; clear <= maxClear; ++clear) clears[clear] += other.clears[clear];
+			for (u8 level = 0; level < trackedLevels; ++level)
+			{
+				levels[level].games += other.levels[level].games;
+				levels[level].ticks += other.levels[level].ticks;
+				levels[level].pieces += other.levels[level].pieces;
+				levels[level].lines += other.levels[level].lines;
+			}
+			for (u8 players = 0; players < maxPlayers; ++players) boardWidths[players] = std::max(boardWidths[players], other.boardWidths[players]);
+			for (size_t cell = 0; cell < heatmap.size(); ++cell) heatmap[cell] += other.heatmap[cell];
+		}
+	};
+
+	/// <summary>
+	/// A run of replays in one file, which one worker analyzes in one go
+	/// </summary>
+	struct Job
+	{
+		size_t file;
+		size_t begin;
+		size_t end;
+	};
+
+	/// <summary>
+	/// A worker thread's totals and the things it reuses from game to game
+	/// </summary>
+	struct Worker
+	{
+		Stats stats;
+		Replay replay;
+		EventBus eventBus;
+		EventBus::Queue* events = eventBus.subscribe();
+		PieceState pieceState;
+		Blocks blocks;
+		RotationSystem shapes = RotationSystem(&pieceState, &blocks); //For the row masks of every piece in every rotation
+	};
+
+	/// <summary>
+	/// Counts the empty cells that have a block somewhere above them in the same column
+	/// </summary>
+	u32 countHoles(const Board& board, const u8 width, const u8 height)
+	{
+		const std::vector<u8>& cells = board.getBoardData();
+		u32 holes = 0;
+		for (u8 x = 0; x < width; ++x)
+		{
+			bool covered = false;
+			for (u8 y = 0; y < height; ++y)
+			{
+				if (cells[y * width + x]) covered = true;
+				else if (covered) ++holes;
+			}
+		}
+		return holes;
+	}
+
+	/// <summary>
+	/// Plays a recorded game back and adds what happened in it to the worker's totals
+	/// </summary>
+	/// <returns>Returns false if the replay's settings aren't ones the game supports</returns>
+	bool analyzeReplay(Worker& worker)
+	{
+		const Replay& replay = worker.replay;
+		const Replay::Header& header = replay.getHeader();
+		if (header.numPlayers == 0 || header.numPlayers > maxPlayers || header.gameWidth > maxBoardWidth || header.boardHeight > maxBoardHeight
+			|| header.gameHeight > header.boardHeight) return false;
+
+		Stats& stats = worker.stats;
+		Board board(header.gameWidth, header.boardHeight);
+		Blocks blocks(header.seed);
+		Game game(header.numPlayers, header.gameWidth, header.gameHeight, sideBuffer, verticalBuffer, 0, 0,
+			nullptr, &board, nullptr, nullptr, &worker.pieceState, &blocks);
+		game.setGravity(replay.getGravity());
+		game.setEventBus(&worker.eventBus);
+
+		stats.boardWidths[header.numPlayers - 1] = std::max(stats.boardWidths[header.numPlayers - 1], header.gameWidth);
+		u8 level = std::min<u8>(game.getLevel(), trackedLevels - 1);
+		u32 levelStart = 0, holes = 0;
+		++stats.levels[level].games;
+
+		const std::vector<ReplayMove>& moves = replay.getMoves();
+		size_t nextMove = 0;
+		for (u32 tick = 0; tick < header.ticks && !game.isGameOver(); ++tick)
+		{
+			for (; nextMove < moves.size() && moves[nextMove].tick == tick; ++nextMove)
+			{
+				game.queueMove(PlayerMove{ static_cast<Move>(moves[nextMove].move), moves[nextMove].player });
+			}
+			game.tick();
+
+			bool locked = false, cleared = false;
+			GameEvent event;
+			while (worker.events->pop(event))
+			{
+				switch (event.type)
+				{
+				case GameEvent::Type::Lock:
+				{
+					locked = true;
+					++stats.pieces;
+					++stats.levels[level].pieces;
+					if (event.piece >= pieceTypes || event.player >= header.numPlayers) break;
+
+					const RotationSystem::PieceMask& mask = worker.shapes.getMask(event.piece, event.rotation);
+					for (u8 row = 0; row < mask.size(); ++row)
+					{
+						const u8 y = event.y + row;
+						for (u8 column = 0; column < 8 && y < maxBoardHeight; ++column)
+						{
+							const int x = event.x + column;
+							if ((mask[row] >> column & 1) && x >= 0 && x < header.gameWidth)
+							{
+								++stats.heatmap[Stats::heatmapIndex(header.numPlayers, event.player, event.piece, y, static_cast<u8>(x))];
+							}
+						}
+					}
+					break;
+				}
+				case GameEvent::Type::LineClear:
+					cleared = true;
+					++stats.clears[std::min(event.value, maxClear)];
+					stats.lines += event.value;
+					stats.levels[level].lines += event.value;
+					break;
+				case GameEvent::Type::LevelUp:
+				{
+					const u8 newLevel = std::min<u8>(event.value, trackedLevels - 1);
+					if (newLevel == level) break;
+					stats.levels[level].ticks += event.tick - levelStart;
+					levelStart = event.tick;
+					level = newLevel;
+					++stats.levels[level].games;
+					break;
+				}
+				default:
+					break;
+				}
+			}
+
+			if (locked)
+			{
+				//Holes only appear when a piece locks. Clears can take them away again, so only the increases are counted.
+				const u32 newHoles = countHoles(board, header.gameWidth, header.gameHeight);
+				if (newHoles > holes) stats.holesCreated += newHoles - holes;
+				holes = newHoles;
+			}
+			if (cleared && board.getStackHeight() == 0) ++stats.perfectClears;
+		}
+
+		stats.levels[level].ticks += game.getTick() - levelStart;
+		stats.ticks += game.getTick();
+		++stats.games;
+		return true;
+	}
+
+	void processJob(const Job& job, const std::filesystem::path& path, Worker& worker)
+	{
+		const MappedFile file(path);
+		if (file.data() == nullptr)
+		{
+			std::cerr << "Could not map " << path << std::endl;
+			return;
+		}
+
+		const size_t end = std::min(job.end, file.size());
+		for (size_t offset = job.begin; offset < end;)
+		{
+			const size_t replaySize = worker.replay.loadFromMemory(file.data() + offset, file.size() - offset);
+			if (replaySize == 0)
+			{
+				//Nothing after a broken replay can be trusted to start on a replay boundary
+				++worker.stats.invalidReplays;
+				return;
+			}
+			if (!analyzeReplay(worker)) ++worker.stats.invalidReplays;
+			offset += replaySize;
+		}
+	}
+
+	/// <summary>
+	/// Splits a file into jobs. Small files are one job. Big packs are walked header by header and cut at replay boundaries.
+	/// </summary>
+	void addJobs(const size_t fileIndex, const std::filesystem::path& path, std::vector<Job>& jobs)
+	{
+		std::error_code error;
+		const size_t size = static_cast<size_t>(std::filesystem::file_size(path, error));
+		if (error || size == 0) return;
+		if (size <= packChunkSize)
+		{
+			jobs.push_back(Job{ fileIndex, 0, size });
+			return;
+		}
+
+		const MappedFile file(path);
+		if (file.data() == nullptr) return;
+		size_t begin = 0, offset = 0;
+		while (offset < size)
+		{
+			const size_t replaySize = Replay::measure(file.data() + offset, size - offset);
+			if (replaySize == 0) break;
+			offset += replaySize;
+			if (offset - begin >= packChunkSize)
+			{
+				jobs.push_back(Job{ fileIndex, begin, offset });
+				begin = offset;
+			}
+		}
+		//Whatever is left, including anything broken, goes to the last job so it is reported as an invalid replay
+		if (begin < size) jobs.push_back(Job{ fileIndex, begin, size });
+	}
+
+	bool writeHeatmap(const std::filesystem::path& path, const Stats& stats)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		file << "players,player,piece,row";
+		for (u8 x = 0; x < maxBoardWidth; ++x) file << ",c" << static_cast<int>(x);
+		file << '\n';
+		for (u8 numPlayers = 1; numPlayers <= maxPlayers; ++numPlayers)
+		{
+			const u8 width = stats.boardWidths[numPlayers - 1];
+			for (u8 player = 0; player < numPlayers && width > 0; ++player)
+			{
+				for (u8 piece = 0; piece < pieceTypes; ++piece)
+				{
+					const auto first = stats.heatmap.begin() + Stats::heatmapIndex(numPlayers, player, piece, 0, 0);
+					if (std::all_of(first, first + maxBoardHeight * maxBoardWidth, [](const u64 count) { return count == 0; })) continue;
+
+					for (u8 y = 0; y < maxBoardHeight; ++y)
+					{
+						file << static_cast<int>(numPlayers) << ',' << player + 1 << ',' << pieceNames[piece] << ',' << static_cast<int>(y);
+						for (u8 x = 0; x < width; ++x) file << ',' << stats.heatmap[Stats::heatmapIndex(numPlayers, player, piece, y, x)];
+						file << '\n';
+					}
+				}
+			}
+		}
+		return file.good();
+	}
+
+	bool writeLevels(const std::filesystem::path& path, const Stats& stats)
+	{
+		std::ofstream file(path, std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		file << "level,games,pieces,lines,average seconds,average ticks per piece\n";
+		for (u8 level = 0; level < trackedLevels; ++level)
+		{
+			const Stats::Level& totals = stats.levels[level];
+			if (totals.games == 0) continue;
+			file << level + 1 << (level == trackedLevels - 1 ? "+," : ",") << totals.games << ',' << totals.pieces << ',' << totals.lines << ','
+				<< totals.ticks / ticksPerSecond / totals.games << ',' << (totals.pieces > 0 ? static_cast<double>(totals.ticks) / totals.pieces : 0) << '\n';
+		}
+		return file.good();
+	}
+
+	bool writeSummary(std::ostream& file, const Stats& stats)
+	{
+		constexpr const char* clearNames[maxClear + 1] = { "none", "single", "double", "triple", "tetris" };
+		u64 totalClears = 0;
+		for (u8 clear = 1; clear <= maxClear; ++clear) totalClears += stats.clears[clear];
+
+		file << "metric,value\n";
+		file << "games," << stats.games << '\n';
+		file << "invalid replays," << stats.invalidReplays << '\n';
+		file << "hours played," << stats.ticks / ticksPerSecond / 3600 << '\n';
+		file << "pieces," << stats.pieces << '\n';
+		file << "lines," << stats.lines << '\n';
+		file << "holes created," << stats.holesCreated << '\n';
+		file << "holes created per piece," << (stats.pieces > 0 ? static_cast<double>(stats.holesCreated) / stats.pieces : 0) << '\n';
+		for (u8 clear = 1; clear <= maxClear; ++clear)
+		{
+			file << clearNames[clear] << " clears," << stats.clears[clear] << '\n';
+			file << clearNames[clear] << " share," << (totalClears > 0 ? static_cast<double>(stats.clears[clear]) / totalClears : 0) << '\n';
+		}
+		file << "perfect clears," << stats.perfectClears << '\n';
+		return file.good();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::filesystem::path> corpus;
+	std::filesystem::path outDirectory = "analysis";
+	unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threadCount = std::max(1, std::stoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) outDirectory = argv[++i];
+		else corpus.push_back(argv[i]);
+	}
+	if (corpus.empty())
+	{
+		std::cerr << "Usage: ReplayAnalyzer <corpus>... [--threads N] [--out directory]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::filesystem::path> files;
+	for (const std::filesystem::path& path : corpus)
+	{
+		std::error_code error;
+		if (!std::filesystem::is_directory(path, error))
+		{
+			files.push_back(path);
+			continue;
+		}
+		for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(path, error))
+		{
+			if (entry.is_regular_file() && entry.path().extension() == ".replay") files.push_back(entry.path());
+		}
+	}
+	std::sort(files.begin(), files.end());
+
+	std::vector<Job> jobs;
+	for (size_t file = 0; file < files.size(); ++file) addJobs(file, files[file], jobs);
+	if (jobs.empty())
+	{
+		std::cerr << "No replays found" << std::endl;
+		return EXIT_FAILURE;
+	}
+	//The biggest jobs go first, so a pack chunk isn't the last thing left running on one core
+	std::stable_sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.end - a.begin > b.end - b.begin; });
+
+	const auto start = std::chrono::steady_clock::now();
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+	std::atomic<size_t> nextJob = 0;
+	for (unsigned i = 0; i < std::min<size_t>(threadCount, jobs.size()); ++i)
+	{
+		workers.push_back(std::make_unique<Worker>());
+		threads.emplace_back([&, worker = workers.back().get()]()
+		{
+			for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+			{
+				processJob(jobs[job], files[jobs[job].file], *worker);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	Stats totals;
+	for (const std::unique_ptr<Worker>& worker : workers)
+	{
+		totals.add(worker->stats);
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::error_code error;
+	std::filesystem::create_directories(outDirectory, error);
+	std::ofstream summary(outDirectory / "summary.csv", std::ios::trunc);
+	if (!writeHeatmap(outDirectory / "heatmap.csv", totals) || !writeLevels(outDirectory / "levels.csv", totals) || !writeSummary(summary, totals))
+	{
+		std::cerr << "Error writing the results to " << outDirectory << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << totals.games << " games (" << totals.invalidReplays << " invalid) in " << seconds << "s on " << threads.size() << " threads, "
+		<< totals.games / std::max(seconds, 1e-9) << " games/s" << std::endl;
+	std::cout << totals.pieces << " pieces, " << totals.lines << " lines, " << static_cast<double>(totals.holesCreated) / std::max<u64>(totals.pieces, 1)
+		<< " holes created per piece. Results written to " << outDirectory << std::endl;
+	return totals.games > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../../Headers/Game.hpp"
+
+/**
+* Golden-replay regression runner.
+* Replays every recorded game in a directory headlessly, through the same Game code the real game runs, and compares the result against
+* the stored golden file next to it. A golden file holds the final board, lines and level, plus a state hash for every tick so the first
+* tick where a replay diverges can be reported. Every tick it also checks the game's incremental state hash against one worked out from scratch,
+* so a change that forgets to update the hash is caught at the tick it first happens.
+*
+* Usage: ReplayRunner <replay directory> [--update] [--threads N] [--no-alloc]
+*     --update    Write (or overwrite) the golden files from the current game logic instead of checking against them
+*     --no-alloc  Also fail any replay whose ticks allocate heap memory. Needs a build with TETRIS_TRACK_ALLOCATIONS
+*/
+
+namespace
+{
+	struct GoldenHeader
+	{
+		u32 magic;
+		u16 version;
+		u8 gameWidth;
+		u8 boardHeight;
+		u32 lines;
+		u32 level;
+		u32 ticks;
+	};
+	constexpr u32 goldenMagic = 0x444C4754; //"TGLD"
+	constexpr u16 goldenVersion = 2; //Version 2 hashes the state with Zobrist keys
+
+	/// <summary>
+	/// The outcome of replaying one game
+	/// </summary>
+	struct ReplayResult
+	{
+		std::vector<u8> board;
+		std::vector<u64> tickHashes;
+		u32 lines = 0;
+		u32 level = 0;
+		u64 tickAllocations = 0;
+		u32 firstAllocatingTick = 0;
+		bool hashDrifted = false;
+		u32 hashDriftTick = 0;
+	};
+
+	enum class Status { Passed, Failed, Updated, Error };
+
+	struct Job
+	{
+		std::filesystem::path replayPath;
+		Status status = Status::Error;
+		std::string message;
+	};
+
+	/// <summary>
+	/// Plays a recorded game back tick by tick, feeding in the recorded moves at the ticks they were originally applied
+	/// </summary>
+	bool runReplay(const Replay& replay, ReplayResult& result)
+	{
+		const Replay::Header& header = replay.getHeader();
+		if (header.numPlayers == 0 || header.numPlayers > maxPlayers || header.gameWidth > maxBoardWidth || header.boardHeight > maxBoardHeight) return false;
+
+		Board board(header.gameWidth, header.boardHeight);
+		PieceState pieceState;
+		Blocks blocks(header.seed);
+		Game game(header.numPlayers, header.gameWidth, header.gameHeight, sideBuffer, verticalBuffer, 0, 0,
+			nullptr, &board, nullptr, nullptr, &pieceState, &blocks);
+		game.setGravity(replay.getGravity());
+
+		const std::vector<ReplayMove>& moves = replay.getMoves();
+		size_t nextMove = 0;
+		result.tickHashes.reserve(header.ticks);
+		for (u32 tick = 0; tick < header.ticks && !game.isGameOver(); ++tick)
+		{
+			for (; nextMove < moves.size() && moves[nextMove].tick == tick; ++nextMove)
+			{
+				game.queueMove(PlayerMove{ static_cast<Move>(moves[nextMove].move), moves[nextMove].player });
+			}
+			const u64 allocations = AllocationTracker::getThreadAllocations();
+			game.tick();
+			const u64 tickAllocations = AllocationTracker::getThreadAllocations() - allocations;
+			if (tickAllocations > 0 && result.tickAllocations == 0) result.firstAllocatingTick = tick;
+			result.tickAllocations += tickAllocations;
+			result.tickHashes.push_back(game.getStateHash());
+			if (!result.hashDrifted && !game.isStateHashValid())
+			{
+				result.hashDrifted = true;
+				result.hashDriftTick = tick;
+			}
+		}
+
+		result.board = board.getBoardData();
+		result.lines = game.getLines();
+		result.level = game.getLevel();
+		return true;
+	}
+
+	bool writeGolden(const std::filesystem::path& path, const Replay::Header& replayHeader, const ReplayResult& result)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return false;
+
+		const GoldenHeader header{ goldenMagic, goldenVersion, replayHeader.gameWidth, replayHeader.boardHeight, result.lines, result.level, static_cast<u32>(result.tickHashes.size()) };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(result.board.data()), result.board.size());
+		file.write(reinterpret_cast<const char*>(result.tickHashes.data()), result.tickHashes.size() * sizeof(u64));
+		return file.good();
+	}
+
+	bool readGolden(const std::filesystem::path& path, ReplayResult& golden)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) return false;
+
+		GoldenHeader header;
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+		if (header.magic != goldenMagic) return false;
+		if (header.version != goldenVersion)
+		{
+			std::cerr << path.filename().string() << " is a version " << header.version << " golden file, regenerate it with --update" << std::endl;
+			return false;
+		}
+
+		golden.board.resize(header.gameWidth * header.boardHeight);
+		golden.tickHashes.resize(header.ticks);
+		golden.lines = header.lines;
+		golden.level = header.level;
+		file.read(reinterpret_cast<char*>(golden.board.data()), golden.board.size());
+		file.read(reinterpret_cast<char*>(golden.tickHashes.data()), golden.tickHashes.size() * sizeof(u64));
+		return file.good();
+	}
+
+	/// <summary>
+	/// Compares a replay result to its golden result and describes the first difference
+	/// </summary>
+	/// <returns>Returns true if they match</returns>
+	bool compareToGolden(const ReplayResult& result, const ReplayResult& golden, std::string& message)
+	{
+		const size_t commonTicks = std::min(result.tickHashes.size(), golden.tickHashes.size());
+		const auto mismatch = std::mismatch(result.tickHashes.begin(), result.tickHashes.begin() + commonTicks, golden.tickHashes.begin());
+		const size_t divergedTick = mismatch.first - result.tickHashes.begin();
+
+		if (divergedTick < commonTicks)
+		{
+			message = "diverged at tick " + std::to_string(divergedTick);
+		}
+		else if (result.tickHashes.size() != golden.tickHashes.size())
+		{
+			message = "game lasted " + std::to_string(result.tickHashes.size()) + " ticks, expected " + std::to_string(golden.tickHashes.size())
+				+ " (diverged at tick " + std::to_string(commonTicks) + ")";
+		}
+		else if (result.board != golden.board)
+		{
+			message = "final board differs";
+		}
+		else if (result.lines != golden.lines || result.level != golden.level)
+		{
+			message = "final lines/level differ";
+		}
+		else
+		{
+			return true;
+		}
+		message += " - lines " + std::to_string(result.lines) + " (expected " + std::to_string(golden.lines) + "), level "
+			+ std::to_string(result.level + 1) + " (expected " + std::to_string(golden.level + 1) + ")";
+		return false;
+	}
+
+	void processJob(Job& job, const bool update, const bool noAlloc)
+	{
+		Replay replay;
+		ReplayResult result;
+		if (!replay.loadFromFile(job.replayPath) || !runReplay(replay, result))
+		{
+			job.message = "could not read replay";
+			return;
+		}
+
+		if (result.hashDrifted)
+		{
+			job.status = Status::Failed;
+			job.message = "incremental state hash drifted at tick " + std::to_string(result.hashDriftTick);
+			return;
+		}
+
+		std::filesystem::path goldenPath = job.replayPath;
+		goldenPath.replace_extension(".golden");
+		if (update)
+		{
+			job.status = writeGolden(goldenPath, replay.getHeader(), result) ? Status::Updated : Status::Error;
+			if (job.status == Status::Error) job.message = "could not write golden file";
+			return;
+		}
+
+		ReplayResult golden;
+		if (!readGolden(goldenPath, golden))
+		{
+			job.message = "missing or unreadable golden file";
+			return;
+		}
+		job.status = compareToGolden(result, golden, job.message) ? Status::Passed : Status::Failed;
+		if (job.status == Status::Passed && noAlloc && result.tickAllocations > 0)
+		{
+			job.status = Status::Failed;
+			job.message = std::to_string(result.tickAllocations) + " allocations during ticks, starting at tick " + std::to_string(result.firstAllocatingTick);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: ReplayRunner <replay directory> [--update] [--threads N] [--no-alloc]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::filesystem::path directory = argv[1];
+	bool update = false, noAlloc = false;
+	unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+	for (int i = 2; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--update") == 0) update = true;
+		else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threadCount = std::max(1, std::stoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--no-alloc") == 0) noAlloc = true;
+	}
+	if (noAlloc && !AllocationTracker::enabled)
+	{
+		std::cerr << "--no-alloc needs a build with TETRIS_TRACK_ALLOCATIONS" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<Job> jobs;
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		if (entry.is_regular_file() && entry.path().extension() == ".replay")
+		{
+			jobs.push_back(Job{ entry.path() });
+		}
+	}
+	if (error || jobs.empty())
+	{
+		std::cerr << "No replays found in " << directory << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.replayPath < b.replayPath; });
+
+	const auto start = std::chrono::steady_clock::now();
+	std::atomic<size_t> nextJob = 0;
+	std::vector<std::thread> workers;
+	for (unsigned i = 0; i < std::min<size_t>(threadCount, jobs.size()); ++i)
+	{
+		workers.emplace_back([&]()
+		{
+			for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+			{
+				processJob(jobs[job], update, noAlloc);
+			}
+		});
+	}
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	size_t passed = 0, failed = 0;
+	for (const Job& job : jobs)
+	{
+		switch (job.status)
+		{
+		case Status::Passed:
+			++passed;
+			break;
+		case Status::Updated:
+			++passed;
+			std::cout << "UPDATED " << job.replayPath.filename().string() << std::endl;
+			break;
+		case Status::Failed:
+			++failed;
+			std::cout << "FAILED  " << job.replayPath.filename().string() << ": " << job.message << std::endl;
+			break;
+		case Status::Error:
+			++failed;
+			std::cout << "ERROR   " << job.replayPath.filename().string() << ": " << job.message << std::endl;
+			break;
+		}
+	}
+	if (noAlloc && failed > 0) AllocationTracker::report(std::cout);
+	std::cout << passed << " passed, " << failed << " failed, " << jobs.size() << " replays in " << seconds << "s on " << workers.size() << " threads" << std::endl;
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,101 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../../../Headers/SpectatorFeedLayout.hpp"
+
+/**
+* A reference reader for the shared-memory spectator feed.
+* Attaches read-only, checks the layout version, and prints the board every time a new tick is published.
+*
+* Usage: SpectatorReader [feed name] [--once]
+*/
+
+/// <summary>
+/// Prints the frame as text. Locked cells show their player number, falling pieces are not drawn.
+/// </summary>
+static void printFrame(const SpectatorFeedLayout::Frame& frame)
+{
+	char hash[17];
+	std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(frame.stateHash));
+	std::string out = "Tick " + std::to_string(frame.tick) + "  Hash " + hash + "  Level " + std::to_string(frame.level + 1) + "  Lines " + std::to_string(frame.lines) + (frame.gameOver ? "  GAME OVER" : "") + "\n";
+	for (std::uint8_t playerIndex = 0; playerIndex < frame.numPlayers; ++playerIndex)
+	{
+		const SpectatorFeedLayout::Player& player = frame.players[playerIndex];
+		out += "P" + std::to_string(playerIndex + 1) + " piece " + std::to_string(player.piece) + " rot " + std::to_string(player.rotation)
+			+ " at (" + std::to_string(player.xOffset) + ", " + std::to_string(player.yOffset) + ") next " + std::to_string(player.nextPiece)
+			+ " held " + (player.heldPiece == SpectatorFeedLayout::noPiece ? std::string("-") : std::to_string(player.heldPiece)) + "\n";
+	}
+	for (std::uint8_t y = 0; y < frame.boardHeight; ++y)
+	{
+		out += '|';
+		for (std::uint8_t x = 0; x < frame.boardWidth; ++x)
+		{
+			const std::uint8_t cell = frame.board[y * frame.boardWidth + x];
+			out += cell ? static_cast<char>('0' + cell) : '.';
+		}
+		out += "|\n";
+	}
+	std::cout << out << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+	std::string name = SpectatorFeedLayout::defaultName;
+	bool once = false;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--once") == 0) once = true;
+		else name = argv[i];
+	}
+
+	const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		std::cerr << "Could not open spectator feed " << name << ". Is the game running?" << std::endl;
+		return EXIT_FAILURE;
+	}
+	void* memory = mmap(nullptr, sizeof(SpectatorFeedLayout::Feed), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		std::cerr << "Could not map spectator feed " << name << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const SpectatorFeedLayout::Feed& feed = *static_cast<const SpectatorFeedLayout::Feed*>(memory);
+	if (feed.header.magic != SpectatorFeedLayout::feedMagic || feed.header.version != SpectatorFeedLayout::feedVersion
+		|| feed.header.frameSize != sizeof(SpectatorFeedLayout::Frame))
+	{
+		std::cerr << "Spectator feed " << name << " has version " << feed.header.version << ", this reader expects version " << SpectatorFeedLayout::feedVersion << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	SpectatorFeedLayout::Frame frame{};
+	std::uint64_t lastFrame = 0;
+	while (true)
+	{
+		const std::uint64_t frameNumber = SpectatorFeedLayout::readLatest(feed, frame);
+		if (frameNumber != 0 && frameNumber != lastFrame)
+		{
+			if (frameNumber > lastFrame + 1 && lastFrame != 0)
+			{
+				std::cout << "(skipped " << frameNumber - lastFrame - 1 << " frames)" << std::endl;
+			}
+			printFrame(frame);
+			lastFrame = frameNumber;
+			if (once) break;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	munmap(memory, sizeof(SpectatorFeedLayout::Feed));
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../../Headers/LockstepSimulator.hpp"
+
+/**
+* Plays a heuristic bot through many single player games with the lockstep simulator, for each set of weights given, to compare them.
+* The bot tries every placement of its piece (and of the piece holding would bring out) and plays the one whose board scores best:
+*     height * aggregate height + lines * lines cleared + holes * holes + bumpiness * bumpiness
+* Every weight set plays the same games, seeds seed to seed + games - 1, so the results differ only by the weights.
+* Games end when the bot tops out or after the piece limit.
+*
+* Usage: SweepRunner [--weights height,lines,holes,bumpiness]... [--games N] [--seed N] [--pieces N] [--threads N] [--no-hold]
+*/
+
+namespace
+{
+	struct Weights
+	{
+		float height = -0.510066f;
+		float lines = 0.760666f;
+		float holes = -0.35663f;
+		float bumpiness = -0.184483f;
+	};
+
+	struct Settings
+	{
+		u32 games = 1000;
+		u32 seed = 1;
+		u64 pieceLimit = 10000;
+		bool hold = true;
+	};
+
+	struct Results
+	{
+		u32 games = 0;
+		u32 toppedOut = 0;
+		u64 lines = 0;
+		u64 pieces = 0;
+		u64 trials = 0; //Placements tried in every lane
+	};
+
+	/// <summary>
+	/// Picks the placement that leaves the best scoring board in every lane
+	/// </summary>
+	void choosePlacements(const LockstepSimulator& simulator, const Weights& weights, const bool hold, LockstepSimulator::Actions& actions, Results& results)
+	{
+		std::array<float, LockstepSimulator::lanes> bestScores;
+		bestScores.fill(-std::numeric_limits<float>::infinity());
+		LockstepSimulator::Actions candidates;
+		LockstepSimulator::Trial trial;
+		LockstepSimulator::Features features;
+		for (u8 holdFirst = 0; holdFirst <= (hold ? 1 : 0); ++holdFirst)
+		{
+			for (u8 rotation = 0; rotation < 4; ++rotation)
+			{
+				for (s8 x = LockstepSimulator::minColumn + 1; x < simulator.getWidth(); ++x)
+				{
+					candidates.fill(LockstepSimulator::Action{ rotation, x, holdFirst == 1 });
+					simulator.tryPlacements(candidates, trial);
+					if (trial.placed == 0) continue;
+
+					simulator.getFeatures(trial.boards, features);
+					++results.trials;
+					for (u8 lane = 0; lane < LockstepSimulator::lanes; ++lane)
+					{
+						if ((trial.placed >> lane & 1) == 0) continue;
+
+						const float score = weights.height * features.aggregateHeight[lane] + weights.lines * trial.linesCleared[lane]
+							+ weights.holes * features.holes[lane] + weights.bumpiness * features.bumpiness[lane];
+						if (score > bestScores[lane])
+						{
+							bestScores[lane] = score;
+							actions[lane] = candidates[lane];
+						}
+					}
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Plays games until there are none left to start, refilling every lane whose game ended with the next game
+	/// </summary>
+	void playGames(LockstepSimulator& simulator, const Weights& weights, const Settings& settings, std::atomic<u32>& nextGame, Results& results)
+	{
+		const auto startGame = [&](const u8 lane)
+		{
+			const u32 game = nextGame.fetch_add(1);
+			if (game < settings.games) simulator.resetLane(lane, settings.seed + game);
+			else simulator.stopLane(lane);
+		};
+		for (u8 lane = 0; lane < LockstepSimulator::lanes; ++lane) startGame(lane);
+
+		LockstepSimulator::Actions actions;
+		while (simulator.getPlayingLanes() != 0)
+		{
+			choosePlacements(simulator, weights, settings.hold, actions, results);
+			const u32 wasPlaying = simulator.getPlayingLanes();
+			simulator.step(actions);
+
+			for (u8 lane = 0; lane < LockstepSimulator::lanes; ++lane)
+			{
+				if ((wasPlaying >> lane & 1) == 0) continue;
+
+				const LockstepSimulator::Lane& game = simulator.getLane(lane);
+				if (game.playing && game.pieces < settings.pieceLimit) continue;
+
+				++results.games;
+				if (!game.playing) ++results.toppedOut;
+				results.lines += game.lines;
+				results.pieces += game.pieces;
+				startGame(lane);
+			}
+		}
+	}
+
+	bool parseWeights(const char* const text, Weights& weights)
+	{
+		std::istringstream stream(text);
+		char comma1 = 0, comma2 = 0, comma3 = 0;
+		stream >> weights.height >> comma1 >> weights.lines >> comma2 >> weights.holes >> comma3 >> weights.bumpiness;
+		return !stream.fail() && comma1 == ',' && comma2 == ',' && comma3 == ',';
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Settings settings;
+	u32 threadCount = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<Weights> weightSets;
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--no-hold") == 0) settings.hold = false;
+		else if (std::strcmp(argv[i], "--games") == 0 && hasValue) settings.games = static_cast<u32>(std::stoul(argv[++i]));
+		else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) settings.seed = static_cast<u32>(std::stoul(argv[++i]));
+		else if (std::strcmp(argv[i], "--pieces") == 0 && hasValue) settings.pieceLimit = std::stoull(argv[++i]);
+		else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) threadCount = std::max(1, std::stoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--weights") == 0 && hasValue)
+		{
+			Weights weights;
+			if (!parseWeights(argv[++i], weights))
+			{
+				std::cerr << "Weights are four numbers separated by commas: height,lines,holes,bumpiness" << std::endl;
+				return EXIT_FAILURE;
+			}
+			weightSets.push_back(weights);
+		}
+		else
+		{
+			std::cerr << "Usage: SweepRunner [--weights height,lines,holes,bumpiness]... [--games N] [--seed N] [--pieces N] [--threads N] [--no-hold]" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	if (weightSets.empty()) weightSets.push_back(Weights());
+
+	//The board size of a single player game
+	constexpr u8 gameWidth = 10, gameHeight = 20;
+	PieceState pieceState;
+	const Blocks blocks;
+	std::vector<std::unique_ptr<LockstepSimulator>> simulators;
+	for (u32 thread = 0; thread < threadCount; ++thread)
+	{
+		simulators.push_back(std::make_unique<LockstepSimulator>(&pieceState, &blocks, gameWidth, gameHeight));
+	}
+	std::cout << settings.games << " games per weight set, " << threadCount << " threads, " << LockstepSimulator::lanes << " "
+		<< LockstepSimulator::getInstructionSet() << " lanes each" << std::endl;
+
+	for (const Weights& weights : weightSets)
+	{
+		std::atomic<u32> nextGame = 0;
+		std::mutex resultsMutex;
+		Results total;
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (u32 thread = 0; thread < threadCount; ++thread)
+		{
+			threads.emplace_back([&, thread]()
+			{
+				Results results;
+				playGames(*simulators[thread], weights, settings, nextGame, results);
+				std::lock_guard lock(resultsMutex);
+				total.games += results.games;
+				total.toppedOut += results.toppedOut;
+				total.lines += results.lines;
+				total.pieces += results.pieces;
+				total.trials += results.trials;
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		const double games = std::max(1u, total.games);
+		std::cout << std::fixed << std::setprecision(3) << "weights " << weights.height << "," << weights.lines << "," << weights.holes << "," << weights.bumpiness
+			<< std::setprecision(1) << ": " << total.lines / games << " lines and " << total.pieces / games << " pieces per game, "
+			<< total.toppedOut << " of " << total.games << " topped out. " << std::setprecision(0) << total.pieces / seconds << " placements/s, "
+			<< total.trials * LockstepSimulator::lanes / seconds << " boards scored/s" << std::endl;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+* A minimal engine for the bot protocol described in Headers/BotPlayer.hpp, for trying bots out and testing the protocol.
+* Tries every rotation and column for the current piece, drops it straight down, and picks the placement that leaves the best board
+* by a few classic measures: lines cleared, total column height, holes, and how bumpy the surface is. It never holds.
+* With other players on the board it prefers to stay in its own share of the columns, so the bots don't all pile into the same spot.
+*
+* Usage: Tetris --bot 2 ./TrivialBot
+*/
+
+namespace
+{
+	struct Shape
+	{
+		int size = 0;
+		std::vector<bool> cells;
+
+		/// <summary>
+		/// Whether the cell at x, y is filled with the shape turned clockwise the given number of times, matching PieceState::getPieceData
+		/// </summary>
+		bool isFilled(const int x, const int y, const int rotation) const
+		{
+			switch (rotation)
+			{
+			case 0: return cells[y * size + x];
+			case 1: return cells[(size - x - 1) * size + y];
+			case 2: return cells[(size - y - 1) * size + (size - x - 1)];
+			default: return cells[size * x + (size - y - 1)];
+			}
+		}
+	};
+
+	struct Engine
+	{
+		int width = 0, height = 0;
+		std::vector<bool> board;
+		std::vector<Shape> shapes;
+		int player = 0, players = 1;
+		int piece = 0, pieceY = 0;
+
+		bool isBlocked(const std::vector<bool>& cells, const Shape& shape, const int rotation, const int x, const int y) const
+		{
+			for (int cellY = 0; cellY < shape.size; ++cellY)
+			{
+				for (int cellX = 0; cellX < shape.size; ++cellX)
+				{
+					if (!shape.isFilled(cellX, cellY, rotation)) continue;
+					const int boardX = x + cellX, boardY = y + cellY;
+					if (boardX < 0 || boardX >= width || boardY >= height || (boardY >= 0 && cells[boardY * width + boardX])) return true;
+				}
+			}
+			return false;
+		}
+
+		/// <summary>
+		/// Drops the piece straight down at x and scores the board it leaves. Higher is better.
+		/// </summary>
+		/// <returns>Returns false if the piece doesn't fit at x at all</returns>
+		bool scorePlacement(const Shape& shape, const int rotation, const int x, double& score) const
+		{
+			if (isBlocked(board, shape, rotation, x, pieceY)) return false;
+			int y = pieceY;
+			while (!isBlocked(board, shape, rotation, x, y + 1)) ++y;
+
+			const int laneStart = player * width / players, laneEnd = (player + 1) * width / players;
+			int outsideLane = 0;
+			std::vector<bool> cells = board;
+			for (int cellY = 0; cellY < shape.size; ++cellY)
+			{
+				for (int cellX = 0; cellX < shape.size; ++cellX)
+				{
+					if (!shape.isFilled(cellX, cellY, rotation)) continue;
+					if (y + cellY >= 0) cells[(y + cellY) * width + x + cellX] = true;
+					if (x + cellX < laneStart || x + cellX >= laneEnd) ++outsideLane;
+				}
+			}
+
+			int lines = 0;
+			for (int row = height - 1; row >= 0; --row)
+			{
+				bool full = true;
+				for (int column = 0; column < width && full; ++column) full = cells[row * width + column];
+				if (!full) continue;
+				cells.erase(cells.begin() + row * width, cells.begin() + (row + 1) * width);
+				cells.insert(cells.begin(), width, false);
+				++lines;
+				++row;
+			}
+
+			int totalHeight = 0, holes = 0, bumpiness = 0, lastHeight = -1;
+			for (int column = 0; column < width; ++column)
+			{
+				int columnHeight = 0;
+				for (int row = 0; row < height; ++row)
+				{
+					if (cells[row * width + column])
+					{
+						if (columnHeight == 0) columnHeight = height - row;
+					}
+					else if (columnHeight > 0)
+					{
+						++holes;
+					}
+				}
+				totalHeight += columnHeight;
+				if (lastHeight >= 0) bumpiness += std::abs(columnHeight - lastHeight);
+				lastHeight = columnHeight;
+			}
+			score = 0.76 * lines - 0.51 * totalHeight - 0.36 * holes - 0.18 * bumpiness - 0.3 * outsideLane;
+			return true;
+		}
+
+		void answer(const std::string& turn) const
+		{
+			const Shape& shape = shapes[piece];
+			double bestScore = 0;
+			int bestRotation = -1, bestX = 0;
+			for (int rotation = 0; rotation < 4; ++rotation)
+			{
+				for (int x = -shape.size; x < width; ++x)
+				{
+					double score;
+					if (scorePlacement(shape, rotation, x, score) && (bestRotation < 0 || score > bestScore))
+					{
+						bestScore = score;
+						bestRotation = rotation;
+						bestX = x;
+					}
+				}
+			}
+			if (bestRotation < 0) std::cout << "keys " << turn << " X" << std::endl;
+			else std::cout << "place " << turn << ' ' << bestRotation << ' ' << bestX << std::endl;
+		}
+	};
+}
+
+int main()
+{
+	std::ios::sync_with_stdio(false);
+	Engine engine;
+	std::string line;
+	while (std::getline(std::cin, line))
+	{
+		std::istringstream message(line);
+		std::string command;
+		message >> command;
+		if (command == "rules")
+		{
+			message >> engine.width >> engine.height >> engine.player >> engine.players;
+			engine.board.assign(engine.width * engine.height, false);
+			engine.shapes.clear();
+		}
+		else if (command == "shape")
+		{
+			int type;
+			Shape shape;
+			std::string cells;
+			message >> type >> shape.size >> cells;
+			for (const char cell : cells) shape.cells.push_back(cell == '1');
+			if (type >= static_cast<int>(engine.shapes.size())) engine.shapes.resize(type + 1);
+			engine.shapes[type] = shape;
+		}
+		else if (command == "start")
+		{
+			std::cout << "ready TrivialBot" << std::endl;
+		}
+		else if (command == "row")
+		{
+			int y;
+			std::string cells;
+			message >> y >> cells;
+			for (int x = 0; x < engine.width && x < static_cast<int>(cells.size()); ++x) engine.board[y * engine.width + x] = cells[x] != '.';
+		}
+		else if (command == "piece")
+		{
+			int rotation, x;
+			message >> engine.piece >> rotation >> x >> engine.pieceY;
+		}
+		else if (command == "go")
+		{
+			std::string turn;
+			message >> turn;
+			engine.answer(turn);
+		}
+		else if (command == "quit")
+		{
+			break;
+		}
+	}
+	return 0;
+}
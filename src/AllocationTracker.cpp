@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <malloc.h>
+#define TETRIS_RETURN_ADDRESS() _ReturnAddress()
+#else
+#include <dlfcn.h>
+#define TETRIS_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+#include "../Headers/AllocationTracker.hpp"
+
+//Everything here is constant initialized, so allocations made before main (or by other static constructors) are counted safely
+AllocationTracker::PhaseCounters AllocationTracker::m_phases[AllocationTracker::phaseCount];
+AllocationTracker::CallSiteSlot AllocationTracker::m_callSites[AllocationTracker::callSiteSlots];
+std::atomic<u64> AllocationTracker::m_droppedCallSites = 0;
+thread_local AllocationPhase AllocationTracker::t_phase = AllocationPhase::Other;
+thread_local u64 AllocationTracker::t_allocations = 0;
+
+AllocationTracker::Scope::Scope(const AllocationPhase phase) : m_previous(t_phase)
+{
+	t_phase = phase;
+}
+
+AllocationTracker::Scope::~Scope()
+{
+	t_phase = m_previous;
+}
+
+/// <summary>
+/// Counts an allocation against the calling thread's phase and the call site. Called from operator new, so it must never allocate.
+/// </summary>
+/// <param name="size">The size of the allocation in bytes</param>
+/// <param name="callSite">The return address of operator new</param>
+void AllocationTracker::recordAllocation(const std::size_t size, const void* const callSite)
+{
+	PhaseCounters& phase = m_phases[static_cast<size_t>(t_phase)];
+	phase.allocations.fetch_add(1, std::memory_order_relaxed);
+	phase.bytes.fetch_add(size, std::memory_order_relaxed);
+	++t_allocations;
+
+	size_t slot = static_cast<size_t>(static_cast<u64>(reinterpret_cast<std::uintptr_t>(callSite)) * 0x9E3779B97F4A7C15ull >> (64 - callSiteBits)); //Fibonacci hashing
+	for (size_t probe = 0; probe < callSiteSlots; ++probe, slot = (slot + 1) & (callSiteSlots - 1))
+	{
+		CallSiteSlot& site = m_callSites[slot];
+		const void* address = site.address.load(std::memory_order_acquire);
+		if (address == nullptr)
+		{
+			if (site.address.compare_exchange_strong(address, callSite, std::memory_order_acq_rel))
+			{
+				site.phase.store(static_cast<u8>(t_phase), std::memory_order_relaxed);
+				address = callSite;
+			}
+		}
+		if (address == callSite)
+		{
+			site.allocations.fetch_add(1, std::memory_order_relaxed);
+			site.bytes.fetch_add(size, std::memory_order_relaxed);
+			return;
+		}
+	}
+	m_droppedCallSites.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Counts a free against the calling thread's phase
+/// </summary>
+void AllocationTracker::recordFree()
+{
+	m_phases[static_cast<size_t>(t_phase)].frees.fetch_add(1, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Gets the allocations made in one phase, on every thread, since the program started
+/// </summary>
+AllocationTracker::Counts AllocationTracker::getCounts(const AllocationPhase phase)
+{
+	const PhaseCounters& counters = m_phases[static_cast<size_t>(phase)];
+	return Counts{ counters.allocations.load(std::memory_order_relaxed), counters.frees.load(std::memory_order_relaxed), counters.bytes.load(std::memory_order_relaxed) };
+}
+
+/// <summary>
+/// Gets the allocations made in every phase, on every thread, since the program started
+/// </summary>
+AllocationTracker::Counts AllocationTracker::getTotal()
+{
+	Counts total;
+	for (size_t phase = 0; phase < phaseCount; ++phase)
+	{
+		const Counts counts = getCounts(static_cast<AllocationPhase>(phase));
+		total.allocations += counts.allocations;
+		total.frees += counts.frees;
+		total.bytes += counts.bytes;
+	}
+	return total;
+}
+
+/// <summary>
+/// Gets how many allocations the calling thread has made. Lets a thread check its own work without counting what other threads do at the same time.
+/// </summary>
+u64 AllocationTracker::getThreadAllocations()
+{
+	return t_allocations;
+}
+
+/// <summary>
+/// Gets every call site that has allocated, most allocations first. Allocates the result, so don't call it from a phase being checked.
+/// </summary>
+std::vector<AllocationTracker::CallSite> AllocationTracker::getCallSites()
+{
+	std::vector<CallSite> callSites;
+	for (const CallSiteSlot& site : m_callSites)
+	{
+		const void* const address = site.address.load(std::memory_order_acquire);
+		if (address == nullptr) continue;
+		callSites.push_back(CallSite{ address, static_cast<AllocationPhase>(site.phase.load(std::memory_order_relaxed)),
+			site.allocations.load(std::memory_order_relaxed), site.bytes.load(std::memory_order_relaxed) });
+	}
+	std::sort(callSites.begin(), callSites.end(), [](const CallSite& a, const CallSite& b) { return a.allocations > b.allocations; });
+	return callSites;
+}
+
+const char* AllocationTracker::getPhaseName(const AllocationPhase phase)
+{
+	switch (phase)
+	{
+	case AllocationPhase::Input: return "input";
+	case AllocationPhase::Tick: return "tick";
+	case AllocationPhase::Publish: return "publish";
+	case AllocationPhase::Render: return "render";
+	case AllocationPhase::Audio: return "audio";
+	default: return "other";
+	}
+}
+
+/// <summary>
+/// Writes the counts of every phase and the busiest call sites. Call sites are named when the symbol can be found,
+/// otherwise the address can be looked up with addr2line or a debugger.
+/// </summary>
+/// <param name="out">Where to write the report</param>
+/// <param name="maxCallSites">How many call sites to list</param>
+void AllocationTracker::report(std::ostream& out, const size_t maxCallSites)
+{
+	if (!enabled)
+	{
+		out << "Allocation tracking is off, build with TETRIS_TRACK_ALLOCATIONS to turn it on" << std::endl;
+		return;
+	}
+
+	out << "Allocations by phase:" << std::endl;
+	for (size_t phase = 0; phase < phaseCount; ++phase)
+	{
+		const Counts counts = getCounts(static_cast<AllocationPhase>(phase));
+		out << "    " << getPhaseName(static_cast<AllocationPhase>(phase)) << ": " << counts.allocations << " allocations, " << counts.frees << " frees, "
+			<< counts.bytes << " bytes" << std::endl;
+	}
+
+	const std::vector<CallSite> callSites = getCallSites();
+	out << "Top call sites:" << std::endl;
+	for (size_t i = 0; i < std::min(maxCallSites, callSites.size()); ++i)
+	{
+		const CallSite& site = callSites[i];
+		out << "    " << site.address;
+#if !defined(_MSC_VER)
+		Dl_info info;
+		if (dladdr(site.address, &info) != 0 && info.dli_sname != nullptr) out << " " << info.dli_sname;
+#endif
+		out << " (" << getPhaseName(site.phase) << "): " << site.allocations << " allocations, " << site.bytes << " bytes" << std::endl;
+	}
+	const u64 dropped = m_droppedCallSites.load(std::memory_order_relaxed);
+	if (dropped > 0) out << "    " << dropped << " allocations from call sites that didn't fit in the table" << std::endl;
+}
+
+#ifdef TETRIS_TRACK_ALLOCATIONS
+
+namespace
+{
+	void* allocate(const std::size_t size, const void* const callSite)
+	{
+		void* const memory = std::malloc(size != 0 ? size : 1);
+		if (memory != nullptr) AllocationTracker::recordAllocation(size, callSite);
+		return memory;
+	}
+
+	void* allocateAligned(const std::size_t size, const std::align_val_t alignment, const void* const callSite)
+	{
+		const std::size_t align = static_cast<std::size_t>(alignment);
+#if defined(_MSC_VER)
+		void* const memory = _aligned_malloc(size != 0 ? size : 1, align);
+#else
+		void* const memory = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align); //The size has to be a multiple of the alignment
+#endif
+		if (memory != nullptr) AllocationTracker::recordAllocation(size, callSite);
+		return memory;
+	}
+
+	void release(void* const memory)
+	{
+		if (memory == nullptr) return;
+		AllocationTracker::recordFree();
+		std::free(memory);
+	}
+
+	void releaseAligned(void* const memory)
+	{
+		if (memory == nullptr) return;
+		AllocationTracker::recordFree();
+#if defined(_MSC_VER)
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	void* const memory = allocate(size, TETRIS_RETURN_ADDRESS());
+	if (memory == nullptr) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](std::size_t size)
+{
+	void* const memory = allocate(size, TETRIS_RETURN_ADDRESS());
+	if (memory == nullptr) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size, TETRIS_RETURN_ADDRESS());
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return allocate(size, TETRIS_RETURN_ADDRESS());
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	void* const memory = allocateAligned(size, alignment, TETRIS_RETURN_ADDRESS());
+	if (memory == nullptr) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	void* const memory = allocateAligned(size, alignment, TETRIS_RETURN_ADDRESS());
+	if (memory == nullptr) throw std::bad_alloc();
+	return memory;
+}
+
+void operator delete(void* memory) noexcept { release(memory); }
+void operator delete[](void* memory) noexcept { release(memory); }
+void operator delete(void* memory, std::size_t) noexcept { release(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { release(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { release(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { release(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { releaseAligned(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { releaseAligned(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { releaseAligned(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { releaseAligned(memory); }
+
+#endif
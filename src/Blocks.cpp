@@ -3,16 +3,111 @@
 #include "../Headers/Blocks.hpp"
 
 /// <summary>
-/// Initializes the rng generator with the random device
+/// Initializes the rng generator with a seed from the random device
 /// </summary>
-Blocks::Blocks() : m_rng(m_dev()) {}
+Blocks::Blocks()
+{
+	reseed();
+}
+
+/// <summary>
+/// Initializes the rng generator with a known seed, so the same sequence of blocks can be generated again (e.g. for replays)
+/// </summary>
+/// <param name="seed">The seed to start the generator with</param>
+Blocks::Blocks(const u32 seed)
+{
+	reseed(seed);
+}
+
+/// <summary>
+/// Restarts the block sequence from a new seed taken from the random device
+/// </summary>
+void Blocks::reseed()
+{
+	reseed(m_dev());
+}
+
+/// <summary>
+/// Restarts the block sequence from the given seed
+/// </summary>
+/// <param name="seed">The seed to start the generator with</param>
+void Blocks::reseed(const u32 seed)
+{
+	m_seed = seed;
+	m_blocksDrawn = 0;
+	m_rng.seed(seed);
+}
+
+/// <summary>
+/// Puts the generator back into the state it was in after drawing the given number of blocks from the given seed.
+/// Used to continue a saved game with the exact block sequence it would have had.
+/// </summary>
+/// <param name="seed">The seed the block sequence was started with</param>
+/// <param name="blocksDrawn">How many blocks had been drawn from it</param>
+void Blocks::restore(const u32 seed, const u64 blocksDrawn)
+{
+	reseed(seed);
+	m_rng.discard(blocksDrawn);
+	m_blocksDrawn = blocksDrawn;
+}
+
+/// <summary>
+/// Returns the seed the current block sequence was started with
+/// </summary>
+/// <returns></returns>
+const u32 Blocks::getSeed() const
+{
+	return m_seed;
+}
+
+/// <summary>
+/// Returns how many blocks have been drawn since the generator was last seeded
+/// </summary>
+/// <returns></returns>
+const u64 Blocks::getBlocksDrawn() const
+{
+	return m_blocksDrawn;
+}
+
+/// <summary>
+/// Returns how many different blocks there are. Valid block types are 0 to getBlockTypeCount() - 1.
+/// </summary>
+/// <returns></returns>
+const u8 Blocks::getBlockTypeCount() const
+{
+	return static_cast<u8>(m_blocks.size());
+}
 
 /// <summary>
 /// Generates a random number between 0 and m_blocks.size() - 1 inclusive, and returns the block at that given index.
+/// std::mt19937 output is the same on every standard library, unlike std::uniform_int_distribution, so the raw output is reduced directly
+/// to keep seeded sequences identical across platforms.
 /// </summary>
 /// <returns></returns>
 const PieceState::Piece& Blocks::getBlock()
 {
-	std::uniform_int_distribution<std::mt19937::result_type> rand(0, m_blocks.size() - 1);
-	return m_blocks[rand(m_rng)]; //Returns a block from the list of blocks
-}
\ No newline at end of file
+	++m_blocksDrawn;
+	return m_blocks[m_rng() % m_blocks.size()]; //Returns a block from the list of blocks
+}
+
+/// <summary>
+/// Returns the block of the given type. Used to turn a piece type from a game snapshot back into its piece data.
+/// </summary>
+/// <param name="type">The index of the block in the list of blocks</param>
+/// <returns></returns>
+const PieceState::Piece& Blocks::getBlock(const u8 type) const
+{
+	return m_blocks[type];
+}
+/// <summary>
+/// Fills in the types of the blocks getBlock() will return next, in order, without drawing them
+/// </summary>
+/// <param name="types">Where to write the types. Its size is how many blocks to look ahead</param>
+void Blocks::peek(std::span<u8> types) const
+{
+	std::mt19937 rng = m_rng;
+	for (u8& type : types)
+	{
+		type = static_cast<u8>(rng() % m_blocks.size());
+	}
+}
@@ -1,19 +1,36 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <utility>
+
 #include "../Headers/Board.hpp"
+#include "../Headers/Zobrist.hpp"
 
-Board::Board(const u8 width, const u8 height) : m_boardWidth(width), m_boardHeight(height)
+Board::Board(const u8 width, const u8 height) : m_boardWidth(width), m_boardHeight(height),
+	m_wallMask(~(((u64(1) << width) - 1) << rowMaskMargin)), m_rowKernels(selectRowKernels(width))
 {
 	m_board.resize(width * height);
+	m_rowMasks.resize(height);
 	resetBoard();
 }
 
 void Board::resetBoard()
 {
 	std::fill(m_board.begin(), m_board.end(), 0);
+	std::fill(m_rowMasks.begin(), m_rowMasks.end(), m_wallMask);
+	m_hash = 0;
 }
 
 void Board::setBoardPosition(const u8 x, const u8 y, const u8 value)
 {
-	m_board[y * m_boardWidth + x] = value;
+	u8& cell = m_board[y * m_boardWidth + x];
+	const u32 position = y * maxBoardWidth + x;
+	m_hash ^= Zobrist::key(Zobrist::Feature::Cell, position, cell) ^ Zobrist::key(Zobrist::Feature::Cell, position, value);
+	cell = value;
+
+	const u64 cellBit = u64(1) << (x + rowMaskMargin);
+	if (value) m_rowMasks[y] |= cellBit;
+	else m_rowMasks[y] &= ~cellBit;
 }
 
 u8 Board::getBoardPosition(const s8 x, const u8 y)
@@ -21,17 +38,208 @@ u8 Board::getBoardPosition(const s8 x, const u8 y)
 	return m_board[y * m_boardWidth + x];
 }
 
-void Board::renderBoard(Renderer* const renderer, const std::vector<PlayerColor>& playerColors)
+const std::vector<u8>& Board::getBoardData() const
+{
+	return m_board;
+}
+
+const u8 Board::getBoardHeight() const
 {
-	for (int x = 0; x < m_boardWidth; ++x)
+	return m_boardHeight;
+}
+
+/// <summary>
+/// How many rows from the bottom of the board the highest block is. An empty board has a stack height of 0.
+/// </summary>
+/// <returns></returns>
+const u8 Board::getStackHeight() const
+{
+	for (u8 y = 0; y < m_boardHeight; ++y)
 	{
-		for (int y = 0; y < m_boardHeight; ++y)
+		if (m_rowMasks[y] != m_wallMask) return m_boardHeight - y;
+	}
+	return 0;
+}
+
+/// <summary>
+/// Gets a bitmask of the filled cells in a row, including the walls on either side.
+/// Rows above or below the board are completely filled.
+/// </summary>
+/// <param name="y">The row</param>
+/// <returns></returns>
+u64 Board::getRowMask(const s8 y) const
+{
+	if (y < 0 || y >= m_boardHeight) return ~u64(0);
+	return m_rowMasks[y];
+}
+
+/// <summary>
+/// The Zobrist hash of every cell on the board. Kept up to date as cells are set, so it costs nothing to read.
+/// </summary>
+/// <returns></returns>
+u64 Board::getHash() const
+{
+	return m_hash;
+}
+
+/// <summary>
+/// Works the hash out from scratch, for checking that the incremental hash hasn't drifted
+/// </summary>
+/// <returns></returns>
+u64 Board::computeHash() const
+{
+	u64 hash = 0;
+	for (u8 y = 0; y < m_boardHeight; ++y)
+	{
+		for (u8 x = 0; x < m_boardWidth; ++x)
 		{
-			if (getBoardPosition(x, y))
-			{
-				PlayerColor playerColor = playerColors[getBoardPosition(x, y) - 1];
-				renderer->drawPiece(x, y, playerColor.fillColor, sf::Color::White);
-			}
+			hash ^= Zobrist::key(Zobrist::Feature::Cell, y * maxBoardWidth + x, m_board[y * m_boardWidth + x]);
 		}
 	}
-}
\ No newline at end of file
+	return hash;
+}
+
+/// <summary>
+/// Whether a row has no blocks in it
+/// </summary>
+/// <param name="y">The row</param>
+/// <returns></returns>
+bool Board::isRowEmpty(const u8 y) const
+{
+	return m_rowMasks[y] == m_wallMask;
+}
+
+/// <summary>
+/// Finds the full rows among the top rows of the board. A row is full when its mask has every bit set, walls included,
+/// so this is one compare per row whatever the width.
+/// </summary>
+/// <param name="rows">How many rows to look at, from the top. At most 32</param>
+/// <returns>Bit y is set if row y is full</returns>
+u32 Board::getFullRows(const u8 rows) const
+{
+	u32 fullRows = 0;
+	for (u8 y = 0; y < rows; ++y)
+	{
+		if (m_rowMasks[y] == ~u64(0)) fullRows |= u32(1) << y;
+	}
+	return fullRows;
+}
+
+/// <summary>
+/// Empties the given rows and drops the rows above the lowest of them down by the number of rows cleared
+/// </summary>
+/// <param name="fullRows">Bit y is set if row y is to be cleared, as returned by getFullRows</param>
+void Board::clearRows(const u32 fullRows)
+{
+	if (fullRows != 0) (this->*m_rowKernels.clearRows)(fullRows);
+}
+
+/// <summary>
+/// Pushes the rows above the floor up and fills the rows it opens up at the bottom with the value, except for one column
+/// </summary>
+/// <param name="rows">How many rows to push up by</param>
+/// <param name="floor">The first row below the playing field</param>
+/// <param name="holeColumn">The column left empty in the new rows</param>
+/// <param name="value">The board value of the new rows' blocks</param>
+void Board::raiseRows(const u8 rows, const u8 floor, const u8 holeColumn, const u8 value)
+{
+	if (rows != 0) (this->*m_rowKernels.raiseRows)(rows, floor, holeColumn, value);
+}
+
+template <u8 Width>
+constexpr Board::RowKernels Board::rowKernelsFor()
+{
+	return { &Board::clearRowsOf<Width>, &Board::raiseRowsOf<Width> };
+}
+
+/// <summary>
+/// Picks the row kernels for a board width. The widths MainMenu::calculateGameSizes gives one to four players have their own.
+/// </summary>
+/// <param name="width">The width of the board</param>
+/// <returns></returns>
+const Board::RowKernels& Board::selectRowKernels(const u8 width)
+{
+	static constexpr std::array<std::pair<u8, RowKernels>, 4> specialized = { {
+		{ 10, rowKernelsFor<10>() }, { 13, rowKernelsFor<13>() }, { 16, rowKernelsFor<16>() }, { 20, rowKernelsFor<20>() }
+	} };
+	static constexpr RowKernels anyWidth = rowKernelsFor<0>();
+
+	for (const auto& [kernelWidth, kernels] : specialized)
+	{
+		if (kernelWidth == width) return kernels;
+	}
+	return anyWidth;
+}
+
+/// <summary>
+/// Copies one row over another, keeping the hash and the row masks up to date
+/// </summary>
+template <u8 Width>
+void Board::copyRow(const u8 from, const u8 to)
+{
+	const u8 width = Width != 0 ? Width : m_boardWidth;
+	const u8* source = &m_board[from * width];
+	u8* destination = &m_board[to * width];
+	u64 hash = 0;
+	for (u8 x = 0; x < width; ++x)
+	{
+		const u32 position = to * maxBoardWidth + x;
+		hash ^= Zobrist::key(Zobrist::Feature::Cell, position, destination[x]) ^ Zobrist::key(Zobrist::Feature::Cell, position, source[x]);
+		destination[x] = source[x];
+	}
+	m_hash ^= hash;
+	m_rowMasks[to] = m_rowMasks[from];
+}
+
+/// <summary>
+/// Empties a row, keeping the hash and the row masks up to date
+/// </summary>
+template <u8 Width>
+void Board::emptyRow(const u8 y)
+{
+	const u8 width = Width != 0 ? Width : m_boardWidth;
+	u8* row = &m_board[y * width];
+	u64 hash = 0;
+	for (u8 x = 0; x < width; ++x)
+	{
+		hash ^= Zobrist::key(Zobrist::Feature::Cell, y * maxBoardWidth + x, row[x]);
+		row[x] = 0;
+	}
+	m_hash ^= hash;
+	m_rowMasks[y] = m_wallMask;
+}
+
+template <u8 Width>
+void Board::clearRowsOf(const u32 fullRows)
+{
+	//Every row above the lowest full row drops by the number of full rows below it, and as many empty rows come in at the top
+	int to = std::bit_width(fullRows) - 1;
+	for (int from = to; from >= 0; --from)
+	{
+		if (fullRows >> from & 1) continue;
+		copyRow<Width>(static_cast<u8>(from), static_cast<u8>(to--));
+	}
+	for (; to >= 0; --to) emptyRow<Width>(static_cast<u8>(to));
+}
+
+template <u8 Width>
+void Board::raiseRowsOf(const u8 rows, const u8 floor, const u8 holeColumn, const u8 value)
+{
+	const u8 width = Width != 0 ? Width : m_boardWidth;
+	for (u8 y = 0; y + rows < floor; ++y) copyRow<Width>(y + rows, y);
+	for (u8 y = floor - std::min(rows, floor); y < floor; ++y)
+	{
+		u8* row = &m_board[y * width];
+		u64 hash = 0, mask = m_wallMask;
+		for (u8 x = 0; x < width; ++x)
+		{
+			const u8 cell = x == holeColumn ? 0 : value;
+			const u32 position = y * maxBoardWidth + x;
+			hash ^= Zobrist::key(Zobrist::Feature::Cell, position, row[x]) ^ Zobrist::key(Zobrist::Feature::Cell, position, cell);
+			row[x] = cell;
+			if (cell) mask |= u64(1) << (x + rowMaskMargin);
+		}
+		m_hash ^= hash;
+		m_rowMasks[y] = mask;
+	}
+}
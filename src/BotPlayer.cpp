@@ -0,0 +1,458 @@
+#include <algorithm>
+#include <charconv>
+#include <csignal>
+#include <cerrno>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BOT_PROCESSES_AVAILABLE
+#endif
+
+#include "../Headers/BotPlayer.hpp"
+
+static constexpr s16 noHeldPiece = 0xFF;
+
+/// <summary>
+/// Starts the engine. If it can't be started the player just stays idle.
+/// </summary>
+/// <param name="command">The command line that starts the engine, run through the shell</param>
+/// <param name="playerIndex">The player the engine plays as</param>
+/// <param name="deadline">How long the engine has to answer each turn</param>
+BotPlayer::BotPlayer(const std::string& command, const u8 playerIndex, const std::chrono::milliseconds deadline) :
+	m_command(command), m_playerIndex(playerIndex), m_deadline(deadline)
+{
+	m_message.reserve(4096);
+	m_replies.reserve(maxReplyLength + 1024); //The longest unfinished line plus one read
+	launch();
+}
+
+/// <summary>
+/// Asks the engine to quit, and kills it if it hasn't within a moment
+/// </summary>
+BotPlayer::~BotPlayer()
+{
+#ifdef BOT_PROCESSES_AVAILABLE
+	if (m_processId < 0) return;
+
+	if (m_toBot >= 0)
+	{
+		m_message = "quit\n";
+		send();
+	}
+	stop(nullptr);
+	for (u8 attempt = 0; attempt < 50; ++attempt)
+	{
+		if (waitpid(m_processId, nullptr, WNOHANG) != 0) return;
+		usleep(2000);
+	}
+	kill(m_processId, SIGKILL);
+	waitpid(m_processId, nullptr, 0);
+#endif
+}
+
+/// <summary>
+/// Returns whether the engine is still running and talking to the game
+/// </summary>
+/// <returns></returns>
+const bool BotPlayer::isRunning() const
+{
+	return m_toBot >= 0;
+}
+
+/// <summary>
+/// Returns whether the engine has been asked for a move it hasn't answered yet, and still has time to
+/// </summary>
+/// <returns></returns>
+const bool BotPlayer::isThinking() const
+{
+	return m_thinking;
+}
+
+const u32 BotPlayer::getMissedDeadlines() const
+{
+	return m_missedDeadlines;
+}
+
+/// <summary>
+/// Tells the engine a new game is starting: the size of the board, which player it is, and the shape of every piece
+/// </summary>
+void BotPlayer::startGame(const u8 numPlayers, const u8 boardWidth, const u8 boardHeight, const Blocks& blocks)
+{
+	m_boardWidth = boardWidth;
+	m_boardHeight = boardHeight;
+	m_sentBoard.assign(boardWidth * boardHeight, 0xFF);
+	m_sentNext = m_sentHeld = m_sentCanHold = -1;
+	m_thinking = false;
+	m_placement = Placement();
+	m_keyCount = m_nextKey = 0;
+	if (!isRunning()) return;
+
+	m_message = "rules ";
+	appendNumber(boardWidth);
+	m_message += ' ';
+	appendNumber(boardHeight);
+	m_message += ' ';
+	appendNumber(m_playerIndex);
+	m_message += ' ';
+	appendNumber(numPlayers);
+	m_message += '\n';
+	for (u8 type = 0; type < blocks.getBlockTypeCount(); ++type)
+	{
+		const PieceState::Piece& piece = blocks.getBlock(type);
+		m_message += "shape ";
+		appendNumber(type);
+		m_message += ' ';
+		appendNumber(piece.width);
+		m_message += ' ';
+		for (const u8 cell : piece.data)
+		{
+			m_message += cell ? '1' : '0';
+		}
+		m_message += '\n';
+	}
+	m_message += "start\n";
+	send();
+}
+
+/// <summary>
+/// Sends the engine everything that changed since its last turn and asks it for a move
+/// </summary>
+/// <param name="board">The board, without any falling pieces</param>
+/// <param name="state">The engine's player, with the piece it has to place</param>
+void BotPlayer::beginTurn(const Board& board, const PieceState::State& state)
+{
+	m_placement = Placement();
+	m_keyCount = m_nextKey = 0;
+	if (!isRunning()) return;
+
+	m_message.clear();
+	const std::vector<u8>& cells = board.getBoardData();
+	for (u8 y = 0; y < m_boardHeight; ++y)
+	{
+		const auto row = cells.begin() + y * m_boardWidth;
+		const auto sentRow = m_sentBoard.begin() + y * m_boardWidth;
+		if (std::equal(row, row + m_boardWidth, sentRow)) continue;
+
+		std::copy(row, row + m_boardWidth, sentRow);
+		m_message += "row ";
+		appendNumber(y);
+		m_message += ' ';
+		for (u8 x = 0; x < m_boardWidth; ++x)
+		{
+			m_message += row[x] ? static_cast<char>('0' + row[x]) : '.';
+		}
+		m_message += '\n';
+	}
+
+	m_message += "piece ";
+	appendNumber(state.piece->type);
+	m_message += ' ';
+	appendNumber(state.rotation);
+	m_message += ' ';
+	appendNumber(state.xOffset);
+	m_message += ' ';
+	appendNumber(state.yOffset);
+	m_message += '\n';
+
+	if (m_sentNext != state.nextPiece->type)
+	{
+		m_sentNext = state.nextPiece->type;
+		m_message += "next ";
+		appendNumber(m_sentNext);
+		m_message += '\n';
+	}
+	const s16 held = state.heldPiece != nullptr ? state.heldPiece->type : noHeldPiece;
+	if (m_sentHeld != held)
+	{
+		m_sentHeld = held;
+		m_message += "hold ";
+		if (held == noHeldPiece) m_message += '-';
+		else appendNumber(held);
+		m_message += '\n';
+	}
+	if (m_sentCanHold != state.canHoldPiece)
+	{
+		m_sentCanHold = state.canHoldPiece;
+		m_message += state.canHoldPiece ? "canhold 1\n" : "canhold 0\n";
+	}
+
+	++m_turn;
+	m_message += "go ";
+	appendNumber(static_cast<s32>(m_turn));
+	m_message += ' ';
+	appendNumber(static_cast<s32>(m_deadline.count()));
+	m_message += '\n';
+	send();
+	m_thinking = true;
+	m_turnStart = std::chrono::steady_clock::now();
+}
+
+/// <summary>
+/// Reads whatever the engine has answered and gives the move to make this tick, if any. A placement is worked towards a key at a time,
+/// checking where the piece actually ended up after every key, so wall kicks and blocked moves can't throw it off.
+/// </summary>
+/// <param name="state">The engine's player</param>
+/// <returns>The move to queue for the next tick, or None</returns>
+const Move BotPlayer::nextMove(const PieceState::State& state)
+{
+	readReplies();
+	if (m_thinking && std::chrono::steady_clock::now() - m_turnStart > m_deadline)
+	{
+		m_thinking = false;
+		++m_missedDeadlines;
+		std::cerr << "Bot for player " << m_playerIndex + 1 << " missed the deadline for turn " << m_turn << std::endl;
+	}
+
+	if (m_nextKey < m_keyCount) return m_keys[m_nextKey++];
+	if (!m_placement.active) return Move::None;
+
+	Placement& placement = m_placement;
+	if (placement.hold)
+	{
+		placement.hold = false;
+		if (state.canHoldPiece) return Move::HoldPiece;
+	}
+	if (state.rotation != placement.rotation && placement.rotationTries < 2)
+	{
+		++placement.rotationTries;
+		const u8 turns = (placement.rotation - state.rotation) & 3;
+		return turns == 1 ? Move::Rotate : turns == 2 ? Move::Rotate180 : Move::RotateCounterClockwise;
+	}
+	if (state.xOffset != placement.x && (!placement.moved || state.xOffset != placement.lastX))
+	{
+		placement.moved = true;
+		placement.lastX = state.xOffset;
+		return state.xOffset < placement.x ? Move::Right : Move::Left;
+	}
+	placement.active = false;
+	return Move::HardDrop;
+}
+
+/// <summary>
+/// Blocks until the engine answers the current turn or runs out of time. Only for running games without a window,
+/// where waiting for the engine makes every run of a game play out the same way.
+/// </summary>
+void BotPlayer::waitForReply()
+{
+#ifdef BOT_PROCESSES_AVAILABLE
+	while (m_thinking && isRunning())
+	{
+		const auto remaining = m_deadline - std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_turnStart);
+		if (remaining.count() <= 0) return;
+
+		pollfd reply{ m_fromBot, POLLIN, 0 };
+		if (poll(&reply, 1, static_cast<int>(remaining.count())) <= 0) return;
+		readReplies();
+	}
+#endif
+}
+
+/// <summary>
+/// Starts the engine through the shell with its stdin and stdout connected to pipes. The game's ends of the pipes never block.
+/// </summary>
+void BotPlayer::launch()
+{
+#ifdef BOT_PROCESSES_AVAILABLE
+	std::signal(SIGPIPE, SIG_IGN); //An engine that exits is noticed by the failed write instead of killing the game
+
+	int toBot[2], fromBot[2];
+	if (pipe(toBot) != 0) return;
+	if (pipe(fromBot) != 0)
+	{
+		close(toBot[0]);
+		close(toBot[1]);
+		return;
+	}
+
+	m_processId = fork();
+	if (m_processId == 0)
+	{
+		dup2(toBot[0], STDIN_FILENO);
+		dup2(fromBot[1], STDOUT_FILENO);
+		close(toBot[0]);
+		close(toBot[1]);
+		close(fromBot[0]);
+		close(fromBot[1]);
+		execl("/bin/sh", "sh", "-c", m_command.c_str(), static_cast<char*>(nullptr));
+		_exit(127);
+	}
+
+	close(toBot[0]);
+	close(fromBot[1]);
+	if (m_processId < 0)
+	{
+		std::cerr << "Error starting bot " << m_command << std::endl;
+		close(toBot[1]);
+		close(fromBot[0]);
+		return;
+	}
+	m_toBot = toBot[1];
+	m_fromBot = fromBot[0];
+	for (const int fd : { m_toBot, m_fromBot })
+	{
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+	}
+#else
+	std::cerr << "Bots aren't supported on this platform, player " << m_playerIndex + 1 << " will stay idle" << std::endl;
+#endif
+}
+
+/// <summary>
+/// Reads what the engine has written so far, up to a tick's worth, and handles every complete line.
+/// The limit keeps an engine that writes nonstop from holding the game thread here; the rest is read on later ticks.
+/// </summary>
+void BotPlayer::readReplies()
+{
+#ifdef BOT_PROCESSES_AVAILABLE
+	if (!isRunning()) return;
+
+	char buffer[1024];
+	for (size_t budget = maxReadPerCall; budget > 0;)
+	{
+		const ssize_t bytes = read(m_fromBot, buffer, std::min(sizeof(buffer), budget));
+		if (bytes > 0)
+		{
+			budget -= bytes;
+			m_replies.append(buffer, bytes);
+			handleLines();
+			continue;
+		}
+		if (bytes == 0) stop("exited");
+		else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) stop("couldn't be read from");
+		else if (errno == EINTR) continue;
+		break;
+	}
+#endif
+}
+
+/// <summary>
+/// Handles every complete line read so far and keeps the unfinished one, dropping it once it is too long to be a valid reply
+/// </summary>
+void BotPlayer::handleLines()
+{
+	size_t start = 0;
+	for (size_t end = m_replies.find('\n'); end != std::string::npos; end = m_replies.find('\n', start))
+	{
+		handleReply(std::string_view(m_replies).substr(start, end - start));
+		start = end + 1;
+	}
+	m_replies.erase(0, start);
+	if (m_replies.size() > maxReplyLength) m_replies.clear();
+}
+
+/// <summary>
+/// Acts on one line from the engine. Anything that isn't understood is ignored, as are answers to turns that are already over.
+/// </summary>
+void BotPlayer::handleReply(std::string_view line)
+{
+	if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+	const size_t space = line.find(' ');
+	const std::string_view command = line.substr(0, space);
+	std::string_view arguments = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
+
+	if (command == "ready")
+	{
+		m_name = arguments;
+		std::cout << "Player " << m_playerIndex + 1 << " is played by " << (m_name.empty() ? m_command : m_name) << std::endl;
+		return;
+	}
+	if (command == "info")
+	{
+		std::cout << "Bot " << m_playerIndex + 1 << ": " << arguments << std::endl;
+		return;
+	}
+	if (command != "place" && command != "keys") return;
+
+	u32 turn = 0;
+	const auto [turnEnd, turnError] = std::from_chars(arguments.data(), arguments.data() + arguments.size(), turn);
+	if (turnError != std::errc() || turn != m_turn || !m_thinking) return;
+	arguments.remove_prefix(std::min(arguments.size(), static_cast<size_t>(turnEnd - arguments.data()) + 1));
+
+	if (command == "keys")
+	{
+		queueKeys(arguments);
+	}
+	else
+	{
+		s32 rotation = 0, x = 0;
+		const char* const end = arguments.data() + arguments.size();
+		const auto [rotationEnd, rotationError] = std::from_chars(arguments.data(), end, rotation);
+		if (rotationError != std::errc() || rotationEnd == end) return;
+		const auto [xEnd, xError] = std::from_chars(rotationEnd + 1, end, x);
+		if (xError != std::errc() || rotation < 0 || rotation > 3 || x < -maxBoardWidth || x > maxBoardWidth) return;
+
+		m_placement = Placement();
+		m_placement.active = true;
+		m_placement.rotation = static_cast<u8>(rotation);
+		m_placement.x = static_cast<s8>(x);
+		m_placement.hold = std::string_view(xEnd, end - xEnd).find("hold") != std::string_view::npos;
+	}
+	m_thinking = false;
+}
+
+/// <summary>
+/// Turns a key sequence from the engine into moves, made one per tick
+/// </summary>
+void BotPlayer::queueKeys(std::string_view keys)
+{
+	m_keyCount = m_nextKey = 0;
+	for (const char key : keys)
+	{
+		if (m_keyCount == maxKeys) break;
+
+		Move move = Move::None;
+		switch (key)
+		{
+		case 'L': move = Move::Left; break;
+		case 'R': move = Move::Right; break;
+		case 'D': move = Move::Down; break;
+		case 'C': move = Move::Rotate; break;
+		case 'A': move = Move::RotateCounterClockwise; break;
+		case 'F': move = Move::Rotate180; break;
+		case 'H': move = Move::HoldPiece; break;
+		case 'X': move = Move::HardDrop; break;
+		default: break;
+		}
+		if (move != Move::None) m_keys[m_keyCount++] = move;
+	}
+}
+
+/// <summary>
+/// Writes the composed message to the engine. An engine that stops reading its input is dropped rather than waited on.
+/// </summary>
+void BotPlayer::send()
+{
+#ifdef BOT_PROCESSES_AVAILABLE
+	if (!isRunning()) return;
+
+	const ssize_t written = write(m_toBot, m_message.data(), m_message.size());
+	if (written != static_cast<ssize_t>(m_message.size())) stop("stopped reading its input");
+#endif
+}
+
+void BotPlayer::appendNumber(const s32 number)
+{
+	char digits[12];
+	const auto [end, error] = std::to_chars(digits, digits + sizeof(digits), number);
+	m_message.append(digits, end);
+}
+
+/// <summary>
+/// Closes the pipes. The player stays idle for the rest of the game.
+/// </summary>
+/// <param name="reason">Why the engine was dropped, printed if it isn't null</param>
+void BotPlayer::stop(const char* const reason)
+{
+#ifdef BOT_PROCESSES_AVAILABLE
+	if (reason != nullptr) std::cerr << "Bot for player " << m_playerIndex + 1 << " " << reason << ", the player will stay idle" << std::endl;
+	if (m_toBot >= 0) close(m_toBot);
+	if (m_fromBot >= 0) close(m_fromBot);
+	m_toBot = m_fromBot = -1;
+	m_thinking = false;
+#endif
+}
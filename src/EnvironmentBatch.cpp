@@ -0,0 +1,284 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+
+#include "../Headers/EnvironmentBatch.hpp"
+
+namespace
+{
+	//The game's move for each TetrisEnvAction
+	constexpr std::array<Move, TETRIS_ENV_ACTION_COUNT> actionMoves = {
+		Move::None, Move::Left, Move::Right, Move::Down, Move::Rotate, Move::RotateCounterClockwise, Move::Rotate180, Move::HardDrop, Move::HoldPiece
+	};
+
+	u32 getThreadCount(const TetrisEnvConfig& config)
+	{
+		const u32 threads = config.threads > 0 ? config.threads : std::max(1u, std::thread::hardware_concurrency());
+		return std::clamp<u32>(threads, 1, config.envs);
+	}
+}
+
+/// <summary>
+/// Sets up every environment's game and starts the worker threads, which wait for the first job. The games need a reset before they're stepped.
+/// </summary>
+/// <param name="config">The batch's settings, which must be valid (see isValid)</param>
+EnvironmentBatch::EnvironmentBatch(const TetrisEnvConfig& config)
+	: m_count(config.envs), m_players(config.players), m_boardWidth(coopBoardWidth(config.players)),
+	m_ticksPerStep(std::max<u16>(config.ticksPerStep, 1)), m_autoReset(config.autoReset != 0),
+	m_threadCount(getThreadCount(config)), m_jobStart(m_threadCount), m_jobDone(m_threadCount)
+{
+	m_environments.resize(m_count);
+	for (Environment& environment : m_environments)
+	{
+		environment.board = std::make_unique<Board>(m_boardWidth, boardHeight);
+		environment.blocks = std::make_unique<Blocks>(0);
+		environment.game = std::make_unique<Game>(m_players, m_boardWidth, gameHeight, sideBuffer, verticalBuffer, 0, 0,
+			nullptr, environment.board.get(), nullptr, nullptr, &m_pieceState, environment.blocks.get());
+	}
+
+	for (u32 thread = 1; thread < m_threadCount; ++thread)
+	{
+		m_workers.emplace_back(&EnvironmentBatch::worker, this, thread);
+	}
+}
+
+/// <summary>
+/// Releases the workers with the stop job and waits for them to exit
+/// </summary>
+EnvironmentBatch::~EnvironmentBatch()
+{
+	if (m_workers.empty()) return;
+
+	m_job = Job::Stop;
+	m_jobStart.arrive_and_wait();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+/// <summary>
+/// Checks that a config describes a batch that can be made, explaining what is wrong on the console if it doesn't
+/// </summary>
+/// <param name="config">The settings</param>
+/// <returns></returns>
+bool EnvironmentBatch::isValid(const TetrisEnvConfig& config)
+{
+	if (config.envs == 0)
+	{
+		std::cerr << "A batch needs at least one environment" << std::endl;
+		return false;
+	}
+	if (config.players < 1 || config.players > maxPlayers)
+	{
+		std::cerr << "Games have 1 to " << static_cast<int>(maxPlayers) << " players, not " << static_cast<int>(config.players) << std::endl;
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Starts a new game in every environment and writes the first observations
+/// </summary>
+/// <param name="seed">Environment i plays seed + i</param>
+/// <param name="buffers">Where to write the observations</param>
+void EnvironmentBatch::reset(const u32 seed, const TetrisEnvBuffers& buffers)
+{
+	m_seed = seed;
+	m_buffers = buffers;
+	run(Job::Reset);
+}
+
+/// <summary>
+/// Starts a new game in one environment and writes its observations. Runs on the calling thread.
+/// </summary>
+/// <param name="index">The environment</param>
+/// <param name="seed">The seed of the new game. Later games of the environment, if it resets itself, follow on from it</param>
+/// <param name="buffers">Where to write the observations</param>
+void EnvironmentBatch::resetOne(const u32 index, const u32 seed, const TetrisEnvBuffers& buffers)
+{
+	if (index >= m_count) return;
+
+	m_buffers = buffers;
+	m_environments[index].firstSeed = seed;
+	m_environments[index].episode = 0;
+	resetEnvironment(index, seed);
+	writeObservation(index, 0.0f);
+}
+
+/// <summary>
+/// Applies every player's action and advances every game by a step, then writes the observations and rewards
+/// </summary>
+/// <param name="actions">A TetrisEnvAction per player per environment, or null for none</param>
+/// <param name="buffers">Where to write the observations</param>
+void EnvironmentBatch::step(const u8* const actions, const TetrisEnvBuffers& buffers)
+{
+	m_actions = actions;
+	m_buffers = buffers;
+	run(Job::Step);
+}
+
+const u32 EnvironmentBatch::getCount() const
+{
+	return m_count;
+}
+
+const u8 EnvironmentBatch::getPlayers() const
+{
+	return m_players;
+}
+
+const u8 EnvironmentBatch::getBoardWidth() const
+{
+	return m_boardWidth;
+}
+
+const u8 EnvironmentBatch::getBoardHeight() const
+{
+	return gameHeight;
+}
+
+/// <summary>
+/// Runs a job over every environment: the first range on the calling thread, the others on the workers
+/// </summary>
+/// <param name="job">What to do to every environment</param>
+void EnvironmentBatch::run(const Job job)
+{
+	m_job = job;
+	if (m_workers.empty())
+	{
+		runRange(0);
+		return;
+	}
+
+	m_jobStart.arrive_and_wait();
+	runRange(0);
+	m_jobDone.arrive_and_wait();
+}
+
+/// <summary>
+/// Runs the current job over one thread's share of the environments
+/// </summary>
+/// <param name="thread">Which share, 0 for the calling thread</param>
+void EnvironmentBatch::runRange(const u32 thread)
+{
+	const u32 first = static_cast<u32>(u64(m_count) * thread / m_threadCount);
+	const u32 last = static_cast<u32>(u64(m_count) * (thread + 1) / m_threadCount);
+	for (u32 index = first; index < last; ++index)
+	{
+		if (m_job == Job::Reset)
+		{
+			m_environments[index].firstSeed = m_seed + index;
+			m_environments[index].episode = 0;
+			resetEnvironment(index, m_seed + index);
+			writeObservation(index, 0.0f);
+		}
+		else
+		{
+			stepEnvironment(index);
+		}
+	}
+}
+
+/// <summary>
+/// Waits for each job, runs it over this worker's share of the environments, then waits for the other threads
+/// </summary>
+/// <param name="thread">The worker's share</param>
+void EnvironmentBatch::worker(const u32 thread)
+{
+	Tracer::setThreadName("environments");
+	while (true)
+	{
+		m_jobStart.arrive_and_wait();
+		if (m_job == Job::Stop) return;
+
+		runRange(thread);
+		m_jobDone.arrive_and_wait();
+	}
+}
+
+void EnvironmentBatch::resetEnvironment(const u32 index, const u32 seed)
+{
+	m_environments[index].game->restart(seed);
+}
+
+/// <summary>
+/// Restarts the environment's game if it is over and resets itself, queues the players' moves and ticks the game
+/// </summary>
+/// <param name="index">The environment</param>
+void EnvironmentBatch::stepEnvironment(const u32 index)
+{
+	Environment& environment = m_environments[index];
+	Game& game = *environment.game;
+	if (game.isGameOver())
+	{
+		if (!m_autoReset)
+		{
+			writeObservation(index, 0.0f);
+			return;
+		}
+		++environment.episode;
+		resetEnvironment(index, environment.firstSeed + environment.episode * m_count);
+	}
+
+	if (m_actions != nullptr)
+	{
+		for (u8 playerIndex = 0; playerIndex < m_players; ++playerIndex)
+		{
+			const u8 action = m_actions[size_t(index) * m_players + playerIndex];
+			if (action != TETRIS_ENV_ACTION_NONE && action < actionMoves.size()) game.queueMove(PlayerMove{ actionMoves[action], playerIndex });
+		}
+	}
+
+	const u32 linesBefore = game.getLines();
+	for (u16 tick = 0; tick < m_ticksPerStep && !game.isGameOver(); ++tick)
+	{
+		game.tick();
+	}
+	writeObservation(index, static_cast<float>(game.getLines() - linesBefore));
+}
+
+/// <summary>
+/// Writes an environment's board, players, game and reward into the caller's buffers, skipping the buffers that aren't given
+/// </summary>
+/// <param name="index">The environment</param>
+/// <param name="reward">The reward for the step</param>
+void EnvironmentBatch::writeObservation(const u32 index, const float reward)
+{
+	const Environment& environment = m_environments[index];
+	const Game& game = *environment.game;
+	if (m_buffers.boards != nullptr)
+	{
+		const size_t cells = size_t(gameHeight) * m_boardWidth;
+		std::memcpy(m_buffers.boards + index * cells, environment.board->getBoardData().data(), cells);
+	}
+	if (m_buffers.players != nullptr)
+	{
+		for (u8 playerIndex = 0; playerIndex < m_players; ++playerIndex)
+		{
+			const State& state = game.getPlayerState(playerIndex);
+			TetrisEnvPlayer& player = m_buffers.players[size_t(index) * m_players + playerIndex];
+			player.piece = state.piece != nullptr ? state.piece->type : TETRIS_ENV_NO_PIECE;
+			player.rotation = state.rotation;
+			player.x = state.xOffset;
+			player.y = state.yOffset;
+			player.nextPiece = state.nextPiece != nullptr ? state.nextPiece->type : TETRIS_ENV_NO_PIECE;
+			player.heldPiece = state.heldPiece != nullptr ? state.heldPiece->type : TETRIS_ENV_NO_PIECE;
+			player.canHold = state.canHoldPiece;
+			player.reserved = 0;
+		}
+	}
+	if (m_buffers.games != nullptr)
+	{
+		TetrisEnvGame& info = m_buffers.games[index];
+		info.seed = environment.blocks->getSeed();
+		info.tick = game.getTick();
+		info.lines = game.getLines();
+		info.level = game.getLevel();
+		info.gameOver = game.isGameOver();
+		info.reserved = 0;
+	}
+	if (m_buffers.rewards != nullptr) m_buffers.rewards[index] = reward;
+	if (m_buffers.dones != nullptr) m_buffers.dones[index] = game.isGameOver();
+}
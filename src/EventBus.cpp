@@ -0,0 +1,39 @@
+#include <iostream>
+
+#include "../Headers/EventBus.hpp"
+
+/// <summary>
+/// Adds a subscriber. Only the subscriber's thread may pop from the queue it gets.
+/// </summary>
+/// <returns>The subscriber's queue, or null if there are already as many subscribers as the bus supports</returns>
+EventBus::Queue* EventBus::subscribe()
+{
+	if (m_subscriberCount == maxSubscribers)
+	{
+		std::cerr << "The event bus already has " << static_cast<int>(maxSubscribers) << " subscribers" << std::endl;
+		return nullptr;
+	}
+	m_queues[m_subscriberCount] = std::make_unique<Queue>();
+	return m_queues[m_subscriberCount++].get();
+}
+
+/// <summary>
+/// Hands the event to every subscriber. Game thread only.
+/// </summary>
+/// <param name="event">What happened</param>
+void EventBus::publish(const GameEvent& event)
+{
+	for (u8 subscriber = 0; subscriber < m_subscriberCount; ++subscriber)
+	{
+		if (!m_queues[subscriber]->push(event)) m_droppedEvents.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/// <summary>
+/// How many events have been dropped because a subscriber's queue was full, across every subscriber
+/// </summary>
+/// <returns></returns>
+const u64 EventBus::getDroppedEvents() const
+{
+	return m_droppedEvents.load(std::memory_order_relaxed);
+}
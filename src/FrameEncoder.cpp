@@ -0,0 +1,457 @@
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "../Headers/FrameEncoder.hpp"
+
+namespace
+{
+	/// <summary>
+	/// Writes a deflate bit stream. Values are packed starting from the least significant bit, Huffman codes starting from their most significant bit.
+	/// </summary>
+	struct BitWriter
+	{
+		std::vector<u8>& out;
+		u32 bitBuffer = 0;
+		u8 bitCount = 0;
+
+		void write(const u32 bits, const u8 count)
+		{
+			bitBuffer |= bits << bitCount;
+			bitCount += count;
+			while (bitCount >= 8)
+			{
+				out.push_back(static_cast<u8>(bitBuffer));
+				bitBuffer >>= 8;
+				bitCount -= 8;
+			}
+		}
+
+		void writeHuffman(const u32 code, const u8 length)
+		{
+			u32 reversed = 0;
+			for (u8 bit = 0; bit < length; ++bit)
+			{
+				reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+			}
+			write(reversed, length);
+		}
+
+		void flush()
+		{
+			if (bitCount > 0) out.push_back(static_cast<u8>(bitBuffer));
+			bitBuffer = 0;
+			bitCount = 0;
+		}
+	};
+
+	//From RFC 1951, section 3.2.5
+	constexpr std::array<u16, 29> lengthBase = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr std::array<u8, 29> lengthExtraBits = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	constexpr std::array<u16, 30> distanceBase = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr std::array<u8, 30> distanceExtraBits = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	/// <summary>
+	/// Writes a literal/length symbol with the fixed Huffman code
+	/// </summary>
+	void writeSymbol(BitWriter& bits, const u16 symbol)
+	{
+		if (symbol <= 143) bits.writeHuffman(0x30 + symbol, 8);
+		else if (symbol <= 255) bits.writeHuffman(0x190 + symbol - 144, 9);
+		else if (symbol <= 279) bits.writeHuffman(symbol - 256, 7);
+		else bits.writeHuffman(0xC0 + symbol - 280, 8);
+	}
+
+	void writeMatch(BitWriter& bits, const u32 length, const u32 distance)
+	{
+		u8 lengthCode = static_cast<u8>(lengthBase.size() - 1);
+		while (lengthBase[lengthCode] > length) --lengthCode;
+		writeSymbol(bits, 257 + lengthCode);
+		bits.write(length - lengthBase[lengthCode], lengthExtraBits[lengthCode]);
+
+		u8 distanceCode = static_cast<u8>(distanceBase.size() - 1);
+		while (distanceBase[distanceCode] > distance) --distanceCode;
+		bits.writeHuffman(distanceCode, 5);
+		bits.write(distance - distanceBase[distanceCode], distanceExtraBits[distanceCode]);
+	}
+
+	/// <summary>
+	/// Compresses data into a zlib stream with a single fixed-Huffman deflate block.
+	/// Matches are found with a short hash chain, which is plenty for rendered frames that are mostly flat color.
+	/// </summary>
+	std::vector<u8> zlibCompress(const std::vector<u8>& data)
+	{
+		constexpr u32 windowSize = 32768, minMatch = 3, maxMatch = 258, maxChain = 8;
+		constexpr u32 hashBits = 15;
+
+		std::vector<u8> out;
+		out.reserve(data.size() / 8 + 64);
+		out.push_back(0x78); //Deflate with a 32K window
+		out.push_back(0x01); //No preset dictionary, fastest compression
+
+		BitWriter bits{ out };
+		bits.write(1, 1); //Final block
+		bits.write(1, 2); //Fixed Huffman codes
+
+		std::vector<s32> head(size_t(1) << hashBits, -1);
+		std::vector<s32> previous(windowSize, -1);
+		auto hash = [&data](const size_t position)
+		{
+			const u32 value = data[position] | (data[position + 1] << 8) | (data[position + 2] << 16);
+			return (value * 2654435761u) >> (32 - hashBits);
+		};
+		auto insert = [&](const size_t position)
+		{
+			if (position + minMatch > data.size()) return;
+			const u32 key = hash(position);
+			previous[position % windowSize] = head[key];
+			head[key] = static_cast<s32>(position);
+		};
+
+		size_t position = 0;
+		while (position < data.size())
+		{
+			u32 bestLength = 0, bestDistance = 0;
+			if (position + minMatch <= data.size())
+			{
+				const u32 longest = static_cast<u32>(std::min<size_t>(maxMatch, data.size() - position));
+				s32 candidate = head[hash(position)];
+				for (u32 chain = 0; chain < maxChain && candidate >= 0 && position - candidate <= windowSize; ++chain)
+				{
+					u32 length = 0;
+					while (length < longest && data[candidate + length] == data[position + length]) ++length;
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = static_cast<u32>(position - candidate);
+						if (length == longest) break;
+					}
+					const s32 next = previous[candidate % windowSize];
+					if (next >= candidate) break; //The slot has been reused by a newer position
+					candidate = next;
+				}
+			}
+
+			if (bestLength >= minMatch)
+			{
+				writeMatch(bits, bestLength, bestDistance);
+				for (u32 i = 0; i < bestLength; ++i) insert(position + i);
+				position += bestLength;
+			}
+			else
+			{
+				writeSymbol(bits, data[position]);
+				insert(position);
+				++position;
+			}
+		}
+		writeSymbol(bits, 256); //End of block
+		bits.flush();
+
+		u32 a = 1, b = 0; //Adler-32
+		for (const u8 byte : data)
+		{
+			a = (a + byte) % 65521;
+			b = (b + a) % 65521;
+		}
+		const u32 adler = (b << 16) | a;
+		for (s8 shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<u8>(adler >> shift));
+		return out;
+	}
+
+	u32 crc32(const u8* data, const size_t size, u32 crc = 0)
+	{
+		static const std::array<u32, 256> table = []()
+		{
+			std::array<u32, 256> values{};
+			for (u32 n = 0; n < 256; ++n)
+			{
+				u32 c = n;
+				for (u8 k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				values[n] = c;
+			}
+			return values;
+		}();
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; ++i) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	void writeBigEndian(std::vector<u8>& out, const u32 value)
+	{
+		for (s8 shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<u8>(value >> shift));
+	}
+
+	void writeChunk(std::vector<u8>& out, const char type[4], const std::vector<u8>& data)
+	{
+		writeBigEndian(out, static_cast<u32>(data.size()));
+		const size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+		writeBigEndian(out, crc32(out.data() + start, out.size() - start));
+	}
+
+	bool writeFile(const std::filesystem::path& path, const std::vector<u8>& data)
+	{
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		return file.good();
+	}
+
+	std::string frameFileName(const u32 index)
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "frame-%06u.png", index);
+		return name;
+	}
+}
+
+/// <summary>
+/// Opens the output and starts the worker threads
+/// </summary>
+/// <param name="output">The directory for PNG frames, or the file for Y4M and raw video</param>
+/// <param name="format">How to encode the frames</param>
+/// <param name="width">The width of every frame, in pixels</param>
+/// <param name="height">The height of every frame, in pixels</param>
+/// <param name="frameRateNumerator">The frame rate of the video is frameRateNumerator / frameRateDenominator. Only used by Y4M</param>
+/// <param name="frameRateDenominator"></param>
+/// <param name="threads">How many frames to encode at once</param>
+FrameEncoder::FrameEncoder(const std::filesystem::path& output, const Format format, const u16 width, const u16 height,
+	const u32 frameRateNumerator, const u32 frameRateDenominator, const u8 threads) :
+	m_output(output), m_format(format), m_width(width), m_height(height), m_maxInFlight(std::max<u32>(threads, 1) * 2)
+{
+	std::error_code error;
+	if (m_format == Format::Png)
+	{
+		std::filesystem::create_directories(m_output, error);
+		m_open = std::filesystem::is_directory(m_output, error);
+	}
+	else
+	{
+		m_file.open(m_output, std::ios::binary | std::ios::trunc);
+		m_open = m_file.is_open();
+		if (m_open && m_format == Format::Y4m)
+		{
+			m_file << "YUV4MPEG2 W" << m_width << " H" << m_height << " F" << frameRateNumerator << ":" << frameRateDenominator << " Ip A1:1 C420jpeg\n";
+		}
+	}
+	if (!m_open)
+	{
+		std::cerr << "Could not open " << m_output << " for writing" << std::endl;
+		return;
+	}
+
+	for (u8 i = 0; i < std::max<u8>(threads, 1); ++i)
+	{
+		m_workers.emplace_back(&FrameEncoder::worker, this);
+	}
+}
+
+FrameEncoder::~FrameEncoder()
+{
+	finish();
+}
+
+const bool FrameEncoder::isOpen() const
+{
+	return m_open;
+}
+
+/// <summary>
+/// Queues a copy of a frame to be encoded. Blocks while too many earlier frames are still being encoded.
+/// </summary>
+/// <param name="pixels">The frame, as rows of RGBA pixels from the top left</param>
+void FrameEncoder::submit(const std::vector<u8>& pixels)
+{
+	if (!m_open) return;
+
+	std::vector<u8> buffer;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_spaceAvailable.wait(lock, [this] { return m_submitted - m_written < m_maxInFlight; });
+		if (!m_freeBuffers.empty())
+		{
+			buffer = std::move(m_freeBuffers.back());
+			m_freeBuffers.pop_back();
+		}
+	}
+	buffer.assign(pixels.begin(), pixels.end());
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.push_back(Frame{ m_submitted++, std::move(buffer) });
+	}
+	m_workAvailable.notify_one();
+}
+
+/// <summary>
+/// Waits for every submitted frame to be written and stops the workers. Safe to call more than once.
+/// </summary>
+/// <returns>Returns false if any frame couldn't be written</returns>
+bool FrameEncoder::finish()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_workAvailable.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		if (worker.joinable()) worker.join();
+	}
+	if (m_file.is_open())
+	{
+		m_file.close();
+		if (m_file.fail()) m_failed = true;
+	}
+	return m_open && !m_failed;
+}
+
+const u32 FrameEncoder::getFramesWritten() const
+{
+	return m_written;
+}
+
+/// <summary>
+/// Encodes queued frames until the encoder is finished. Stream formats hand their frames back to be written in order,
+/// PNG frames go straight to their own files.
+/// </summary>
+void FrameEncoder::worker()
+{
+	while (true)
+	{
+		Frame frame;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_workAvailable.wait(lock, [this] { return !m_queue.empty() || m_stopping; });
+			if (m_queue.empty()) return;
+			frame = std::move(m_queue.front());
+			m_queue.pop_front();
+		}
+
+		std::vector<u8> encoded;
+		bool written = true;
+		switch (m_format)
+		{
+		case Format::Png:
+			written = writeFile(m_output / frameFileName(frame.index), encodePng(frame.pixels.data(), m_width, m_height));
+			break;
+		case Format::Y4m:
+			encodeY4m(frame.pixels.data(), encoded);
+			break;
+		case Format::Raw:
+			encoded.swap(frame.pixels);
+			break;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!frame.pixels.empty()) m_freeBuffers.push_back(std::move(frame.pixels));
+			if (!written) m_failed = true;
+
+			if (m_format == Format::Png)
+			{
+				++m_written;
+			}
+			else
+			{
+				m_encoded.emplace(frame.index, std::move(encoded));
+				for (auto next = m_encoded.begin(); next != m_encoded.end() && next->first == m_written; next = m_encoded.erase(next))
+				{
+					m_file.write(reinterpret_cast<const char*>(next->second.data()), next->second.size());
+					if (!m_file.good()) m_failed = true;
+					++m_written;
+				}
+			}
+		}
+		m_spaceAvailable.notify_all();
+	}
+}
+
+/// <summary>
+/// Converts a frame to a Y4M frame: full range BT.601 luma for every pixel, and chroma averaged over every 2x2 block of pixels
+/// </summary>
+/// <param name="pixels">The RGBA frame</param>
+/// <param name="encoded">Where to write the frame, including its FRAME header</param>
+void FrameEncoder::encodeY4m(const u8* pixels, std::vector<u8>& encoded) const
+{
+	constexpr char frameHeader[] = "FRAME\n";
+	const size_t lumaSize = static_cast<size_t>(m_width) * m_height;
+	const u16 chromaWidth = (m_width + 1) / 2, chromaHeight = (m_height + 1) / 2;
+	const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight;
+
+	encoded.resize(sizeof(frameHeader) - 1 + lumaSize + chromaSize * 2);
+	std::copy(frameHeader, frameHeader + sizeof(frameHeader) - 1, encoded.begin());
+	u8* luma = encoded.data() + sizeof(frameHeader) - 1;
+	u8* blueChroma = luma + lumaSize;
+	u8* redChroma = blueChroma + chromaSize;
+
+	for (size_t i = 0; i < lumaSize; ++i)
+	{
+		const u8* pixel = pixels + i * 4;
+		luma[i] = static_cast<u8>((77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8);
+	}
+
+	for (u16 chromaY = 0; chromaY < chromaHeight; ++chromaY)
+	{
+		for (u16 chromaX = 0; chromaX < chromaWidth; ++chromaX)
+		{
+			s32 red = 0, green = 0, blue = 0;
+			for (u8 corner = 0; corner < 4; ++corner)
+			{
+				const u16 x = std::min<u16>(chromaX * 2 + (corner & 1), m_width - 1);
+				const u16 y = std::min<u16>(chromaY * 2 + (corner >> 1), m_height - 1);
+				const u8* pixel = pixels + (static_cast<size_t>(y) * m_width + x) * 4;
+				red += pixel[0];
+				green += pixel[1];
+				blue += pixel[2];
+			}
+			const size_t index = static_cast<size_t>(chromaY) * chromaWidth + chromaX;
+			blueChroma[index] = static_cast<u8>(std::clamp(((-43 * red - 85 * green + 128 * blue + 512) >> 10) + 128, 0, 255));
+			redChroma[index] = static_cast<u8>(std::clamp(((128 * red - 107 * green - 21 * blue + 512) >> 10) + 128, 0, 255));
+		}
+	}
+}
+
+/// <summary>
+/// Encodes an RGBA frame as an 8 bit RGB PNG. Alpha is dropped since rendered frames are always opaque.
+/// </summary>
+/// <param name="pixels">The frame, as rows of RGBA pixels from the top left</param>
+/// <param name="width">The width of the frame, in pixels</param>
+/// <param name="height">The height of the frame, in pixels</param>
+/// <returns>The PNG file's contents</returns>
+std::vector<u8> FrameEncoder::encodePng(const u8* pixels, const u16 width, const u16 height)
+{
+	std::vector<u8> scanlines;
+	scanlines.reserve((static_cast<size_t>(width) * 3 + 1) * height);
+	for (u16 y = 0; y < height; ++y)
+	{
+		scanlines.push_back(0); //No filter
+		const u8* row = pixels + static_cast<size_t>(y) * width * 4;
+		for (u16 x = 0; x < width; ++x)
+		{
+			scanlines.insert(scanlines.end(), row + x * 4, row + x * 4 + 3);
+		}
+	}
+
+	std::vector<u8> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	std::vector<u8> header;
+	writeBigEndian(header, width);
+	writeBigEndian(header, height);
+	header.insert(header.end(), { 8, 2, 0, 0, 0 }); //8 bit RGB, deflate, adaptive filtering, no interlacing
+	writeChunk(png, "IHDR", header);
+	writeChunk(png, "IDAT", zlibCompress(scanlines));
+	writeChunk(png, "IEND", {});
+	return png;
+}
+
+/// <summary>
+/// Encodes a single frame as a PNG and writes it to a file
+/// </summary>
+/// <returns>Returns false if the file couldn't be written</returns>
+bool FrameEncoder::savePng(const std::filesystem::path& path, const u8* pixels, const u16 width, const u16 height)
+{
+	return writeFile(path, encodePng(pixels, width, height));
+}
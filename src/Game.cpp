@@ -1,103 +1,648 @@
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <ctime>
+#include <bit>
 
 #include "../Headers/Game.hpp"
+#include "../Headers/Zobrist.hpp"
 
+namespace
+{
+	/// <summary>
+	/// Writes a label and a number, and optionally "/total", into the buffer. Used instead of building std::strings so drawing the text doesn't allocate every frame.
+	/// </summary>
+	/// <returns>The formatted text, which points into the buffer</returns>
+	std::string_view formatText(std::array<char, 32>& buffer, const std::string_view label, const u64 value, const u64 total = 0)
+	{
+		char* out = std::copy(label.begin(), label.end(), buffer.data());
+		out = std::to_chars(out, buffer.data() + buffer.size(), value).ptr;
+		if (total > 0)
+		{
+			*out++ = '/';
+			out = std::to_chars(out, buffer.data() + buffer.size(), total).ptr;
+		}
+		return std::string_view(buffer.data(), out - buffer.data());
+	}
+}
 
 /// <summary>
 /// Initialzer for the Game class
 /// Initializes the window, renderer, and input controller, and sets the game up.
+/// The game does not start until run() is called.
 /// </summary>
 Game::Game(const u8 numPlayers, const u8 gameWidth, const u8 gameHeight, const u16 boardXOffset, const u16 boardYOffset, const u16 windowWidth, const u16 windowHeight,
     Renderer* const renderer, Board* const board, InputController* const inputController,
-	MusicController* const musicController, PieceState* const pieceState, Blocks* const blocks) :
-	m_numPlayers(numPlayers), m_timeToNextDrop(m_framesPerDrop[m_level] / m_framesPerSecond),
+	MusicController* const musicController, PieceState* const pieceState, Blocks* const blocks, const bool interpolatePieces) :
+	m_numPlayers(numPlayers),
 	m_gameWidth(gameWidth), m_gameHeight(gameHeight), m_boardXOffset(boardXOffset), m_boardYOffset(boardYOffset), m_totalWidth(windowWidth), m_totalHeight(windowHeight),
-	m_board(board), m_renderer(renderer), m_inputController(inputController), m_musicController(musicController), m_pieceState(pieceState), m_blockGenerator(blocks)
+	m_board(board), m_renderer(renderer), m_inputController(inputController), m_musicController(musicController), m_pieceState(pieceState), m_blockGenerator(blocks), m_rotationSystem(pieceState, blocks),
+	m_interpolatePieces(interpolatePieces)
 {
+	m_pendingMoves.reserve(16);
+	if (renderer != nullptr) m_views.push_back(std::make_unique<View>(renderer, allPlayers)); //Headless games have no view, and so no particle pool
+	m_replay.reset(m_blockGenerator->getSeed(), numPlayers, gameWidth, gameHeight, m_board->getBoardHeight(), m_gravity);
+	m_playerFalls.resize(numPlayers);
 	for (u8 playerIndex = 0; playerIndex < numPlayers; ++playerIndex)
 	{
 		m_playerStates.push_back(std::make_unique<State>(State()));
-		m_playerStates[playerIndex]->nextPiece = std::make_unique<Piece>(m_blockGenerator->getBlock());
+		m_playerStates[playerIndex]->setNextPiece(&m_blockGenerator->getBlock());
 		newPiece(playerIndex);
 
-		PlayerColor pc;
-		if (playerIndex == 0)
-		{
-			pc.fillColor = sf::Color::Red;
-			pc.ghostFillColor = RedPlayerGhostFill;
-		}
-		else if (playerIndex == 1)
-		{
-			pc.fillColor = sf::Color::Blue;
-			pc.ghostFillColor = BluePlayerGhostFill;
-		}
-		else if (playerIndex == 2)
+		m_playerColors.push_back(getPlayerColor(playerIndex));
+	}
+	updateLevel();
+}
+
+/// <summary>
+/// Makes sure the render threads are no longer using the windows before the game is destroyed
+/// </summary>
+Game::~Game()
+{
+	stopRenderThreads();
+}
+
+/// <summary>
+/// The colors every player's pieces are drawn with
+/// </summary>
+/// <param name="colorIndex">Which player's colors to get</param>
+/// <returns></returns>
+PlayerColor Game::getPlayerColor(const u8 colorIndex)
+{
+	PlayerColor pc;
+	if (colorIndex == 0)
+	{
+		pc.fillColor = sf::Color::Red;
+		pc.ghostFillColor = RedPlayerGhostFill;
+	}
+	else if (colorIndex == 1)
+	{
+		pc.fillColor = sf::Color::Blue;
+		pc.ghostFillColor = BluePlayerGhostFill;
+	}
+	else if (colorIndex == 2)
+	{
+		pc.fillColor = sf::Color::Yellow;
+		pc.ghostFillColor = YellowPlayerGhostFill;
+	}
+	else if (colorIndex == 3)
+	{
+		pc.fillColor = sf::Color::Magenta;
+		pc.ghostFillColor = MagentaPlayerGhostFill;
+	}
+	return pc;
+}
+
+/// <summary>
+/// Changes the colors a player's pieces are drawn with, e.g. so each board in versus mode keeps its player's colors
+/// </summary>
+/// <param name="playerIndex">The player to recolor</param>
+/// <param name="color">The new colors</param>
+void Game::setPlayerColor(const u8 playerIndex, const PlayerColor& color)
+{
+	m_playerColors[playerIndex] = color;
+}
+
+/// <summary>
+/// Starts the game. The calling thread polls input and runs the simulation while a separate thread renders every view.
+/// Returns once the window has been closed, or the player has gone back to the menu from the game over screen. The window is left open in that case.
+/// </summary>
+void Game::run()
+{
+	publishSnapshot();
+	startRenderThreads();
+	Tracer::setThreadName("game");
+
+	publishEvent(GameEvent::Type::NewGame, 0, m_numPlayers);
+	if (m_level > 0) publishEvent(GameEvent::Type::LevelUp, 0, m_level); //A resumed game doesn't start on the first level
+	m_musicController->startMusic();
+	loop();
+
+	stopRenderThreads();
+	m_musicController->stopMusic();
+}
+
+/// <summary>
+/// Adds another window for the game to be drawn to, with its own render thread, e.g. a window per player on their own monitor.
+/// The window is only drawn to; it is up to its owner to poll its events and close it once the game is over. Must be called before run.
+/// </summary>
+/// <param name="renderer">Draws to the window</param>
+/// <param name="followedPlayer">The player whose next, held and ghost pieces the view shows, or allPlayers for a spectator view showing everyone's</param>
+void Game::addView(Renderer* const renderer, const u8 followedPlayer)
+{
+	if (m_views.size() >= maxViews)
+	{
+		std::cout << "A game can't be shown in more than " << static_cast<int>(maxViews) << " windows" << std::endl;
+		return;
+	}
+	m_views.push_back(std::make_unique<View>(renderer, followedPlayer));
+}
+
+/// <summary>
+/// Attaches a spectator feed that every published tick is also written to. Pass nullptr to stop publishing.
+/// </summary>
+/// <param name="spectatorFeed">The feed to publish to</param>
+void Game::setSpectatorFeed(SpectatorFeed* const spectatorFeed)
+{
+	m_spectatorFeed = spectatorFeed;
+}
+
+/// <summary>
+/// Sets where the game is saved to when the window is closed mid-game. Pass nullptr to disable saving.
+/// </summary>
+/// <param name="saveGame">The save file to use</param>
+void Game::setSaveGame(SaveGame* const saveGame)
+{
+	m_saveGame = saveGame;
+}
+
+/// <summary>
+/// Sets the leaderboard finished games are submitted to. Pass nullptr to stop recording scores.
+/// </summary>
+/// <param name="leaderboard">The leaderboard to use</param>
+void Game::setLeaderboard(Leaderboard* const leaderboard)
+{
+	m_leaderboard = leaderboard;
+}
+
+/// <summary>
+/// Sets the telemetry that input and rendering metrics are reported to. Pass nullptr to stop reporting.
+/// Gameplay metrics reach the telemetry through the event bus.
+/// </summary>
+/// <param name="telemetry">The telemetry to report to</param>
+void Game::setTelemetry(Telemetry* const telemetry)
+{
+	m_telemetry = telemetry;
+}
+
+/// <summary>
+/// Sets the event bus that gameplay events are published to. Pass nullptr to stop publishing.
+/// </summary>
+/// <param name="eventBus">The bus to publish to</param>
+void Game::setEventBus(EventBus* const eventBus)
+{
+	m_eventBus = eventBus;
+}
+
+/// <summary>
+/// Replaces the freshly set up game with a saved one. The save must be mapped and must have been made with the same number of players.
+/// </summary>
+/// <param name="save">The mapped save file</param>
+/// <returns>Returns false (and leaves the game untouched) if the save doesn't fit this game</returns>
+bool Game::loadGame(const SaveGame& save)
+{
+	const SaveGame::Header* header = save.getHeader();
+	if (header == nullptr || header->numPlayers != m_numPlayers || header->gameWidth != m_gameWidth || header->boardHeight != m_board->getBoardHeight())
+	{
+		return false;
+	}
+	const SaveGame::PlayerRecord* players = save.getPlayers();
+	const u8 blockTypes = m_blockGenerator->getBlockTypeCount();
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		const SaveGame::PlayerRecord& player = players[playerIndex];
+		if (player.piece >= blockTypes || player.nextPiece >= blockTypes || (player.heldPiece >= blockTypes && player.heldPiece != PlayerSnapshot::noPiece)) return false;
+		if (player.rotation > 3) return false;
+
+		//Every block of the falling piece has to be inside the playing field
+		const RotationSystem::PieceMask& mask = m_rotationSystem.getMask(player.piece, player.rotation);
+		for (u8 row = 0; row < mask.size(); ++row)
 		{
-			pc.fillColor = sf::Color::Yellow;
-			pc.ghostFillColor = YellowPlayerGhostFill;
+			if (mask[row] == 0) continue;
+
+			const int left = player.xOffset + std::countr_zero(mask[row]);
+			const int right = player.xOffset + std::bit_width(mask[row]) - 1;
+			if (left < 0 || right >= m_gameWidth || player.yOffset + row >= m_gameHeight) return false;
 		}
-		else if (playerIndex == 3)
+	}
+
+	//Every cell is empty or belongs to one of the players
+	const u8* board = save.getBoard();
+	for (size_t cell = 0; cell < size_t(header->boardHeight) * header->gameWidth; ++cell)
+	{
+		if (board[cell] > m_numPlayers) return false;
+	}
+
+	//Each player draws two pieces to start with, then at most one when a piece locks and one when it is first held, every tick.
+	//A save claiming more would also take ages to fast forward the generator to.
+	if (header->blocksDrawn > (u64(header->tick) + 2) * m_numPlayers * 2) return false;
+
+	for (u8 y = 0; y < header->boardHeight; ++y)
+	{
+		for (u8 x = 0; x < header->gameWidth; ++x)
 		{
-			pc.fillColor = sf::Color::Magenta;
-			pc.ghostFillColor = MagentaPlayerGhostFill;
+			m_board->setBoardPosition(x, y, board[y * header->gameWidth + x]);
 		}
-		m_playerColors.push_back(pc);
-		m_playerTimes.push_back(sf::milliseconds(m_timeToNextDrop * 1000));
 	}
-	m_musicController->startMusic();
-	updateLevel();
-	loop();
+
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		const SaveGame::PlayerRecord& player = players[playerIndex];
+		std::unique_ptr<State>& state = m_playerStates[playerIndex];
+		state->setPiece(&m_blockGenerator->getBlock(player.piece));
+		state->setNextPiece(&m_blockGenerator->getBlock(player.nextPiece));
+		state->setHeldPiece(player.heldPiece != PlayerSnapshot::noPiece ? &m_blockGenerator->getBlock(player.heldPiece) : nullptr);
+		state->setRotation(player.rotation);
+		state->setPosition(player.xOffset, player.yOffset);
+		state->setCanHoldPiece(player.canHoldPiece);
+		m_playerFalls[playerIndex] = Gravity::Fall{ player.fallProgress, player.lockTicks, player.lockResets, player.lowestRow, player.forceLock != 0 };
+	}
+
+	m_level = header->level;
+	m_lines = header->lines;
+	m_tick = header->tick;
+	m_blockGenerator->restore(header->seed, header->blocksDrawn);
+	m_resumed = true; //The replay of a resumed game can't be reproduced from its seed, so it isn't saved
+	return true;
 }
 
 /// <summary>
-/// The main game loop. Calls all necessary functions depending on the state of the game
+/// Serializes the complete game state and hands it to the save file to be written in the background
+/// </summary>
+void Game::saveGame()
+{
+	if (m_saveGame == nullptr) return;
+
+	const u8 boardHeight = m_board->getBoardHeight();
+	const size_t boardSize = SaveGame::boardSize(static_cast<u8>(m_gameWidth), boardHeight);
+	m_saveBuffer.assign(sizeof(SaveGame::Header) + boardSize + m_numPlayers * sizeof(SaveGame::PlayerRecord), 0);
+
+	SaveGame::Header header{};
+	header.magic = SaveGame::saveMagic;
+	header.version = SaveGame::saveVersion;
+	header.numPlayers = m_numPlayers;
+	header.gameWidth = static_cast<u8>(m_gameWidth);
+	header.gameHeight = static_cast<u8>(m_gameHeight);
+	header.boardHeight = boardHeight;
+	header.level = m_level;
+	header.lines = m_lines;
+	header.tick = m_tick;
+	header.seed = m_blockGenerator->getSeed();
+	header.blocksDrawn = m_blockGenerator->getBlocksDrawn();
+	std::memcpy(m_saveBuffer.data(), &header, sizeof(header));
+
+	const std::vector<u8>& board = m_board->getBoardData();
+	std::copy(board.begin(), board.end(), m_saveBuffer.begin() + sizeof(header));
+
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		const std::unique_ptr<State>& state = m_playerStates[playerIndex];
+		SaveGame::PlayerRecord player{};
+		player.piece = state->piece->type;
+		player.nextPiece = state->nextPiece->type;
+		player.heldPiece = state->heldPiece != nullptr ? state->heldPiece->type : PlayerSnapshot::noPiece;
+		player.rotation = state->rotation;
+		player.xOffset = state->xOffset;
+		player.yOffset = state->yOffset;
+		player.canHoldPiece = state->canHoldPiece;
+		player.lockResets = m_playerFalls[playerIndex].lockResets;
+		player.fallProgress = m_playerFalls[playerIndex].progress;
+		player.lockTicks = m_playerFalls[playerIndex].lockTicks;
+		player.forceLock = m_playerFalls[playerIndex].forceLock;
+		player.lowestRow = m_playerFalls[playerIndex].lowestRow;
+		std::memcpy(m_saveBuffer.data() + sizeof(header) + boardSize + playerIndex * sizeof(player), &player, sizeof(player));
+	}
+
+	m_saveGame->writeAsync(m_saveBuffer);
+}
+
+/// <summary>
+/// The main game loop, a state machine over the session. While playing, the simulation advances at a fixed tick rate, independent of
+/// how fast the render threads can draw, and a snapshot of the game state is published after every tick for the render threads to pick up.
+/// Restarting from the game over screen resets the state and carries on in this same loop.
 /// </summary>
 void Game::loop()
 {
-	while (!m_quit && m_renderer->isWindowOpen())
+	m_session = m_quit ? SessionState::GameOver : SessionState::Playing;
+	m_accumulator = sf::Time::Zero;
+	m_clock.restart();
+	while (m_session != SessionState::Closed && m_renderer->isWindowOpen())
 	{
 		input();
-		renderGame();
-		sf::Time timeDiff = m_clock.restart();
-		for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+		switch (m_session)
 		{
-			if (m_playerTimes[playerIndex].asMilliseconds() <= 0)
+		case SessionState::Playing:
+			m_accumulator += m_clock.restart();
+			while (m_accumulator >= m_timePerTick && !m_quit)
 			{
-				if (hasCollided(playerIndex))
-				{
-					updateBoard(playerIndex);
-
-					if (m_numPlayers > 1) movePlayerPieces(playerIndex);
-
-					clearLines();
-					m_quit = hasLost();
-					updateLevel();
-					newPiece(playerIndex);
-				}
-				else
-				{
-					++m_playerStates[playerIndex]->yOffset;
-				}
-				setTimeNextDrop(playerIndex);
+				tick();
+				publishSnapshot();
+				m_accumulator -= m_timePerTick;
 			}
-			else
+			if (m_quit) endGame();
+			else sf::sleep(m_timePerTick - m_accumulator);
+			break;
+
+		case SessionState::GameOver:
+			if (m_leaderboardTicket != 0 && m_leaderboard->getResult(m_leaderboardTicket, m_leaderboardResult))
 			{
-				m_playerTimes[playerIndex] -= timeDiff;
+				m_leaderboardTicket = 0; //Ranked, show it on the game over screen
+				publishSnapshot();
 			}
+			sf::sleep(m_timePerTick);
+			break;
+
+		case SessionState::Closed:
+			break;
 		}
 	}
-	while (m_quit && m_renderer->isWindowOpen())
+}
+
+/// <summary>
+/// Moves a game that has just been lost to the game over screen. Saves its replay and submits its score.
+/// </summary>
+void Game::endGame()
+{
+	m_session = SessionState::GameOver;
+	if (m_saveGame != nullptr) m_saveGame->remove(); //The saved session is over
+	const std::string replay = m_resumed ? "" : saveReplay();
+	submitScore(replay);
+	publishSnapshot();
+}
+
+/// <summary>
+/// Advances the game by one fixed step. Applies the moves made since the last tick, then counts down every player's drop timer.
+/// Every applied move is recorded so the game can be replayed.
+/// </summary>
+void Game::tick()
+{
+	const AllocationTracker::Scope allocationScope(AllocationPhase::Tick);
+	const bool wasOver = m_quit;
+	if (m_telemetry != nullptr) m_telemetry->inputQueueDepth(static_cast<u32>(m_pendingMoves.size()));
+	for (const PlayerMove& move : m_pendingMoves)
 	{
-		m_renderer->clearRenderer();
-		input();
-		m_board->renderBoard(m_renderer, m_playerColors);
-		m_renderer->drawBorder(m_gameWidth, m_gameHeight);
-		renderText();
-		m_renderer->showRenderer();
+		m_replay.recordMove(m_tick, move);
+		applyMove(move);
+	}
+	m_pendingMoves.clear();
+
+	//Every player's piece falls against the board as it was at the start of the tick. No player's drop depends on another's,
+	//so the order they are run in doesn't matter; the pieces that come to rest are locked together afterwards.
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		const Tracer::Scope traceScope("drop", playerIndex);
+		m_locking[playerIndex] = applyGravity(playerIndex);
+	}
+	commitLocks();
+	if (!m_quit)
+	{
+		updateBots();
+		updateHints();
+	}
+	else if (!wasOver)
+	{
+		publishEvent(GameEvent::Type::GameOver);
+	}
+	++m_tick;
+	m_replay.setTicks(m_tick);
+	if (m_musicController != nullptr) m_musicController->update(m_level, m_board->getStackHeight(), m_board->getBoardHeight());
+}
+
+/// <summary>
+/// Locks the pieces that came to rest this tick into the board, then clears the full rows once for all of them.
+/// When several players lock in the same tick, the pieces are locked in turn starting from a different player every tick,
+/// so no player always wins. A piece whose cells were taken by a piece locked before it this tick doesn't lock:
+/// it is pushed up out of the board with the pieces still falling, and lands on top later.
+/// </summary>
+void Game::commitLocks()
+{
+	std::array<u8, maxPlayers> lockOrder{};
+	u8 lockCount = 0;
+	const u8 firstPlayer = static_cast<u8>(m_tick % m_numPlayers);
+	for (u8 turn = 0; turn < m_numPlayers; ++turn)
+	{
+		const u8 playerIndex = (firstPlayer + turn) % m_numPlayers;
+		if (!m_locking[playerIndex]) continue;
+
+		const std::unique_ptr<State>& state = m_playerStates[playerIndex];
+		if (lockCount > 0 && !m_rotationSystem.fits(*m_board, state->piece->type, state->rotation, state->xOffset, state->yOffset, static_cast<u8>(m_gameHeight)))
+		{
+			m_locking[playerIndex] = false;
+			continue;
+		}
+		updateBoard(playerIndex);
+		lockOrder[lockCount++] = playerIndex;
+	}
+	if (lockCount == 0) return;
+
+	const Tracer::Scope traceScope("commit", lockCount);
+	if (m_numPlayers > 1) movePlayerPieces();
+
+	//The line clear is credited to the first player locked this tick with a block in a full row
+	const u32 fullRows = m_board->getFullRows(static_cast<u8>(m_gameHeight));
+	u8 clearingPlayer = lockOrder[0];
+	for (u8 lock = 0; lock < lockCount; ++lock)
+	{
+		const std::unique_ptr<State>& state = m_playerStates[lockOrder[lock]];
+		const RotationSystem::PieceMask& mask = m_rotationSystem.getMask(state->piece->type, state->rotation);
+		u32 pieceRows = 0;
+		for (u8 row = 0; row < mask.size(); ++row)
+		{
+			const int y = state->yOffset + row;
+			if (mask[row] != 0 && y >= 0 && y < m_gameHeight) pieceRows |= u32(1) << y;
+		}
+		if ((pieceRows & fullRows) != 0)
+		{
+			clearingPlayer = lockOrder[lock];
+			break;
+		}
+	}
+	clearLines(clearingPlayer);
+	m_quit = hasLost();
+	updateLevel();
+	for (u8 lock = 0; lock < lockCount; ++lock)
+	{
+		newPiece(lockOrder[lock]);
+		m_botTurns[lockOrder[lock]] = true;
 	}
 }
 
+/// <summary>
+/// Queues a move to be applied at the start of the next tick
+/// </summary>
+/// <param name="move">The move and the player who made it</param>
+void Game::queueMove(const PlayerMove move)
+{
+	if (move.player < m_numPlayers) m_pendingMoves.push_back(move);
+}
+
+const bool Game::isGameOver() const
+{
+	return m_quit;
+}
+
+const u32 Game::getTick() const
+{
+	return m_tick;
+}
+
+const u32 Game::getLines() const
+{
+	return m_lines;
+}
+
+const u8 Game::getLevel() const
+{
+	return m_level;
+}
+
+/// <summary>
+/// A player's falling, next and held pieces, e.g. for agents that observe the game without a window
+/// </summary>
+/// <param name="playerIndex">The player</param>
+/// <returns></returns>
+const State& Game::getPlayerState(const u8 playerIndex) const
+{
+	return *m_playerStates[playerIndex];
+}
+
+const Replay& Game::getReplay() const
+{
+	return m_replay;
+}
+
+/// <summary>
+/// Draws the current game state once, on the calling thread. Used to render frames without a window, e.g. with a SoftwareRenderer.
+/// </summary>
+void Game::renderFrame()
+{
+	publishSnapshot();
+	if (m_views.empty()) return;
+	renderGame(*m_views[0], m_snapshots.read(0));
+}
+
+/// <summary>
+/// A hash of everything that decides how the game continues: the board, every player's pieces and position, their drop timers, and the level and lines.
+/// Two games with the same hash on the same tick will play out the same way given the same moves.
+/// The board and the pieces keep their own Zobrist hashes up to date as they change, so this costs the same every tick however full the board is,
+/// and can be compared every tick to find the exact tick two runs of a game diverge.
+/// </summary>
+/// <returns></returns>
+const u64 Game::getStateHash() const
+{
+	return hashState(false);
+}
+
+/// <summary>
+/// Works the state hash out from scratch and checks it against the incremental one. A mismatch means some part of the game state was
+/// changed without updating its hash. Far slower than getStateHash, so meant for regression runs.
+/// </summary>
+/// <returns>Returns true if the incremental hash is right</returns>
+const bool Game::isStateHashValid() const
+{
+	return hashState(true) == hashState(false);
+}
+
+/// <summary>
+/// Combines the board's and every player's hash with the rest of the state. Each player's hashes are mixed with their index,
+/// so two players swapping places doesn't hash the same.
+/// </summary>
+/// <param name="fromScratch">Whether to work the board and piece hashes out from scratch instead of using the incremental ones</param>
+/// <returns></returns>
+const u64 Game::hashState(const bool fromScratch) const
+{
+	u64 hash = fromScratch ? m_board->computeHash() : m_board->getHash();
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		const std::unique_ptr<State>& state = m_playerStates[playerIndex];
+		hash ^= Zobrist::mix((fromScratch ? state->computeHash() : state->hash) ^ Zobrist::key(Zobrist::Feature::Player, playerIndex, 1));
+
+		const Gravity::Fall& fall = m_playerFalls[playerIndex];
+		const u64 fallBits = fall.progress | static_cast<u64>(fall.lockTicks) << 32 | static_cast<u64>(fall.lockResets) << 48 | static_cast<u64>(fall.lowestRow) << 56;
+		hash ^= Zobrist::mix(fallBits ^ Zobrist::key(Zobrist::Feature::Fall, playerIndex, 1));
+		hash ^= Zobrist::key(Zobrist::Feature::ForceLock, playerIndex, fall.forceLock);
+	}
+	hash ^= Zobrist::mix((static_cast<u64>(m_lines) << 8 | m_level) ^ Zobrist::key(Zobrist::Feature::Score, 0, 1));
+	return hash;
+}
+
+/// <summary>
+/// Writes the replay of the game that just finished into the replays folder
+/// </summary>
+/// <returns>The replay's file name, or an empty string if it couldn't be saved</returns>
+std::string Game::saveReplay()
+{
+	const std::string fileName = "replay-" + std::to_string(std::time(nullptr)) + "-" + std::to_string(m_replay.getHeader().seed) + ".replay";
+	return m_replay.saveToFile(std::filesystem::current_path() / "replays" / fileName) ? fileName : "";
+}
+
+/// <summary>
+/// Hands the finished game to the leaderboard. Ranking happens in the background and is picked up by the game over loop.
+/// </summary>
+/// <param name="replay">The file name of the game's replay</param>
+void Game::submitScore(const std::string& replay)
+{
+	m_leaderboardResult = Leaderboard::Result();
+	if (m_leaderboard == nullptr) return;
+
+	m_leaderboardTicket = m_leaderboard->submit(m_numPlayers, static_cast<u8>(m_gameWidth), m_lines, m_level, m_tick, replay);
+}
+
+/// <summary>
+/// Copies the current game state into the snapshot buffer and hands it to every view's render thread.
+/// Everything the renderer needs is resolved here so the render threads never touch the live game state.
+/// </summary>
+void Game::publishSnapshot()
+{
+	const AllocationTracker::Scope allocationScope(AllocationPhase::Publish);
+	GameSnapshot& snapshot = m_snapshots.writeBuffer();
+	const std::vector<u8>& board = m_board->getBoardData();
+	std::copy(board.begin(), board.end(), snapshot.board.begin());
+
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		const std::unique_ptr<State>& state = m_playerStates[playerIndex];
+		PlayerSnapshot& player = snapshot.players[playerIndex];
+
+		player.piece = state->piece->type;
+		player.rotation = state->rotation;
+		player.xOffset = state->xOffset;
+		player.yOffset = state->yOffset;
+		player.ghostOffset = getBottom(playerIndex);
+
+		player.nextPiece = state->nextPiece->type;
+		player.nextXOffset = getPlayerStartingXOffset(playerIndex, state->nextPiece->width);
+
+		player.heldPiece = state->heldPiece != nullptr ? state->heldPiece->type : PlayerSnapshot::noPiece;
+		player.heldXOffset = state->heldPiece != nullptr ? getPlayerStartingXOffset(playerIndex, state->heldPiece->width) : 0;
+
+		player.dropProgress = static_cast<float>(m_playerFalls[playerIndex].progress) / Gravity::oneCell;
+	}
+
+	snapshot.numPlayers = m_numPlayers;
+	snapshot.boardWidth = static_cast<u8>(m_gameWidth);
+	snapshot.level = m_level;
+	snapshot.lines = m_lines;
+	snapshot.tick = m_tick;
+	snapshot.stateHash = getStateHash();
+	snapshot.gameOver = m_quit;
+	snapshot.rank = m_leaderboardResult.rank;
+	snapshot.rankedGames = m_leaderboardResult.rankedGames;
+	snapshot.effects = m_effects;
+	snapshot.effectCount = m_effectCount;
+
+	snapshot.hintCount = 0;
+	const PerfectClearSolver::Solution* solution = m_solver != nullptr ? &m_solver->getSolution() : nullptr;
+	if (solution != nullptr && solution->request == m_solverRequest && solution->status == PerfectClearSolver::Solution::Status::Found)
+	{
+		for (u8 i = 0; i < solution->placementCount && snapshot.hintCount < GameSnapshot::maxHints; ++i)
+		{
+			//Later placements are on the board as it is after the first lines are cleared, so they can't be drawn yet
+			const PerfectClearSolver::Placement& placement = solution->placements[i];
+			if (placement.linesClearedBefore > 0) break;
+			snapshot.hints[snapshot.hintCount++] = HintSnapshot{ placement.piece, placement.rotation, placement.xOffset, placement.yOffset };
+		}
+	}
+	snapshot.publishTime = m_gameClock.getElapsedTime();
+	snapshot.dropInterval = sf::microseconds(m_timePerTick.asMicroseconds() * Gravity::oneCell / std::max<u32>(m_gravity.getCellsPerTick(m_level), 1));
+
+	if (m_spectatorFeed != nullptr) m_spectatorFeed->publish(snapshot);
+	m_snapshots.publish();
+}
+
 /// <summary>
 /// Generates a new piece for the player(s) that have had their piece collide with the board
 /// </summary>
@@ -106,14 +651,16 @@ void Game::newPiece(const u8 playerIndex)
 {
 	std::unique_ptr<State>& state = m_playerStates[playerIndex];
 
-	state->piece = std::move(state->nextPiece);
-	state->nextPiece = std::make_unique<Piece>(m_blockGenerator->getBlock());
+	state->setPiece(state->nextPiece);
+	state->setNextPiece(&m_blockGenerator->getBlock());
 
 	constexpr bool startingRotation = 0;
-	state->xOffset = getPlayerStartingXOffset(playerIndex, state->piece->width);
-	state->yOffset = 0;
-	state->rotation = startingRotation;
-	state->canHoldPiece = true;
+	state->setPosition(getPlayerStartingXOffset(playerIndex, state->piece->width), 0);
+	state->setRotation(startingRotation);
+	state->setCanHoldPiece(true);
+	m_playerFalls[playerIndex] = Gravity::Fall();
+	m_hintsStale = true;
+	publishEvent(GameEvent::Type::Spawn, playerIndex);
 }
 
 /// <summary>
@@ -121,21 +668,135 @@ void Game::newPiece(const u8 playerIndex)
 /// </summary>
 void Game::updateLevel()
 {
-	m_level = m_lines / 10;
-	if (m_level > 29)
+	const u8 level = static_cast<u8>(std::min<u32>(m_lines / linesToNextLevel, maxLevel)); //Levels carry on past the end of the speed curve, which keeps its last speed
+	if (level > m_level)
 	{
-		m_level = 29; //Level 29 (30 if not 0 indexing) is the max m_level
+		Tracer::instant("level up", level + 1);
+		addEffect(EffectEvent{ EffectEvent::Type::LevelUp });
+		publishEvent(GameEvent::Type::LevelUp, 0, level);
 	}
+	m_level = level;
 }
 
 /// <summary>
-/// Sets the time for the current player for the next automatic drop of their piece
+/// Moves the player's piece down by the gravity of the current level, and counts down its lock delay while it rests on something.
+/// Reaching a new lowest row restarts the lock delay and the lock resets, so kicking a piece up and letting it fall back can't stall forever.
 /// </summary>
 /// <param name="playerIndex">The current player</param>
-void Game::setTimeNextDrop(const u8 playerIndex)
+/// <returns>Returns true if the piece should be locked into the board</returns>
+bool Game::applyGravity(const u8 playerIndex)
 {
-	m_timeToNextDrop = m_framesPerDrop[m_level] / m_framesPerSecond;
-	m_playerTimes[playerIndex] = sf::milliseconds(m_timeToNextDrop * 1000);
+	Gravity::Fall& fall = m_playerFalls[playerIndex];
+	fall.progress += m_gravity.getCellsPerTick(m_level);
+	State* const state = m_playerStates[playerIndex].get();
+	while (fall.progress >= Gravity::oneCell && !hasCollided(playerIndex))
+	{
+		state->move(0, 1);
+		fall.progress -= Gravity::oneCell;
+		if (state->yOffset > fall.lowestRow)
+		{
+			fall.lowestRow = state->yOffset;
+			fall.lockTicks = 0;
+			fall.lockResets = 0;
+		}
+	}
+
+	if (!hasCollided(playerIndex)) return false;
+
+	fall.progress = 0; //Gravity doesn't build up while the piece is resting
+	++fall.lockTicks;
+	return fall.forceLock || fall.lockTicks >= m_gravity.getLockDelay();
+}
+
+/// <summary>
+/// Restarts the lock delay of a resting piece after it was moved or rotated, up to the maximum number of resets
+/// </summary>
+/// <param name="playerIndex">The player who moved their piece</param>
+void Game::resetLockDelay(const u8 playerIndex)
+{
+	Gravity::Fall& fall = m_playerFalls[playerIndex];
+	if (fall.lockTicks > 0 && fall.lockResets < m_gravity.getMaxLockResets())
+	{
+		fall.lockTicks = 0;
+		++fall.lockResets;
+	}
+}
+
+/// <summary>
+/// Sets the gravity and lock delay the game is played with. Must be called before the game starts.
+/// </summary>
+/// <param name="gravity">The gravity settings</param>
+void Game::setGravity(const Gravity& gravity)
+{
+	m_gravity = gravity;
+	m_replay.reset(m_blockGenerator->getSeed(), m_numPlayers, m_gameWidth, m_gameHeight, m_board->getBoardHeight(), m_gravity);
+}
+
+/// <summary>
+/// Hands a player over to an engine running in another process. Must be called before the game starts.
+/// </summary>
+/// <param name="playerIndex">The player the engine plays as</param>
+/// <param name="bot">The engine, or null to give the player back to the controls</param>
+void Game::setBot(const u8 playerIndex, BotPlayer* const bot)
+{
+	if (playerIndex >= m_numPlayers) return;
+
+	m_bots[playerIndex] = bot;
+	m_botTurns[playerIndex] = true;
+	if (bot != nullptr) bot->startGame(m_numPlayers, m_gameWidth, m_gameHeight, *m_blockGenerator);
+}
+
+/// <summary>
+/// Shows perfect clear hints from the solver, which is asked for a solution every time the player's pieces change.
+/// Hints are only shown in single player games, where every piece from the generator goes to the one player.
+/// </summary>
+/// <param name="solver">The solver, or null to stop showing hints</param>
+void Game::setPerfectClearSolver(PerfectClearSolver* const solver)
+{
+	m_solver = solver;
+	m_solverRequest = 0;
+	m_hintsStale = true;
+}
+
+/// <summary>
+/// Hands the player's position to the perfect clear solver when it has changed. The solver searches on its own threads,
+/// and its solution is picked up when the snapshot is published, so this never waits on it.
+/// </summary>
+void Game::updateHints()
+{
+	if (m_solver == nullptr || !m_hintsStale || m_numPlayers != 1) return;
+	m_hintsStale = false;
+
+	//A solution needs at most a piece for every four cells in the rows it clears. The current and next pieces leave some to spare for holding.
+	std::array<u8, PerfectClearSolver::maxQueue> preview;
+	const u8 previewLength = static_cast<u8>(std::min<u32>(m_solver->getLines() * m_gameWidth / 4, preview.size()));
+	m_blockGenerator->peek(std::span<u8>(preview.data(), previewLength));
+	m_solverRequest = m_solver->request(*m_board, static_cast<u8>(m_gameWidth), static_cast<u8>(m_gameHeight), *m_playerStates[0],
+		std::span<const u8>(preview.data(), previewLength));
+}
+
+/// <summary>
+/// Asks every bot whose player has a new piece for its move, and queues the moves the bots have decided on for the next tick.
+/// Never waits on a bot; one that is still thinking just makes no move this tick. Answers are only read from the tick after the
+/// question, however fast the bot is, so a game played by bots that are waited for always plays out the same way.
+/// </summary>
+void Game::updateBots()
+{
+	const Tracer::Scope traceScope("bots");
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		BotPlayer* const bot = m_bots[playerIndex];
+		if (bot == nullptr) continue;
+
+		if (m_botTurns[playerIndex])
+		{
+			m_botTurns[playerIndex] = false;
+			bot->beginTurn(*m_board, *m_playerStates[playerIndex]);
+			continue;
+		}
+		const Move move = bot->nextMove(*m_playerStates[playerIndex]);
+		if (move != Move::None) queueMove(PlayerMove{ move, playerIndex });
+	}
 }
 
 /// <summary>
@@ -149,7 +810,7 @@ void Game::updateBoard(const u8 playerIndex)
 	{
 		for (u8 y = 0; y < state->piece->width; ++y)
 		{
-			if (m_pieceState->getPieceData(x, y, state->piece, state->rotation))
+			if (m_pieceState->getPieceData(x, y, *state->piece, state->rotation))
 			{
 				s8 bX = state->xOffset + x;
 				u8 bY = state->yOffset + y;
@@ -159,92 +820,86 @@ void Game::updateBoard(const u8 playerIndex)
 			}
 		}
 	}
+	publishEvent(GameEvent::Type::Lock, playerIndex);
+	Tracer::instant("piece lock", playerIndex);
 }
 
 /// <summary>
-/// Checks if the current row is full, starting from left to right.
-/// Returns false if any piece in the row is not filled
+/// Queues an effect for the renderer. Only the newest few are kept, older ones are overwritten.
 /// </summary>
-/// <param name="y">The row to check</param>
-/// <returns></returns>
-bool Game::isFullRow(const u8 y)
+/// <param name="effect">What happened</param>
+void Game::addEffect(const EffectEvent& effect)
 {
-	for (u8 x = 0; x < m_gameWidth; ++x)
-	{ //Every tile in a given row
-		if (!m_board->getBoardPosition(x, y))//If a single spot in a row isn't a block we don't need to keep checking it
-			return false;
-	}
-	return true;
+	m_effects[m_effectCount % GameSnapshot::effectHistory] = effect;
+	++m_effectCount;
 }
 
 /// <summary>
-/// Clears any lines that are full and moves the rows above it down.
+/// Publishes an event about a player to the event bus, if there is one. Never blocks.
 /// </summary>
-void Game::clearLines()
+/// <param name="type">What happened</param>
+/// <param name="playerIndex">Who it happened to. Their piece and where it is are sent with the event</param>
+/// <param name="value">The lines cleared, the new level, or the number of players, depending on the event</param>
+void Game::publishEvent(const GameEvent::Type type, const u8 playerIndex, const u8 value)
 {
-	m_clearedLines = 0;
-	for (u8 y = 0; y < m_gameHeight; ++y)
-	{ //Every row
-		if (isFullRow(y))
-		{
-			for (u8 x = 0; x < m_gameWidth; ++x)
-			{
-				constexpr bool pieceCleared = 0;
-				m_board->setBoardPosition(x, y, pieceCleared); //If its a full row, we clear it
-			}
-			++m_clearedLines;
-			m_yClearLevel = y;
-		}
-	}
-	m_lines += m_clearedLines; //Updating total amount of lines cleared
-	while (m_clearedLines > 0)
+	if (m_eventBus == nullptr) return;
+
+	GameEvent event{ type, playerIndex };
+	const std::unique_ptr<State>& state = m_playerStates[playerIndex];
+	if (state->piece != nullptr)
 	{
-		for (u8 y = m_yClearLevel; y > 0; --y)
-		{
-			for (u8 x = 0; x < m_gameWidth; ++x)
-			{
-				m_board->setBoardPosition(x, y, m_board->getBoardPosition(x, (y - 1)));
-			}
-		}
-		--m_clearedLines;
+		event.piece = state->piece->type;
+		event.rotation = state->rotation;
+		event.x = state->xOffset;
+		event.y = state->yOffset;
 	}
+	event.value = value;
+	event.tick = m_tick;
+	m_eventBus->publish(event);
 }
 
 /// <summary>
-/// Checks if the current player's piece has collided with the board.
+/// Clears any lines that are full and moves the rows above it down.
 /// </summary>
-/// <param name="playerIndex">The current player</param>
-/// <returns></returns>
-bool Game::hasCollided(const u8 playerIndex)
+/// <param name="playerIndex">The player whose piece completed the lines</param>
+void Game::clearLines(const u8 playerIndex)
 {
-	std::unique_ptr<State>& state = m_playerStates[playerIndex];
-	for (u8 x = 0; x < state->piece->width; ++x)
+	const Tracer::Scope traceScope("clearLines");
+	const u32 fullRows = m_board->getFullRows(static_cast<u8>(m_gameHeight));
+	m_clearedLines = static_cast<u8>(std::popcount(fullRows));
+	for (u32 rows = fullRows; rows != 0; rows &= rows - 1)
 	{
-		for (u8 y = 0; y < state->piece->width; ++y)
-		{
-			if (m_pieceState->getPieceData(x, y, state->piece, state->rotation))
-			{
-				s8 bX = state->xOffset + x;
-				u8 bY = state->yOffset + y + 1; //Checking the spot below the piece
-				if (m_board->getBoardPosition(bX, bY) || bY == m_gameHeight)
-				{
-					return true;
-				}
-			}
-		}
+		m_yClearLevel = static_cast<u8>(std::countr_zero(rows));
+		addEffect(EffectEvent{ EffectEvent::Type::LineClear, playerIndex, 0, m_yClearLevel, 0 });
 	}
-	return false;
+	m_lines += m_clearedLines; //Updating total amount of lines cleared
+	if (m_clearedLines > 0)
+	{
+		publishEvent(GameEvent::Type::LineClear, playerIndex, m_clearedLines);
+		Tracer::instant("line clear", m_clearedLines);
+	}
+	m_board->clearRows(fullRows);
+}
+
+/// <summary>
+/// Checks if the current player's piece has collided with the board.
+/// </summary>
+/// <param name="playerIndex">The current player</param>
+/// <returns></returns>
+bool Game::hasCollided(const u8 playerIndex)
+{
+	const std::unique_ptr<State>& state = m_playerStates[playerIndex];
+	return !m_rotationSystem.fits(*m_board, state->piece->type, state->rotation, state->xOffset, state->yOffset + 1, static_cast<u8>(m_gameHeight));
 }
 
 /// <summary>
-/// Moves player pieces that are attempting to occupy the same space as the current dropped piece
+/// Moves player pieces that are attempting to occupy the same space as the pieces locked this tick
 /// </summary>
-/// <param name="currentPlayerIndex">The most recently dropped/collided piece</param>
-void Game::movePlayerPieces(const u8 currentPlayerIndex)
+void Game::movePlayerPieces()
 {
 	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
 	{
-		if (playerIndex == currentPlayerIndex) continue;
+		if (m_locking[playerIndex]) continue;
 
 		std::unique_ptr<State>& state = m_playerStates[playerIndex];
 
@@ -252,7 +907,7 @@ void Game::movePlayerPieces(const u8 currentPlayerIndex)
 		{
 			for (u8 y = 0; y < state->piece->width; ++y)
 			{
-				while (m_pieceState->getPieceData(x, y, state->piece, state->rotation) && m_board->getBoardPosition(x + state->xOffset, y + state->yOffset))
+				while (m_pieceState->getPieceData(x, y, *state->piece, state->rotation) && m_board->getBoardPosition(x + state->xOffset, y + state->yOffset))
 				{
 					if (state->yOffset - 1 <= 0)
 					{
@@ -260,7 +915,7 @@ void Game::movePlayerPieces(const u8 currentPlayerIndex)
 						return;
 					}
 
-					--state->yOffset;
+					state->move(0, -1);
 				}
 			}
 		}
@@ -274,16 +929,41 @@ void Game::movePlayerPieces(const u8 currentPlayerIndex)
 /// <returns></returns>
 bool Game::hasLost()
 {
-	for (u8 x = 0; x < m_gameWidth; ++x)
+	constexpr u8 topRow = 0;
+	return !m_board->isRowEmpty(topRow);
+}
+
+/// <summary>
+/// Pushes the board up and fills the bottom rows with garbage that has a single hole, as sent by an opponent in versus mode.
+/// Falling pieces are pushed up out of the garbage. The player tops out if blocks are pushed off the top of the board,
+/// or if there is no room left for their piece.
+/// </summary>
+/// <param name="rows">How many rows of garbage to add</param>
+/// <param name="holeColumn">The column left open in every garbage row</param>
+void Game::addGarbage(u8 rows, const u8 holeColumn)
+{
+	rows = std::min<u8>(rows, static_cast<u8>(m_gameHeight));
+	if (rows == 0 || m_quit) return;
+
+	for (u8 y = 0; y < rows; ++y)
+	{
+		if (!m_board->isRowEmpty(y)) m_quit = true;
+	}
+	m_board->raiseRows(rows, static_cast<u8>(m_gameHeight), holeColumn, garbageCell);
+
+	for (const std::unique_ptr<State>& state : m_playerStates)
 	{
-		constexpr bool topRow = 0;
-		if (m_board->getBoardPosition(x, topRow))
+		while (!m_rotationSystem.fits(*m_board, state->piece->type, state->rotation, state->xOffset, state->yOffset, static_cast<u8>(m_gameHeight)))
 		{
-			m_musicController->stopMusic();
-			return true;
+			if (state->yOffset == 0)
+			{
+				m_quit = true;
+				break;
+			}
+			state->move(0, -1);
 		}
 	}
-	return false;
+	if (m_quit) publishEvent(GameEvent::Type::GameOver);
 }
 
 /// <summary>
@@ -291,275 +971,49 @@ bool Game::hasLost()
 /// </summary>
 /// <param name="state">Current piece state</param>
 /// <param name="nextRotation">The rotation to check</param>
-/// <param name="xMovement">How far left/right the piece is allowed to move, from the Tetris Wiki</param>
-/// <param name="yMovement">How far up/down the piece is allowed to move, from the Tetris Wiki</param>
+/// <param name="xMovement">How far left/right the piece is moved by the kick</param>
+/// <param name="yMovement">How far up/down the piece is moved by the kick</param>
 /// <returns></returns>
 bool Game::validRotateStatus(const std::unique_ptr<State>& state, const u8 nextRotation, const s8 xMovement, const s8 yMovement)
 {
-	for (u8 x = 0; x < state->piece->width; ++x)
-	{
-		for (u8 y = 0; y < state->piece->width; ++y)
-		{
-			if (m_pieceState->getPieceData(x, y, state->piece, nextRotation))
-			{
-				s8 bX = state->xOffset + x + xMovement;
-				s8 bY = state->yOffset + y + yMovement;
-				if(m_board->getBoardPosition(bX, bY) || bX < 0 || bX >= m_gameWidth || bY >= m_gameHeight) return false;
-			}
-			
-		}
-	}
-	return true;
+	return m_rotationSystem.fits(*m_board, state->piece->type, nextRotation, state->xOffset + xMovement, state->yOffset + yMovement, m_gameHeight);
 }
 
 /// <summary>
-/// Run through a set of 5 tests depending on rotation (pulled from tetris wiki https://tetris.wiki/Super_Rotation_System
+/// Runs through the kick tests for the rotation (https://tetris.wiki/Super_Rotation_System) and rotates the piece with the first one that fits
 /// </summary>
 /// <param name="playerIndex">The index of the player making the rotation</param>
-void Game::tryRotate(const u8 playerIndex)
+/// <param name="direction">Which way to rotate the piece</param>
+/// <returns>Returns false if none of the kicks fit</returns>
+bool Game::tryRotate(const u8 playerIndex, const RotationDirection direction)
 {
 	const std::unique_ptr<State>& state = m_playerStates[playerIndex];
-	const u8 nextRotation = (state->rotation + 1) % 4;
-
-	s8 xMovement = 0, yMovement = 0;
+	const u8 nextRotation = (state->rotation + static_cast<u8>(direction)) % 4;
 
-	constexpr u8 oPieceWidth = 2, iPieceWidth = 4;
-	if (state->piece->width == oPieceWidth) return; //O Piece cannot rotate
-
-	if (state->piece->width == iPieceWidth) //If I piece (has a unique rotation system)
+	for (const RotationSystem::Kick& kick : m_rotationSystem.getKicks(*state->piece, state->rotation, direction))
 	{
-	    //Test 1 for I Piece
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
-		}
-		//End Test 1
-
-		//Test 2 for I Piece
-		if (nextRotation == 1)
-		{
-			xMovement = -2;
-			yMovement = 0;
-		}
-		else if (nextRotation == 2)
-		{
-			xMovement = -1;
-			yMovement = 0;
-		}
-		else if (nextRotation == 3)
-		{
-			xMovement = 2;
-			yMovement = 0;
-		}
-		else
-		{
-			xMovement = 1;
-			yMovement = 0;
-		}
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
-		}
-		//End Test 2
-
-		//Test 3 for I Piece
-		if (nextRotation == 1)
-		{
-			xMovement = 1;
-			yMovement = 0;
-		}
-		else if (nextRotation == 2)
-		{
-			xMovement = 2;
-			yMovement = 0;
-		}
-		else if (nextRotation == 3)
-		{
-			xMovement = -1;
-			yMovement = 0;
-		}
-		else
-		{
-			xMovement = -2;
-			yMovement = 0;
-		}
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
-		}
-		//End Test 3
-
-		//Test 4 for I Piece:
-		if (nextRotation == 1)
-		{
-			xMovement = -2;
-			yMovement = 1;
-		}
-		else if (nextRotation == 2)
-		{
-			xMovement = -1;
-			yMovement = -2;
-		}
-		else if (nextRotation == 3)
+		const s8 yMovement = -kick.y; //The kick tables have +y pointing up, the board has +y pointing down
+		if (validRotateStatus(state, nextRotation, kick.x, yMovement))
 		{
-			xMovement = 2;
-			yMovement = -1;
-		}
-		else
-		{
-			xMovement = 1;
-			yMovement = 2;
-		}
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
-		}
-		//End Test 4
-
-		//Test 5 for I Piece:
-		if (nextRotation == 1)
-		{
-			xMovement = 1;
-			yMovement = -2;
-		}
-		else if (nextRotation == 2)
-		{
-			xMovement = 2;
-			yMovement = 1;
-		}
-		else if (nextRotation == 3)
-		{
-			xMovement = -1;
-			yMovement = 2;
-		}
-		else
-		{
-			xMovement = -2;
-			yMovement = -1;
-		}
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
-		}
-		return;
-		//End Test 5
-	}
-	else [[likely]] {
-		//Test 1 for non-I Piece
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
-		}
-		//End Test 1
-
-		//Test 2 for non-I Piece
-		if (nextRotation == 0 || nextRotation == 1)
-		{
-			xMovement = -1;
-			yMovement = 0;
-		}
-		else
-		{
-			xMovement = 1;
-			yMovement = 0;
-		}
-
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
-		}
-		//End Test 2
-
-		//Test 3 for non-I Piece
-		if (nextRotation == 1)
-		{
-			xMovement = -1;
-			yMovement = -1;
-		}
-		else if (nextRotation == 2)
-		{
-			xMovement = 1;
-			yMovement = 1;
-		}
-		else if (nextRotation == 3)
-		{
-			xMovement = 1;
-			yMovement = -1;
-		}
-		else
-		{
-			xMovement = -1;
-			yMovement = 1;
-		}
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
-		}
-		//End Test 3
-		
-		//Test 4 for non-I Piece
-		if (nextRotation == 1 || nextRotation == 3)
-		{
-			xMovement = 0;
-			yMovement = 2;
-		}
-		else
-		{
-			xMovement = 0;
-			yMovement = -2;
-		}
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
-		}
-		//End Test 4
-		
-		//Test 5 for non-I Piece
-		if (nextRotation == 1)
-		{
-			xMovement = -1;
-			yMovement = 2;
-		}
-		else if (nextRotation == 2)
-		{
-			xMovement = 1;
-			yMovement = -2;
-		}
-		else if (nextRotation == 3)
-		{
-			xMovement = 1;
-			yMovement = 2;
-		}
-		else
-		{
-			xMovement = -1;
-			yMovement = -2;
-		}
-		if (validRotateStatus(state, nextRotation, xMovement, yMovement))
-		{
-			goto rotate;
+			rotatePiece(playerIndex, nextRotation, kick.x, yMovement);
+			return true;
 		}
-		return;
-		//End Test 5
 	}
-
-	rotate:
-		rotatePiece(playerIndex, xMovement, yMovement);
-		return;
+	return false;
 }
 
 /// <summary>
-/// Pushes the piece away from the wall/board.
+/// Rotates the piece and pushes it away from the wall/board.
 /// </summary>
 /// <param name="playerIndex">The current player's piece</param>
+/// <param name="rotation">The piece's new rotation</param>
 /// <param name="x">How far left/right to move the piece after rotating</param>
 /// <param name="y">How far up/down to move the piece after rotating</param>
-void Game::rotatePiece(const u8 playerIndex, const u8 x, const u8 y)
+void Game::rotatePiece(const u8 playerIndex, const u8 rotation, const s8 x, const s8 y)
 {
 	std::unique_ptr<State>& state = m_playerStates[playerIndex];
-	state->rotation = (state->rotation + 1) % 4;
-	state->xOffset += x;
-	state->yOffset += y;
+	state->setRotation(rotation);
+	state->move(x, y);
 }
 
 /// <summary>
@@ -575,7 +1029,7 @@ bool Game::isValidMove(const Move move, const u8 playerIndex)
 	{
 		for (u8 y = 0; y < state->piece->width; ++y)
 		{
-			if (m_pieceState->getPieceData(x, y, state->piece, state->rotation))
+			if (m_pieceState->getPieceData(x, y, *state->piece, state->rotation))
 			{
 				s8 bX = state->xOffset + x;
 				u8 bY = state->yOffset + y;
@@ -591,31 +1045,101 @@ bool Game::isValidMove(const Move move, const u8 playerIndex)
 }
 
 /// <summary>
-/// Gets the input from the input controller and updates the game accordingly
+/// Gets the input from the input controller. Window and restart requests are handled straight away,
+/// gameplay moves are queued and applied at the start of the next tick.
 /// </summary>
 void Game::input()
 {
+	const AllocationTracker::Scope allocationScope(AllocationPhase::Input);
+	const Tracer::Scope traceScope("input");
 	PlayerMove pm = m_inputController->input(m_quit);
-	if (pm.player >= m_numPlayers) return;
 
+	switch (pm.move)
+	{
+	case Move::Quit:
+		if (m_session == SessionState::Playing)
+		{
+			saveGame(); //Closing the window mid-game suspends the session
+			if (!m_resumed) saveReplay();
+		}
+		m_session = SessionState::Closed;
+		stopRenderThreads();
+		m_renderer->closeWindow();
+		break;
+
+	case Move::PlayAgain:
+		if (m_session == SessionState::GameOver) restart(std::random_device()());
+		break;
+
+	case Move::ReturnToMenu:
+		if (m_session == SessionState::GameOver) m_session = SessionState::Closed;
+		break;
+
+	case Move::SaveTrace:
+		Tracer::flush();
+		break;
+
+	case Move::None:
+		break;
+
+	default:
+		if (!m_quit) queueMove(pm);
+		break;
+	}
+}
+
+/// <summary>
+/// Updates the game according to a single player's move
+/// </summary>
+/// <param name="pm">The move and the player who made it</param>
+void Game::applyMove(const PlayerMove pm)
+{
 	switch (pm.move)
 	{
 	case Move::Right:
 		if (isValidMove(Move::Right, pm.player))
-			++m_playerStates[pm.player]->xOffset;
+		{
+			m_playerStates[pm.player]->move(1, 0);
+			resetLockDelay(pm.player);
+			publishEvent(GameEvent::Type::Move, pm.player);
+		}
 		break;
 
 	case Move::Left:
 		if (isValidMove(Move::Left, pm.player))
-			--m_playerStates[pm.player]->xOffset;
+		{
+			m_playerStates[pm.player]->move(-1, 0);
+			resetLockDelay(pm.player);
+			publishEvent(GameEvent::Type::Move, pm.player);
+		}
 		break;
 
 	case Move::Down:
-		m_playerTimes[pm.player] = sf::milliseconds(0);
+		softDrop(pm.player);
 		break;
 
 	case Move::Rotate:
-		tryRotate(pm.player);
+		if (tryRotate(pm.player, RotationDirection::Clockwise))
+		{
+			resetLockDelay(pm.player);
+			publishEvent(GameEvent::Type::Rotate, pm.player);
+		}
+		break;
+
+	case Move::RotateCounterClockwise:
+		if (tryRotate(pm.player, RotationDirection::CounterClockwise))
+		{
+			resetLockDelay(pm.player);
+			publishEvent(GameEvent::Type::Rotate, pm.player);
+		}
+		break;
+
+	case Move::Rotate180:
+		if (tryRotate(pm.player, RotationDirection::Half))
+		{
+			resetLockDelay(pm.player);
+			publishEvent(GameEvent::Type::Rotate, pm.player);
+		}
 		break;
 
 	case Move::HardDrop:
@@ -626,10 +1150,6 @@ void Game::input()
 		holdPiece(pm.player);
 		break;
 
-	case Move::PlayAgain:
-		restart();
-		break;
-
 	default:
 		break;
 	}
@@ -650,7 +1170,7 @@ const u8 Game::getBottom(const u8 playerIndex)
 	{
 		for (u8 y = 0; y < state->piece->width; ++y)
 		{
-			if (m_pieceState->getPieceData(x, y, state->piece, state->rotation))
+			if (m_pieceState->getPieceData(x, y, *state->piece, state->rotation))
 			{
 				checkAmount = 0;
 				s8 bX = state->xOffset + x;
@@ -676,8 +1196,37 @@ const u8 Game::getBottom(const u8 playerIndex)
 /// <param name="playerIndex">The player dropping the piece</param>
 void Game::dropPiece(const u8 playerIndex)
 {
-	m_playerStates[playerIndex]->yOffset += getBottom(playerIndex);
-	m_playerTimes[playerIndex] = sf::milliseconds(0);
+	std::unique_ptr<State>& state = m_playerStates[playerIndex];
+	state->move(0, static_cast<s8>(getBottom(playerIndex)));
+	m_playerFalls[playerIndex].forceLock = true;
+
+	u8 left = state->piece->width, right = 0, bottom = 0;
+	for (u8 x = 0; x < state->piece->width; ++x)
+	{
+		for (u8 y = 0; y < state->piece->width; ++y)
+		{
+			if (m_pieceState->getPieceData(x, y, *state->piece, state->rotation))
+			{
+				left = std::min(left, x);
+				right = std::max(right, x);
+				bottom = std::max(bottom, y);
+			}
+		}
+	}
+	addEffect(EffectEvent{ EffectEvent::Type::HardDrop, playerIndex, static_cast<s8>(state->xOffset + left), static_cast<u8>(state->yOffset + bottom),
+		static_cast<u8>(right - left + 1) });
+}
+
+/// <summary>
+/// Moves the piece down a cell on the next tick. A piece that is already resting on something is locked instead, without waiting for the lock delay.
+/// </summary>
+/// <param name="playerIndex">The player soft dropping</param>
+void Game::softDrop(const u8 playerIndex)
+{
+	Gravity::Fall& fall = m_playerFalls[playerIndex];
+	const u32 cellsPerTick = m_gravity.getCellsPerTick(m_level);
+	if (hasCollided(playerIndex)) fall.forceLock = true;
+	else if (cellsPerTick < Gravity::oneCell) fall.progress = std::max(fall.progress, Gravity::oneCell - cellsPerTick); //At 1G and above gravity already moves it a cell every tick
 }
 
 /// <summary>
@@ -692,17 +1241,19 @@ void Game::holdPiece(const u8 playerIndex)
 	{
 		if (state->heldPiece == nullptr)
 		{
-			state->heldPiece = std::move(state->piece);
+			state->setHeldPiece(state->piece);
 			newPiece(playerIndex);
 		}
 		else
 		{
-			std::iter_swap(state->piece.get(), state->heldPiece.get());
-			state->canHoldPiece = false;
-			state->xOffset = getPlayerStartingXOffset(playerIndex, state->piece->width);
-			state->rotation = 0;
-			state->yOffset = 0;
+			state->swapHeldPiece();
+			state->setCanHoldPiece(false);
+			state->setPosition(getPlayerStartingXOffset(playerIndex, state->piece->width), 0);
+			state->setRotation(0);
+			m_playerFalls[playerIndex] = Gravity::Fall();
+			m_hintsStale = true;
 		}
+		publishEvent(GameEvent::Type::Hold, playerIndex);
 	}
 }
 
@@ -718,68 +1269,253 @@ const u8 Game::getPlayerStartingXOffset(const u8 playerIndex, const u8 pieceWidt
 }
 
 /// <summary>
-/// The main function to call all child functions responsible for sending data to the renderer. 
+/// Starts a render thread for every view. Each takes over its window's context, so the window must not be drawn to by anyone else until they stop.
 /// </summary>
-void Game::renderGame()
+void Game::startRenderThreads()
 {
-	m_renderer->clearRenderer();
+	m_rendering = true;
+	for (u8 viewIndex = 0; viewIndex < m_views.size(); ++viewIndex)
+	{
+		m_views[viewIndex]->renderer->setActive(false);
+		m_views[viewIndex]->thread = std::thread(&Game::renderLoop, this, viewIndex);
+	}
+}
 
-	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+/// <summary>
+/// A view's render thread. Draws the newest published snapshot as often as its window allows, until the game stops it.
+/// The views only share the snapshots, which are never written while being read, so a window that is slow to present doesn't hold up the others or the game.
+/// </summary>
+/// <param name="viewIndex">The view to draw, which is also its reader index in the snapshot buffer</param>
+void Game::renderLoop(const u8 viewIndex)
+{
+	View& view = *m_views[viewIndex];
+	view.renderer->setActive(true);
+	Tracer::setThreadName(viewIndex == 0 ? "render" : "render view");
+	sf::Clock frameClock;
+	while (m_rendering.load(std::memory_order_acquire))
 	{
-		std::unique_ptr<State>& state = m_playerStates[playerIndex];
-		m_pieceState->renderPiece(m_renderer, state->piece, state->rotation, state->xOffset, state->yOffset, &m_playerColors[playerIndex], PieceToDraw::NormalPiece);
-		u8 ghostPieceOffset = getBottom(playerIndex);
-		m_pieceState->renderPiece(m_renderer, state->piece, state->rotation, state->xOffset, state->yOffset, &m_playerColors[playerIndex], PieceToDraw::GhostPiece, ghostPieceOffset);
+		renderGame(view, m_snapshots.read(viewIndex));
+		const sf::Time frameTime = frameClock.restart();
+		if (m_telemetry != nullptr && viewIndex == 0) m_telemetry->frameRendered(frameTime); //The frame metrics are the main window's
+	}
+	view.renderer->setActive(false);
+}
+
+/// <summary>
+/// Stops the render threads and gives the windows' contexts back to the calling thread. Safe to call more than once.
+/// </summary>
+void Game::stopRenderThreads()
+{
+	m_rendering.store(false, std::memory_order_release);
+	for (const std::unique_ptr<View>& view : m_views)
+	{
+		if (!view->thread.joinable()) continue;
+
+		view->thread.join();
+		view->renderer->setActive(true);
+	}
+}
+
+/// <summary>
+/// Draws one complete frame of the given snapshot
+/// </summary>
+/// <param name="view">The view to draw it in</param>
+/// <param name="snapshot">The most recent published game state</param>
+void Game::renderGame(View& view, const GameSnapshot& snapshot)
+{
+	const AllocationTracker::Scope allocationScope(AllocationPhase::Render);
+	if constexpr (AllocationTracker::enabled)
+	{
+		const u64 allocations = AllocationTracker::getTotal().allocations;
+		view.frameAllocations = allocations - view.allocationsAtFrameStart; //Everything allocated on any thread since the view's last frame started
+		view.allocationsAtFrameStart = allocations;
+	}
+	const Tracer::Scope traceScope("renderGame");
+	view.renderer->clearRenderer();
+	drawGame(view, snapshot);
+
+	const Tracer::Scope showScope("showRenderer"); //Blocks on vsync, so it shows how long the frame waited for the display
+	view.renderer->showRenderer();
+}
+
+/// <summary>
+/// Draws the newest published snapshot in the main view without clearing or showing the renderer, so several games can share one frame.
+/// Must only be called from the thread that renders the game.
+/// </summary>
+void Game::drawLatestSnapshot()
+{
+	if (m_views.empty()) return;
+	drawGame(*m_views[0], m_snapshots.read(0));
+}
+
+/// <summary>
+/// The main function to call all child functions responsible for sending data to the renderer. 
+/// Only reads from the given snapshot, never from the live game state.
+/// If interpolation is enabled, falling pieces are drawn between cells based on how far they are through their drop interval.
+/// A view that follows one player shows every falling piece, but only that player's ghost, next and held pieces.
+/// </summary>
+/// <param name="view">The view to draw in</param>
+/// <param name="snapshot">The game state to draw</param>
+void Game::drawGame(View& view, const GameSnapshot& snapshot)
+{
+	Renderer* const renderer = view.renderer;
+	const float sinceTick = (m_gameClock.getElapsedTime() - snapshot.publishTime) / snapshot.dropInterval;
+	for (u8 playerIndex = 0; playerIndex < snapshot.numPlayers && !snapshot.gameOver; ++playerIndex)
+	{
+		const PlayerSnapshot& player = snapshot.players[playerIndex];
+		const Piece& piece = m_blockGenerator->getBlock(player.piece);
+		const PlayerColor* const color = &m_playerColors[playerIndex];
+
+		float yInterpolation = 0.0f;
+		if (m_interpolatePieces && player.ghostOffset > 0)
+		{
+			yInterpolation = std::clamp(player.dropProgress + sinceTick, 0.0f, 0.99f);
+		}
+		m_pieceState->renderPiece(renderer, piece, player.rotation, player.xOffset, player.yOffset + yInterpolation, color, PieceToDraw::NormalPiece);
+		if (view.followedPlayer != allPlayers && view.followedPlayer != playerIndex) continue;
+
+		m_pieceState->renderPiece(renderer, piece, player.rotation, player.xOffset, player.yOffset, color, PieceToDraw::GhostPiece, player.ghostOffset);
+
+		const Piece& nextPiece = m_blockGenerator->getBlock(player.nextPiece);
+		m_pieceState->renderPiece(renderer, nextPiece, 0, player.nextXOffset, -verticalBuffer + 1 - (nextPiece.width / 4), color, PieceToDraw::NextPiece);
+
+		if (player.heldPiece != PlayerSnapshot::noPiece)
+		{
+			m_pieceState->renderPiece(renderer, m_blockGenerator->getBlock(player.heldPiece), 0, player.heldXOffset, m_gameHeight + 2, color, PieceToDraw::HeldPiece);
+		}
+	}
 
-		m_pieceState->renderPiece(m_renderer, state->nextPiece, 0, getPlayerStartingXOffset(playerIndex, state->nextPiece->width),
-			-verticalBuffer + 1 - (state->nextPiece->width / 4), &m_playerColors[playerIndex], PieceToDraw::NextPiece);
+	//Hints are only solved for the first player
+	const bool showHints = view.followedPlayer == allPlayers || view.followedPlayer == 0;
+	for (u8 hint = 0; hint < snapshot.hintCount && showHints && !snapshot.gameOver; ++hint)
+	{
+		const HintSnapshot& placement = snapshot.hints[hint];
+		m_pieceState->renderPiece(renderer, m_blockGenerator->getBlock(placement.piece), placement.rotation, placement.xOffset, placement.yOffset,
+			&m_playerColors[0], PieceToDraw::GhostPiece);
+	}
 
-		if (state->heldPiece != nullptr)
+	for (u8 x = 0; x < snapshot.boardWidth; ++x)
+	{
+		for (u8 y = 0; y < maxBoardHeight; ++y)
 		{
-			m_pieceState->renderPiece(m_renderer, state->heldPiece, 0, getPlayerStartingXOffset(playerIndex, state->heldPiece->width),
-				m_gameHeight + 2, &m_playerColors[playerIndex], PieceToDraw::HeldPiece);
+			const u8 cell = snapshot.board[y * snapshot.boardWidth + x];
+			if (cell)
+			{
+				renderer->drawPiece(x, y, cell == garbageCell ? GarbageFill : m_playerColors[cell - 1].fillColor, sf::Color::White);
+			}
 		}
+	}
+	drawEffects(view, snapshot);
+	renderer->drawBorder(m_gameWidth, m_gameHeight);
+	renderText(view, snapshot);
+}
+
+/// <summary>
+/// Starts the effects queued since the last frame, then moves the particles on and draws them.
+/// Particles run on the game's own timeline, the tick of the snapshot plus however long it has been shown for, so a replay exported
+/// without interpolation draws exactly the same effects every time. A timeline that went backwards means the game restarted.
+/// Every view plays the effects with its own particles.
+/// </summary>
+/// <param name="view">The view being drawn</param>
+/// <param name="snapshot">The game state being drawn</param>
+void Game::drawEffects(View& view, const GameSnapshot& snapshot)
+{
+	const Tracer::Scope traceScope("particles");
+	float time = snapshot.tick * m_timePerTick.asSeconds();
+	if (m_interpolatePieces) time += std::clamp((m_gameClock.getElapsedTime() - snapshot.publishTime).asSeconds(), 0.0f, m_timePerTick.asSeconds());
+	if (time < view.particleTime)
+	{
+		view.particles.clear();
+		view.particleTime = time;
+	}
 
+	const u32 oldest = snapshot.effectCount > GameSnapshot::effectHistory ? snapshot.effectCount - GameSnapshot::effectHistory : 0;
+	for (u32 effect = std::max(view.effectsPlayed, oldest); effect < snapshot.effectCount; ++effect)
+	{
+		const EffectEvent& event = snapshot.effects[effect % GameSnapshot::effectHistory];
+		const sf::Color color = m_playerColors[event.player].fillColor;
+		switch (event.type)
+		{
+		case EffectEvent::Type::LineClear:
+			view.particles.emitLineClear(event.y, snapshot.boardWidth, color);
+			break;
+		case EffectEvent::Type::HardDrop:
+			view.particles.emitHardDrop(event.x, event.y, event.width, color);
+			break;
+		case EffectEvent::Type::LevelUp:
+			view.particles.emitLevelUp(snapshot.boardWidth, static_cast<u8>(m_gameHeight));
+			break;
+		}
 	}
-	m_board->renderBoard(m_renderer, m_playerColors);
-	m_renderer->drawBorder(m_gameWidth, m_gameHeight);
-	renderText();
+	view.effectsPlayed = snapshot.effectCount;
 
-	m_renderer->showRenderer();
+	view.particles.update(std::min(time - view.particleTime, 0.1f)); //A long stall shouldn't fling everything off the board
+	view.particleTime = time;
+	view.renderer->drawParticles(view.particles);
 }
 
 /// <summary>
 /// Sends the level information and the lines information to the renderer to be displayed
 /// </summary>
-void Game::renderText()
+/// <param name="view">The view being drawn</param>
+/// <param name="snapshot">The game state being drawn</param>
+void Game::renderText(View& view, const GameSnapshot& snapshot)
 {
-	std::string lvlStr = "Level: " + std::to_string(m_level + 1); //Levels are 1-30 but arrays are 0-indexed, so add 1 purely for display
-	std::string linesStr = "Lines: " + std::to_string(m_lines);
-	m_renderer->drawText(m_totalWidth - 150, m_totalHeight / 2 - 25, lvlStr);
-	m_renderer->drawText(m_totalWidth - 150, m_totalHeight / 2 + 25, linesStr);
-	m_renderer->drawText(100, 50, "Next: ");
-	m_renderer->drawText(100, m_totalHeight - 100, "Held: ");
+	std::array<char, 32> buffer;
+	view.renderer->drawText(m_totalWidth - 150, m_totalHeight / 2 - 25, formatText(buffer, "Level: ", snapshot.level + 1)); //Levels start at 0 internally, so add 1 purely for display
+	view.renderer->drawText(m_totalWidth - 150, m_totalHeight / 2 + 25, formatText(buffer, "Lines: ", snapshot.lines));
+	view.renderer->drawText(100, 50, "Next: ");
+	view.renderer->drawText(100, m_totalHeight - 100, "Held: ");
+
+	if (snapshot.gameOver && snapshot.rank > 0)
+	{
+		view.renderer->drawText(m_totalWidth - 150, m_totalHeight / 2 + 75, formatText(buffer, "Rank: ", snapshot.rank, snapshot.rankedGames));
+	}
+
+#ifndef NDEBUG
+	if constexpr (AllocationTracker::enabled)
+	{
+		view.renderer->drawText(m_totalWidth - 150, 50, formatText(buffer, "Allocs: ", view.frameAllocations));
+	}
+#endif
 }
 
 /// <summary>
-/// Resets the game to the starting point. Can only be called after player(s) lost.
+/// Resets the game to the starting point and starts playing again, without touching the window, the render thread or any other subsystem.
+/// Only the game state is reset, so a kiosk can restart any number of times without the cost growing.
+/// Called between ticks: from the game over screen, or by versus mode while its workers wait for the next tick.
 /// </summary>
-void Game::restart()
+/// <param name="seed">The seed for the new game's pieces</param>
+void Game::restart(const u32 seed)
 {
 	m_quit = false;
 	m_lines = 0;
 	m_clearedLines = 0;
 	m_level = 0;
 	m_yClearLevel = 0;
-	m_timeToNextDrop = m_framesPerDrop[m_level] / m_framesPerSecond;
+	m_tick = 0;
+	m_resumed = false;
+	m_leaderboardTicket = 0;
+	m_leaderboardResult = Leaderboard::Result();
+	publishEvent(GameEvent::Type::NewGame, 0, m_numPlayers);
+	m_blockGenerator->reseed(seed); //Every game gets its own seed so it can be replayed on its own
+	m_replay.reset(m_blockGenerator->getSeed(), m_numPlayers, m_gameWidth, m_gameHeight, m_board->getBoardHeight(), m_gravity);
 	for (u8 i = 0; i < m_numPlayers; ++i)
 	{
-		m_playerStates[i]->piece.reset();
+		m_playerStates[i]->setPiece(nullptr);
+		m_playerStates[i]->setHeldPiece(nullptr);
+		m_playerStates[i]->setNextPiece(&m_blockGenerator->getBlock());
 		newPiece(i);
-		m_playerTimes[i] = sf::milliseconds(m_timeToNextDrop * 1000);
+		m_botTurns[i] = true;
+		if (m_bots[i] != nullptr) m_bots[i]->startGame(m_numPlayers, m_gameWidth, m_gameHeight, *m_blockGenerator);
 	}
+	m_pendingMoves.clear();
 	m_board->resetBoard();
-	m_musicController->startMusic();
+	if (m_musicController != nullptr) m_musicController->startMusic();
 	updateLevel();
-	loop();
+	publishSnapshot();
+
+	m_session = SessionState::Playing;
+	m_accumulator = sf::Time::Zero;
+	m_clock.restart();
 }
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <array>
+
+#include "../Headers/Gravity.hpp"
+
+/// <summary>
+/// The standard speed curve with the default lock delay
+/// </summary>
+Gravity::Gravity() : Gravity(standardCurve(), defaultLockDelay, defaultMaxLockResets) {}
+
+/// <summary>
+/// Custom gravity settings
+/// </summary>
+/// <param name="curve">The gravity of every level, in 1/65536ths of a cell per tick. The last entry is used for every level after it</param>
+/// <param name="lockDelay">How many ticks a piece can rest on something before it locks</param>
+/// <param name="maxLockResets">How many times moving or rotating a resting piece can restart its lock delay</param>
+Gravity::Gravity(const std::vector<u32>& curve, const u16 lockDelay, const u8 maxLockResets) :
+	m_curve(curve.empty() ? classicCurve() : curve), m_lockDelay(lockDelay), m_maxLockResets(maxLockResets)
+{
+	for (u32& cellsPerTick : m_curve)
+	{
+		cellsPerTick = std::min(cellsPerTick, twentyG);
+	}
+}
+
+/// <summary>
+/// The original 30 level curve, from the frames per drop on the tetris wiki. Level 29 and beyond fall at 1G.
+/// </summary>
+/// <returns></returns>
+std::vector<u32> Gravity::classicCurve()
+{
+	constexpr std::array<u8, 30> framesPerDrop = {
+		48, 43, 38, 33, 28, 23, 18, 13, 8, 6,
+		5, 5, 5, 4, 4, 4, 3, 3, 3, 2, 2, 2, 2,
+		2, 2, 2, 2, 2, 2, 1
+	};
+	std::vector<u32> curve;
+	for (const u8 frames : framesPerDrop)
+	{
+		curve.push_back(oneCell / frames);
+	}
+	return curve;
+}
+
+/// <summary>
+/// The classic curve, then ten more levels that speed up from 1G to 20G. Every level after that stays at 20G.
+/// </summary>
+/// <returns></returns>
+std::vector<u32> Gravity::standardCurve()
+{
+	//1G * 20^(n/10) for n = 1 to 10, written out so the curve never depends on the platform's pow
+	constexpr std::array<u32, 10> ramp = { 88427, 119312, 160986, 217216, 293086, 395456, 533582, 719953, 971420, twentyG };
+	std::vector<u32> curve = classicCurve();
+	curve.insert(curve.end(), ramp.begin(), ramp.end());
+	return curve;
+}
+
+/// <summary>
+/// How far a piece falls every tick on the given level
+/// </summary>
+/// <param name="level">The level, 0 indexed</param>
+/// <returns>The gravity, in 1/65536ths of a cell per tick</returns>
+const u32 Gravity::getCellsPerTick(const u32 level) const
+{
+	return m_curve[std::min<size_t>(level, m_curve.size() - 1)];
+}
+
+const std::vector<u32>& Gravity::getCurve() const
+{
+	return m_curve;
+}
+
+const u16 Gravity::getLockDelay() const
+{
+	return m_lockDelay;
+}
+
+const u8 Gravity::getMaxLockResets() const
+{
+	return m_maxLockResets;
+}
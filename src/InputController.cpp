@@ -116,15 +116,22 @@ PlayerMove InputController::input(const bool quit)
 	PlayerMove pm;
 	pm.move = Move::None;
 
-	while (m_window->pollEvent(m_event))
+	while (pollEvent())
 	{
 		switch (m_event.type)
 		{
-		case sf::Event::Closed:
-			m_window->close();
+		case sf::Event::Closed: //The window is closed by the game once it has stopped rendering to it
+			pm.move = Move::Quit;
+			pm.player = 0;
 			return pm;
 
 		case sf::Event::EventType::KeyPressed:
+			if (m_event.key.code == sf::Keyboard::F9) //Writes the trace when tracing is on, at any point in the game
+			{
+				pm.move = Move::SaveTrace;
+				pm.player = 0;
+				return pm;
+			}
 			if (quit)
 			{
 				if (m_event.key.code == sf::Keyboard::F5)
@@ -133,6 +140,12 @@ PlayerMove InputController::input(const bool quit)
 					pm.player = 0;
 					return pm;
 				}
+				if (m_event.key.code == sf::Keyboard::Escape)
+				{
+					pm.move = Move::ReturnToMenu;
+					pm.player = 0;
+					return pm;
+				}
 			}
 
 			for (auto x : m_playerKeyboardControls)
@@ -159,6 +172,12 @@ PlayerMove InputController::input(const bool quit)
 					case Move::HoldPiece:
 						pm.move = Move::HoldPiece;
 						break;
+					case Move::RotateCounterClockwise:
+						pm.move = Move::RotateCounterClockwise;
+						break;
+					case Move::Rotate180:
+						pm.move = Move::Rotate180;
+						break;
 					}
 					pm.player = x.playerIndex;
 					break;
@@ -191,6 +210,12 @@ PlayerMove InputController::input(const bool quit)
 					case Move::HoldPiece:
 						pm.move = Move::HoldPiece;
 						break;
+					case Move::RotateCounterClockwise:
+						pm.move = Move::RotateCounterClockwise;
+						break;
+					case Move::Rotate180:
+						pm.move = Move::Rotate180;
+						break;
 					}
 					pm.player = x.playerIndex;
 					break;
@@ -237,4 +262,33 @@ PlayerMove InputController::input(const bool quit)
 
 	}
 	return pm;
+}
+
+/// <summary>
+/// Sets the extra windows the game is shown in, e.g. a window per player. Their input is handled like the main window's,
+/// so players can play from whichever window has focus. Pass an empty list once the windows are closed.
+/// </summary>
+/// <param name="windows">The windows, which must stay open until they are replaced</param>
+void InputController::setDisplayWindows(const std::vector<sf::Window*>& windows)
+{
+	m_displayWindows = windows;
+}
+
+/// <summary>
+/// Takes the next event from the main window, or once it has none, from the display windows.
+/// A display window's close button is ignored: the windows are opened for the whole game and closed with it.
+/// </summary>
+/// <returns>Whether there was an event</returns>
+bool InputController::pollEvent()
+{
+	if (m_window->pollEvent(m_event)) return true;
+
+	for (sf::Window* const window : m_displayWindows)
+	{
+		while (window->pollEvent(m_event))
+		{
+			if (m_event.type != sf::Event::Closed) return true;
+		}
+	}
+	return false;
 }
\ No newline at end of file
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+
+#include "../Headers/Leaderboard.hpp"
+
+static constexpr u32 recordMagic = 0x52424C54; //"TLBR"
+static constexpr u32 indexMagic = 0x58444954; //"TIDX"
+static constexpr u16 indexVersion = 1;
+static_assert(sizeof(Leaderboard::Record) == 80, "The leaderboard log layout must not contain padding");
+
+/// <summary>
+/// Opens the leaderboard stored in the given directory and starts the background thread, which first recovers the index from the log
+/// </summary>
+/// <param name="directory">The folder containing leaderboard.log and leaderboard.idx</param>
+Leaderboard::Leaderboard(const std::filesystem::path& directory) :
+	m_logPath(directory / "leaderboard.log"), m_indexPath(directory / "leaderboard.idx")
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	m_worker = std::thread(&Leaderboard::worker, this);
+}
+
+/// <summary>
+/// Finishes writing every submitted game before shutting down
+/// </summary>
+Leaderboard::~Leaderboard()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_one();
+	m_worker.join();
+}
+
+/// <summary>
+/// Queues a finished game to be recorded and ranked. Never waits on the disk.
+/// </summary>
+/// <returns>A ticket to collect the game's rank with once it has been processed</returns>
+u64 Leaderboard::submit(const u8 numPlayers, const u8 gameWidth, const u32 lines, const u8 level, const u32 durationTicks, const std::string& replay)
+{
+	Record record{};
+	record.magic = recordMagic;
+	record.numPlayers = numPlayers;
+	record.gameWidth = gameWidth;
+	record.lines = lines;
+	record.level = level;
+	record.durationTicks = durationTicks;
+	record.finishedAt = static_cast<s64>(std::time(nullptr));
+	std::strncpy(record.replay, replay.c_str(), sizeof(record.replay) - 1);
+
+	u64 ticket;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		ticket = m_nextTicket++;
+		m_pending.emplace_back(ticket, record);
+	}
+	m_wake.notify_one();
+	return ticket;
+}
+
+/// <summary>
+/// Gets the rank of a submitted game, if the background thread has got to it yet
+/// </summary>
+/// <param name="ticket">The ticket returned by submit()</param>
+/// <param name="result">Where the rank is written to</param>
+/// <returns>Returns false while the game is still waiting to be ranked</returns>
+bool Leaderboard::getResult(const u64 ticket, Result& result)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_finishedTicket != ticket) return false;
+
+	result = m_lastResult;
+	return true;
+}
+
+/// <summary>
+/// Returns the best games played with the given number of players, best first
+/// </summary>
+/// <param name="numPlayers">The number of players</param>
+/// <param name="count">How many games to return at most</param>
+/// <returns></returns>
+std::vector<Leaderboard::Record> Leaderboard::getTopGames(const u8 numPlayers, const u32 count)
+{
+	std::vector<u32> recordIndices;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto first = std::lower_bound(m_index.begin(), m_index.end(), IndexEntry{ numPlayers, {}, UINT32_MAX, 0, 0 }, isBetter);
+		for (; first != m_index.end() && first->numPlayers == numPlayers && recordIndices.size() < count; ++first)
+		{
+			recordIndices.push_back(first->recordIndex);
+		}
+	}
+
+	std::vector<Record> records;
+	for (const u32 recordIndex : recordIndices)
+	{
+		Record record;
+		if (readRecord(recordIndex, record)) records.push_back(record);
+	}
+	return records;
+}
+
+/// <summary>
+/// Returns the rank (starting at 1) a game with the given score would have among all recorded games with the same number of players
+/// </summary>
+/// <returns></returns>
+u32 Leaderboard::getRank(const u8 numPlayers, const u32 lines, const u32 durationTicks)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	const IndexEntry key{ numPlayers, {}, lines, durationTicks, 0 };
+	auto groupStart = std::lower_bound(m_index.begin(), m_index.end(), IndexEntry{ numPlayers, {}, UINT32_MAX, 0, 0 }, isBetter);
+	auto position = std::lower_bound(groupStart, m_index.end(), key, isBetter);
+	return static_cast<u32>(position - groupStart) + 1;
+}
+
+/// <summary>
+/// The background thread. Recovers the index, then writes and ranks submitted games as they come in.
+/// </summary>
+void Leaderboard::worker()
+{
+	recover();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_wake.wait(lock, [this]() { return m_stopping || !m_pending.empty(); });
+		if (m_pending.empty()) break; //Stopping, and everything has been written
+
+		std::pair<u64, Record> pending = m_pending.front();
+		m_pending.pop_front();
+		lock.unlock();
+
+		appendRecord(pending.second);
+		const IndexEntry entry = toIndexEntry(pending.second, m_recordCount - 1);
+
+		lock.lock();
+		insertEntry(entry);
+		auto groupStart = std::lower_bound(m_index.begin(), m_index.end(), IndexEntry{ entry.numPlayers, {}, UINT32_MAX, 0, 0 }, isBetter);
+		auto groupEnd = std::lower_bound(groupStart, m_index.end(), IndexEntry{ static_cast<u8>(entry.numPlayers + 1), {}, UINT32_MAX, 0, 0 }, isBetter);
+		m_lastResult.rank = static_cast<u32>(std::lower_bound(groupStart, groupEnd, entry, isBetter) - groupStart) + 1;
+		m_lastResult.rankedGames = static_cast<u32>(groupEnd - groupStart);
+		m_lastResult.bestLines = groupStart->lines;
+		m_finishedTicket = pending.first;
+
+		if (m_pending.empty())
+		{
+			lock.unlock();
+			saveIndex(); //Only once the queue is drained, so a burst of games writes the index once
+			lock.lock();
+		}
+	}
+}
+
+/// <summary>
+/// Brings the index back in line with the log. A half-written record at the end of the log is cut off,
+/// records the index doesn't cover yet are added to it, and a damaged index is rebuilt from scratch.
+/// </summary>
+void Leaderboard::recover()
+{
+	std::vector<Record> records;
+	{
+		std::ifstream log(m_logPath, std::ios::binary);
+		Record record;
+		while (log.read(reinterpret_cast<char*>(&record), sizeof(record)))
+		{
+			if (record.magic != recordMagic || record.checksum != checksum(reinterpret_cast<const u8*>(&record), offsetof(Record, checksum))) break;
+			records.push_back(record);
+		}
+	}
+	std::error_code error;
+	const u64 validSize = records.size() * sizeof(Record);
+	if (std::filesystem::exists(m_logPath, error) && std::filesystem::file_size(m_logPath, error) != validSize)
+	{
+		std::cerr << "Leaderboard log has a damaged tail, keeping the first " << records.size() << " games" << std::endl;
+		std::filesystem::resize_file(m_logPath, validSize, error);
+	}
+
+	std::vector<IndexEntry> index;
+	IndexHeader header{};
+	std::ifstream indexFile(m_indexPath, std::ios::binary);
+	if (indexFile.read(reinterpret_cast<char*>(&header), sizeof(header)) && header.magic == indexMagic && header.version == indexVersion
+		&& header.recordCount <= records.size())
+	{
+		index.resize(header.recordCount);
+		indexFile.read(reinterpret_cast<char*>(index.data()), index.size() * sizeof(IndexEntry));
+		if (!indexFile || header.checksum != checksum(reinterpret_cast<const u8*>(index.data()), index.size() * sizeof(IndexEntry)))
+		{
+			index.clear();
+			header.recordCount = 0;
+		}
+	}
+	else
+	{
+		header.recordCount = 0;
+	}
+
+	const bool indexChanged = header.recordCount != records.size();
+	for (u32 recordIndex = header.recordCount; recordIndex < records.size(); ++recordIndex)
+	{
+		index.push_back(toIndexEntry(records[recordIndex], recordIndex));
+	}
+	std::sort(index.begin(), index.end(), isBetter);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_recordCount = static_cast<u32>(records.size());
+		m_index.swap(index);
+	}
+	if (indexChanged) saveIndex();
+
+	m_log.open(m_logPath, std::ios::binary | std::ios::app);
+}
+
+/// <summary>
+/// Appends a game to the end of the log
+/// </summary>
+void Leaderboard::appendRecord(Record& record)
+{
+	record.checksum = checksum(reinterpret_cast<const u8*>(&record), offsetof(Record, checksum));
+
+	m_log.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	m_log.flush();
+	if (!m_log.good())
+	{
+		std::cerr << "Error writing to the leaderboard log" << std::endl;
+	}
+	++m_recordCount;
+}
+
+/// <summary>
+/// Inserts an entry into the in-memory index, keeping it sorted. Must be called with the mutex held.
+/// </summary>
+void Leaderboard::insertEntry(const IndexEntry& entry)
+{
+	m_index.insert(std::upper_bound(m_index.begin(), m_index.end(), entry, isBetter), entry);
+}
+
+/// <summary>
+/// Writes the index to a temporary file and renames it over the old one, so a crash never leaves a half-written index behind
+/// </summary>
+void Leaderboard::saveIndex()
+{
+	std::vector<IndexEntry> index;
+	IndexHeader header{ indexMagic, indexVersion, 0, 0, 0 };
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		index = m_index;
+	}
+	header.recordCount = static_cast<u32>(index.size());
+	header.checksum = checksum(reinterpret_cast<const u8*>(index.data()), index.size() * sizeof(IndexEntry));
+
+	std::filesystem::path tempPath = m_indexPath;
+	tempPath += ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(IndexEntry));
+		if (!file.good())
+		{
+			std::cerr << "Error writing the leaderboard index" << std::endl;
+			return;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tempPath, m_indexPath, error);
+}
+
+/// <summary>
+/// Reads a single game from the log
+/// </summary>
+bool Leaderboard::readRecord(const u32 recordIndex, Record& record)
+{
+	std::ifstream log(m_logPath, std::ios::binary);
+	log.seekg(static_cast<std::streamoff>(recordIndex) * sizeof(Record));
+	return static_cast<bool>(log.read(reinterpret_cast<char*>(&record), sizeof(record)));
+}
+
+/// <summary>
+/// The index order: grouped by player count, then most lines first, then shortest game first, then oldest game first
+/// </summary>
+bool Leaderboard::isBetter(const IndexEntry& a, const IndexEntry& b)
+{
+	if (a.numPlayers != b.numPlayers) return a.numPlayers < b.numPlayers;
+	if (a.lines != b.lines) return a.lines > b.lines;
+	if (a.durationTicks != b.durationTicks) return a.durationTicks < b.durationTicks;
+	return a.recordIndex < b.recordIndex;
+}
+
+/// <summary>
+/// FNV-1a, used to spot torn or damaged records and index files
+/// </summary>
+u32 Leaderboard::checksum(const u8* data, const size_t size)
+{
+	u32 hash = 2166136261u;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+Leaderboard::IndexEntry Leaderboard::toIndexEntry(const Record& record, const u32 recordIndex)
+{
+	return IndexEntry{ record.numPlayers, {}, record.lines, record.durationTicks, recordIndex };
+}
@@ -0,0 +1,552 @@
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+#include "../Headers/LockstepSimulator.hpp"
+
+#if !defined(TETRIS_NO_SIMD) && defined(__AVX2__)
+#define LOCKSTEP_AVX2
+#include <immintrin.h>
+#elif !defined(TETRIS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define LOCKSTEP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	using LaneValues = LockstepSimulator::LaneValues;
+
+	//The register operations the kernels are written with: one 32 bit value per lane, as many lanes per register as the instruction set has
+#if defined(LOCKSTEP_AVX2)
+	using Register = __m256i;
+	inline Register loadRegister(const u32* const values) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values)); }
+	inline void storeRegister(u32* const values, const Register r) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(values), r); }
+	inline Register splatRegister(const u32 value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+	inline Register andRegisters(const Register a, const Register b) { return _mm256_and_si256(a, b); }
+	inline Register orRegisters(const Register a, const Register b) { return _mm256_or_si256(a, b); }
+	inline Register xorRegisters(const Register a, const Register b) { return _mm256_xor_si256(a, b); }
+	inline Register andNotRegisters(const Register a, const Register b) { return _mm256_andnot_si256(a, b); }
+	inline Register addRegisters(const Register a, const Register b) { return _mm256_add_epi32(a, b); }
+	inline Register subtractRegisters(const Register a, const Register b) { return _mm256_sub_epi32(a, b); }
+	inline Register equalRegisters(const Register a, const Register b) { return _mm256_cmpeq_epi32(a, b); }
+	template <int Bits> inline Register shiftRightRegister(const Register r) { return _mm256_srli_epi32(r, Bits); }
+	inline bool isRegisterAllSet(const Register r) { return _mm256_movemask_epi8(r) == -1; }
+#elif defined(LOCKSTEP_SSE2)
+	using Register = __m128i;
+	inline Register loadRegister(const u32* const values) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(values)); }
+	inline void storeRegister(u32* const values, const Register r) { _mm_storeu_si128(reinterpret_cast<__m128i*>(values), r); }
+	inline Register splatRegister(const u32 value) { return _mm_set1_epi32(static_cast<int>(value)); }
+	inline Register andRegisters(const Register a, const Register b) { return _mm_and_si128(a, b); }
+	inline Register orRegisters(const Register a, const Register b) { return _mm_or_si128(a, b); }
+	inline Register xorRegisters(const Register a, const Register b) { return _mm_xor_si128(a, b); }
+	inline Register andNotRegisters(const Register a, const Register b) { return _mm_andnot_si128(a, b); }
+	inline Register addRegisters(const Register a, const Register b) { return _mm_add_epi32(a, b); }
+	inline Register subtractRegisters(const Register a, const Register b) { return _mm_sub_epi32(a, b); }
+	inline Register equalRegisters(const Register a, const Register b) { return _mm_cmpeq_epi32(a, b); }
+	template <int Bits> inline Register shiftRightRegister(const Register r) { return _mm_srli_epi32(r, Bits); }
+	inline bool isRegisterAllSet(const Register r) { return _mm_movemask_epi8(r) == 0xFFFF; }
+#else
+	using Register = u32;
+	inline Register loadRegister(const u32* const values) { return *values; }
+	inline void storeRegister(u32* const values, const Register r) { *values = r; }
+	inline Register splatRegister(const u32 value) { return value; }
+	inline Register andRegisters(const Register a, const Register b) { return a & b; }
+	inline Register orRegisters(const Register a, const Register b) { return a | b; }
+	inline Register xorRegisters(const Register a, const Register b) { return a ^ b; }
+	inline Register andNotRegisters(const Register a, const Register b) { return ~a & b; }
+	inline Register addRegisters(const Register a, const Register b) { return a + b; }
+	inline Register subtractRegisters(const Register a, const Register b) { return a - b; }
+	inline Register equalRegisters(const Register a, const Register b) { return a == b ? ~u32(0) : 0; }
+	template <int Bits> inline Register shiftRightRegister(const Register r) { return r >> Bits; }
+	inline bool isRegisterAllSet(const Register r) { return r == ~u32(0); }
+#endif
+
+	/// <summary>
+	/// A value for every lane, in as many registers as it takes
+	/// </summary>
+	struct Vector
+	{
+		static constexpr u8 registers = sizeof(LaneValues) / sizeof(Register);
+		static constexpr u8 lanesPerRegister = sizeof(Register) / sizeof(u32);
+		Register r[registers];
+	};
+	using RegisterIndices = std::make_index_sequence<Vector::registers>;
+
+	/// <summary>
+	/// Applies an operation to every register. The registers are expanded at compile time rather than looped over,
+	/// so a vector stays in registers whatever the optimization level.
+	/// </summary>
+	template <typename Operation, size_t... Index>
+	inline Vector forEachRegister(const Operation operation, std::index_sequence<Index...>)
+	{
+		return Vector{ { operation(Index)... } };
+	}
+
+	inline Vector load(const LaneValues& values)
+	{
+		return forEachRegister([&](const size_t i) { return loadRegister(&values[i * Vector::lanesPerRegister]); }, RegisterIndices());
+	}
+
+	inline void store(LaneValues& values, const Vector& v)
+	{
+		[&]<size_t... Index>(std::index_sequence<Index...>) { (storeRegister(&values[Index * Vector::lanesPerRegister], v.r[Index]), ...); }(RegisterIndices());
+	}
+
+	inline Vector splat(const u32 value)
+	{
+		const Register r = splatRegister(value);
+		return forEachRegister([&](const size_t) { return r; }, RegisterIndices());
+	}
+
+	inline Vector operator&(const Vector& a, const Vector& b)
+	{
+		return forEachRegister([&](const size_t i) { return andRegisters(a.r[i], b.r[i]); }, RegisterIndices());
+	}
+
+	inline Vector operator|(const Vector& a, const Vector& b)
+	{
+		return forEachRegister([&](const size_t i) { return orRegisters(a.r[i], b.r[i]); }, RegisterIndices());
+	}
+
+	inline Vector operator^(const Vector& a, const Vector& b)
+	{
+		return forEachRegister([&](const size_t i) { return xorRegisters(a.r[i], b.r[i]); }, RegisterIndices());
+	}
+
+	inline Vector operator+(const Vector& a, const Vector& b)
+	{
+		return forEachRegister([&](const size_t i) { return addRegisters(a.r[i], b.r[i]); }, RegisterIndices());
+	}
+
+	inline Vector operator-(const Vector& a, const Vector& b)
+	{
+		return forEachRegister([&](const size_t i) { return subtractRegisters(a.r[i], b.r[i]); }, RegisterIndices());
+	}
+
+	/// <summary>
+	/// ~a & b
+	/// </summary>
+	inline Vector andNot(const Vector& a, const Vector& b)
+	{
+		return forEachRegister([&](const size_t i) { return andNotRegisters(a.r[i], b.r[i]); }, RegisterIndices());
+	}
+
+	/// <summary>
+	/// Every bit set in the lanes where a and b are equal
+	/// </summary>
+	inline Vector equal(const Vector& a, const Vector& b)
+	{
+		return forEachRegister([&](const size_t i) { return equalRegisters(a.r[i], b.r[i]); }, RegisterIndices());
+	}
+
+	template <int Bits>
+	inline Vector shiftRight(const Vector& v)
+	{
+		return forEachRegister([&](const size_t i) { return shiftRightRegister<Bits>(v.r[i]); }, RegisterIndices());
+	}
+
+	inline bool isAllSet(const Vector& v)
+	{
+		for (const Register& r : v.r)
+		{
+			if (!isRegisterAllSet(r)) return false;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Counts the set bits of every lane. Neither instruction set has a 32 bit population count, so the bits are added up in pairs,
+	/// then nibbles, then bytes.
+	/// </summary>
+	inline Vector popCount(Vector v)
+	{
+		v = v - (shiftRight<1>(v) & splat(0x55555555));
+		v = (v & splat(0x33333333)) + (shiftRight<2>(v) & splat(0x33333333));
+		v = (v + shiftRight<4>(v)) & splat(0x0F0F0F0F);
+		v = v + shiftRight<8>(v);
+		v = v + shiftRight<16>(v);
+		return v & splat(0x3F);
+	}
+
+	/// <summary>
+	/// Every bit set in the lanes where the piece rows overlap the board rows from row y down
+	/// </summary>
+	inline Vector collides(const std::array<Vector, 4>& piece, const LockstepSimulator::Boards& boards, const u8 y)
+	{
+		const Vector overlap = (piece[0] & load(boards.rows[y])) | (piece[1] & load(boards.rows[y + 1]))
+			| (piece[2] & load(boards.rows[y + 2])) | (piece[3] & load(boards.rows[y + 3]));
+		return andNot(equal(overlap, splat(0)), splat(~u32(0)));
+	}
+
+	u32 toLaneBits(const Vector& mask)
+	{
+		LaneValues values;
+		store(values, mask);
+		u32 bits = 0;
+		for (u8 lane = 0; lane < LockstepSimulator::lanes; ++lane)
+		{
+			if (values[lane] != 0) bits |= u32(1) << lane;
+		}
+		return bits;
+	}
+}
+
+/// <summary>
+/// Works out every rotated piece's row masks at every column. Every lane starts out stopped until it is given a seed.
+/// </summary>
+/// <param name="pieceState">Used to read the rotated piece data</param>
+/// <param name="blocks">The blocks the game can generate</param>
+/// <param name="width">The width of the boards, up to maxWidth</param>
+/// <param name="height">The height of the boards, up to maxHeight</param>
+LockstepSimulator::LockstepSimulator(PieceState* const pieceState, const Blocks* const blocks, const u8 width, const u8 height)
+	: m_width(std::clamp<u8>(width, 4, maxWidth)), m_height(std::clamp<u8>(height, 4, maxHeight)),
+	m_wallMask(~(((u32(1) << m_width) - 1) << rowMaskMargin)), m_pieces(blocks->getBlockTypeCount())
+{
+	const RotationSystem rotationSystem(pieceState, blocks);
+	for (u8 type = 0; type < m_pieces.size(); ++type)
+	{
+		for (u8 rotation = 0; rotation < 4; ++rotation)
+		{
+			const RotationSystem::PieceMask& mask = rotationSystem.getMask(type, rotation);
+			for (u8 column = 0; column < columns; ++column)
+			{
+				//Column index c is x = c + minColumn, whose cells are bit x + rowMaskMargin = c of a row mask
+				for (u8 row = 0; row < mask.size(); ++row)
+				{
+					m_pieces[type][rotation][column][row] = u32(mask[row]) << column;
+				}
+			}
+		}
+	}
+
+	for (u8 y = 0; y < m_boards.rows.size(); ++y)
+	{
+		m_boards.rows[y].fill(y < m_height ? m_wallMask : ~u32(0));
+	}
+}
+
+/// <summary>
+/// Starts a new game in the first lanes, one for each seed. The rest of the lanes are stopped.
+/// </summary>
+/// <param name="seeds">The block generator seed of each lane's game</param>
+void LockstepSimulator::reset(std::span<const u32> seeds)
+{
+	for (u8 lane = 0; lane < lanes; ++lane)
+	{
+		if (lane < seeds.size()) resetLane(lane, seeds[lane]);
+		else stopLane(lane);
+	}
+}
+
+/// <summary>
+/// Starts a new game in one lane, which draws its first two pieces as the game does
+/// </summary>
+/// <param name="lane">The lane</param>
+/// <param name="seed">The block generator seed of the game</param>
+void LockstepSimulator::resetLane(const u8 lane, const u32 seed)
+{
+	for (u8 y = 0; y < m_height; ++y)
+	{
+		m_boards.rows[y][lane] = m_wallMask;
+	}
+	m_blocks[lane].reseed(seed);
+
+	Lane& state = m_lanes[lane];
+	state = Lane();
+	state.seed = seed;
+	state.playing = true;
+	state.piece = m_blocks[lane].getBlock().type;
+	state.nextPiece = m_blocks[lane].getBlock().type;
+}
+
+/// <summary>
+/// Stops a lane's game. Stopped lanes are skipped by every step until they are reset.
+/// </summary>
+/// <param name="lane">The lane</param>
+void LockstepSimulator::stopLane(const u8 lane)
+{
+	m_lanes[lane].playing = false;
+}
+
+/// <summary>
+/// Places a piece in every lane that is playing: holds if asked, drops the piece, clears the full rows and draws the next piece.
+/// Lanes that lose or play a placement that doesn't fit stop playing.
+/// </summary>
+/// <param name="actions">The placement for each lane. The actions of lanes that aren't playing are ignored</param>
+void LockstepSimulator::step(const Actions& actions)
+{
+	PieceRows pieceRows;
+	const u32 playing = getPieceRows(actions, pieceRows);
+	LaneValues fullRows;
+	const u32 placed = placePieces(m_boards, m_boards, pieceRows, fullRows);
+
+	for (u8 lane = 0; lane < lanes; ++lane)
+	{
+		if ((playing >> lane & 1) == 0) continue;
+
+		Lane& state = m_lanes[lane];
+		if ((placed >> lane & 1) == 0)
+		{
+			state.playing = false;
+			continue;
+		}
+
+		if (actions[lane].hold)
+		{
+			if (state.heldPiece == noPiece)
+			{
+				state.heldPiece = state.piece;
+				state.piece = state.nextPiece;
+				state.nextPiece = m_blocks[lane].getBlock().type;
+			}
+			else
+			{
+				std::swap(state.heldPiece, state.piece);
+			}
+		}
+
+		if (fullRows[lane] != 0)
+		{
+			clearRows(m_boards, lane, fullRows[lane]);
+			state.lines += std::popcount(fullRows[lane]);
+			state.level = static_cast<u8>(std::min<u32>(state.lines / linesToNextLevel, maxLevel));
+		}
+		++state.pieces;
+		state.playing = m_boards.rows[0][lane] == m_wallMask;
+		state.piece = state.nextPiece;
+		state.nextPiece = m_blocks[lane].getBlock().type;
+	}
+}
+
+/// <summary>
+/// Works out the boards every lane would have after a placement, including clearing any full rows, without playing it.
+/// Bots call this for each placement they consider and score the results.
+/// </summary>
+/// <param name="actions">The placement to try in each lane</param>
+/// <param name="trial">Gets the boards and how many lines each placement would clear</param>
+void LockstepSimulator::tryPlacements(const Actions& actions, Trial& trial) const
+{
+	PieceRows pieceRows;
+	getPieceRows(actions, pieceRows);
+	LaneValues fullRows;
+	trial.placed = placePieces(m_boards, trial.boards, pieceRows, fullRows);
+
+	for (u8 lane = 0; lane < lanes; ++lane)
+	{
+		trial.linesCleared[lane] = std::popcount(fullRows[lane]);
+		if (fullRows[lane] != 0) clearRows(trial.boards, lane, fullRows[lane]);
+	}
+}
+
+/// <summary>
+/// Measures every lane's board for scoring. Walking down the rows, a cell is covered once any row above it has a block in its column,
+/// so the covered cells add up to the column heights, the empty covered cells are the holes, and the columns covered where their
+/// neighbour isn't add up to the height differences.
+/// </summary>
+/// <param name="boards">The boards, usually from a trial</param>
+/// <param name="features">Gets the measures of every lane's board</param>
+void LockstepSimulator::getFeatures(const Boards& boards, Features& features) const
+{
+	const Vector boardMask = splat(~m_wallMask);
+	const Vector neighbourMask = splat(~m_wallMask & (~m_wallMask >> 1)); //Columns that have a neighbour on their right
+	Vector covered = splat(0), height = splat(0), holes = splat(0), bumpiness = splat(0);
+	for (u8 y = getEmptyRows(boards); y < m_height; ++y)
+	{
+		const Vector row = load(boards.rows[y]) & boardMask;
+		covered = covered | row;
+		height = height + popCount(covered);
+		holes = holes + popCount(andNot(row, covered));
+		bumpiness = bumpiness + popCount((covered ^ shiftRight<1>(covered)) & neighbourMask);
+	}
+	store(features.aggregateHeight, height);
+	store(features.holes, holes);
+	store(features.bumpiness, bumpiness);
+}
+
+/// <summary>
+/// Which lanes are playing
+/// </summary>
+/// <returns>Bit l is set if lane l is playing</returns>
+const u32 LockstepSimulator::getPlayingLanes() const
+{
+	u32 playing = 0;
+	for (u8 lane = 0; lane < lanes; ++lane)
+	{
+		if (m_lanes[lane].playing) playing |= u32(1) << lane;
+	}
+	return playing;
+}
+
+const LockstepSimulator::Lane& LockstepSimulator::getLane(const u8 lane) const
+{
+	return m_lanes[lane];
+}
+
+const LockstepSimulator::Boards& LockstepSimulator::getBoards() const
+{
+	return m_boards;
+}
+
+/// <summary>
+/// Checks if a cell of a lane's board has a block in it
+/// </summary>
+/// <param name="lane">The lane</param>
+/// <param name="x">The column</param>
+/// <param name="y">The row, 0 is the top</param>
+/// <returns></returns>
+const bool LockstepSimulator::isFilled(const u8 lane, const u8 x, const u8 y) const
+{
+	return (m_boards.rows[y][lane] >> (x + rowMaskMargin) & 1) != 0;
+}
+
+const u8 LockstepSimulator::getWidth() const
+{
+	return m_width;
+}
+
+const u8 LockstepSimulator::getHeight() const
+{
+	return m_height;
+}
+
+/// <summary>
+/// The instruction set the simulator was built for
+/// </summary>
+/// <returns></returns>
+const char* LockstepSimulator::getInstructionSet()
+{
+#if defined(LOCKSTEP_AVX2)
+	return "AVX2";
+#elif defined(LOCKSTEP_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+/// <summary>
+/// The piece a lane would place: the current piece, or what holding it would bring out
+/// </summary>
+/// <param name="lane">The lane</param>
+/// <param name="hold">Whether the lane holds first</param>
+/// <returns></returns>
+const u8 LockstepSimulator::getPlacedPiece(const u8 lane, const bool hold) const
+{
+	const Lane& state = m_lanes[lane];
+	if (!hold) return state.piece;
+	return state.heldPiece != noPiece ? state.heldPiece : state.nextPiece;
+}
+
+/// <summary>
+/// Looks up the row masks of every playing lane's piece in its placement's rotation and column. Lanes that aren't playing get no piece.
+/// </summary>
+/// <param name="actions">The placement of each lane</param>
+/// <param name="pieceRows">Gets the piece's rows, pieceRows[row][lane]</param>
+/// <returns>The lanes that are playing, bit l for lane l</returns>
+const u32 LockstepSimulator::getPieceRows(const Actions& actions, PieceRows& pieceRows) const
+{
+	u32 playing = 0;
+	for (u8 lane = 0; lane < lanes; ++lane)
+	{
+		const Action& action = actions[lane];
+		if (!m_lanes[lane].playing)
+		{
+			for (LaneValues& row : pieceRows) row[lane] = 0;
+			continue;
+		}
+
+		playing |= u32(1) << lane;
+		const s16 column = action.x - minColumn;
+		if (column < 0 || column >= columns)
+		{
+			for (LaneValues& row : pieceRows) row[lane] = ~u32(0);
+			continue;
+		}
+		const ShiftedPiece& rows = m_pieces[getPlacedPiece(lane, action.hold)][action.rotation & 3][column];
+		for (u8 row = 0; row < rows.size(); ++row)
+		{
+			pieceRows[row][lane] = rows[row];
+		}
+	}
+	return playing;
+}
+
+/// <summary>
+/// Counts the rows at the top that are empty in every lane. Nothing the kernels do can change above them, so they skip them.
+/// </summary>
+/// <param name="boards">The boards</param>
+/// <returns></returns>
+u8 LockstepSimulator::getEmptyRows(const Boards& boards) const
+{
+	const Vector empty = splat(m_wallMask);
+	u8 y = 0;
+	while (y < m_height && isAllSet(equal(load(boards.rows[y]), empty))) ++y;
+	return y;
+}
+
+/// <summary>
+/// Hard drops a piece in every lane and adds it to the board, then finds the full rows. Lanes without a piece are left alone.
+/// The pieces start in the top row and move down together, one row per iteration, and each lane's landing row is kept
+/// when its piece first collides with the row below. The lock and the full row checks are then a pass over the rows.
+/// Only the rows from just above the highest block of any lane down are visited; a piece that fits in the top row falls freely until then.
+/// </summary>
+/// <param name="source">The boards to drop the pieces on</param>
+/// <param name="destination">Gets the boards with the pieces added. May be the source</param>
+/// <param name="pieceRows">Each lane's piece, from getPieceRows</param>
+/// <param name="fullRows">Gets the full rows of every lane, bit y for row y</param>
+/// <returns>The lanes whose piece fit in the top row and was placed</returns>
+u32 LockstepSimulator::placePieces(const Boards& source, Boards& destination, const PieceRows& pieceRows, LaneValues& fullRows) const
+{
+	std::array<Vector, 4> piece = { load(pieceRows[0]), load(pieceRows[1]), load(pieceRows[2]), load(pieceRows[3]) };
+	const Vector noPieces = equal(piece[0] | piece[1] | piece[2] | piece[3], splat(0));
+	const Vector blocked = collides(piece, source, 0);
+	const Vector placed = andNot(noPieces | blocked, splat(~u32(0)));
+	for (Vector& row : piece) row = row & placed;
+
+	const u8 emptyRows = getEmptyRows(source);
+	const u8 firstRow = emptyRows > piece.size() ? emptyRows - static_cast<u8>(piece.size()) : 0;
+	Vector landed = andNot(placed, splat(~u32(0))), landingRow = splat(0);
+	for (u8 y = firstRow; y < m_height && !isAllSet(landed); ++y)
+	{
+		const Vector lands = andNot(landed, collides(piece, source, y + 1));
+		landingRow = landingRow | (lands & splat(y));
+		landed = landed | lands;
+	}
+
+	if (&destination != &source)
+	{
+		for (u8 y = 0; y < firstRow; ++y) destination.rows[y].fill(m_wallMask);
+		for (u8 y = m_height; y < destination.rows.size(); ++y) destination.rows[y].fill(~u32(0));
+	}
+	Vector full = splat(0);
+	for (u8 y = firstRow; y < m_height; ++y)
+	{
+		Vector row = load(source.rows[y]);
+		for (u8 pieceRow = 0; pieceRow < piece.size() && pieceRow <= y; ++pieceRow)
+		{
+			row = row | (equal(landingRow, splat(y - pieceRow)) & piece[pieceRow]);
+		}
+		store(destination.rows[y], row);
+		full = full | (equal(row, splat(~u32(0))) & splat(u32(1) << y));
+	}
+	store(fullRows, full);
+	return toLaneBits(placed);
+}
+
+/// <summary>
+/// Clears the full rows of one lane's board and drops the rows above them, as Board::clearRows does. Line clears are rare
+/// next to drops, so this is done a lane at a time.
+/// </summary>
+/// <param name="boards">The boards</param>
+/// <param name="lane">The lane to clear the rows of</param>
+/// <param name="fullRows">Bit y is set if row y is full</param>
+void LockstepSimulator::clearRows(Boards& boards, const u8 lane, const u32 fullRows) const
+{
+	int to = std::bit_width(fullRows) - 1;
+	for (int from = to; from >= 0; --from)
+	{
+		if (fullRows >> from & 1) continue;
+		boards.rows[to--][lane] = boards.rows[from][lane];
+	}
+	for (; to >= 0; --to) boards.rows[to][lane] = m_wallMask;
+}
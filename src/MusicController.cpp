@@ -1,12 +1,14 @@
+#include <algorithm>
+
 #include "../Headers/MusicController.hpp"
 
 /// <summary>
-/// Initalizes the theme song file. If it can't be opened, don't allow the music to be played.
+/// Initalizes the theme song files. If the theme can't be opened, don't allow the music to be played.
 /// Also turns down the volume so it isn't too loud.
 /// </summary>
 MusicController::MusicController() : musicAvailable(true)
 {
-	if (!m_theme.openFromFile("./Tetris-Theme.ogg"))
+	if (!m_theme.openFromFiles("./Tetris-Theme.ogg", "./Tetris-Danger.ogg"))
 	{
 		musicAvailable = false;
 	}
@@ -17,22 +19,53 @@ MusicController::MusicController() : musicAvailable(true)
 }
 
 /// <summary>
-/// Starts the music and sets the loop.
+/// Starts the music from the beginning, at the tempo of the first level.
 /// </summary>
 void MusicController::startMusic()
 {
 	if (!musicAvailable) return;
 
+	m_danger = false;
+	m_theme.setTempo(1.0f);
+	m_theme.setDanger(false);
 	m_theme.play();
-	m_theme.setLoop(true);
 }
 
 /// <summary>
-/// Stops the music after losing.
+/// Stops the music straight away, e.g. when leaving a game. Losing fades the music out on its own, through the event bus.
 /// </summary>
 void MusicController::stopMusic()
 {
 	if (!musicAvailable) return;
 
 	m_theme.stop();
-}
\ No newline at end of file
+}
+
+/// <summary>
+/// Speeds the music up to match the level, and switches to the danger theme once the stack fills three quarters of the board.
+/// It only switches back once the stack is down to half the board, so clearing a line or two near the line doesn't flip it back and forth.
+/// Cheap enough to call every tick.
+/// </summary>
+/// <param name="level">The current level</param>
+/// <param name="stackHeight">How many rows from the bottom of the board the highest block is</param>
+/// <param name="boardHeight">How many rows the board has</param>
+void MusicController::update(const u8 level, const u8 stackHeight, const u8 boardHeight)
+{
+	if (!musicAvailable) return;
+
+	m_theme.setTempo(1.0f + tempoPerLevel * std::min(level, fastestLevel));
+	if (stackHeight * 4 >= boardHeight * 3) m_danger = true;
+	else if (stackHeight * 2 < boardHeight) m_danger = false;
+	m_theme.setDanger(m_danger);
+}
+
+/// <summary>
+/// Listens to the game's events on the audio thread. Nothing subscribes if there is no music to play, so no queue fills up unread.
+/// </summary>
+/// <param name="eventBus">The bus the games publish to</param>
+void MusicController::subscribe(EventBus& eventBus)
+{
+	if (!musicAvailable) return;
+
+	m_theme.setEventQueue(eventBus.subscribe());
+}
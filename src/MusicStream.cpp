@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "../Headers/MusicStream.hpp"
+#include "../Headers/AllocationTracker.hpp"
+#include "../Headers/Tracer.hpp"
+
+static_assert(std::atomic<float>::is_always_lock_free, "The music targets are shared with the audio thread without locks");
+
+/// <summary>
+/// SFML's audio thread calls onGetData until the stream is stopped, so it has to stop before this class's members go away
+/// </summary>
+MusicStream::~MusicStream()
+{
+	stop();
+}
+
+/// <summary>
+/// Decodes the stems and sets up the stream. Call it while the stream is stopped.
+/// </summary>
+/// <param name="themeFile">The main theme</param>
+/// <param name="dangerFile">The stem to crossfade into when the stack is high. Optional, without it the theme plays on its own.</param>
+/// <returns>Returns false if the theme couldn't be opened</returns>
+bool MusicStream::openFromFiles(const std::string& themeFile, const std::string& dangerFile)
+{
+	u32 sampleRate = 0;
+	if (!loadStem(themeFile, m_theme, m_channelCount, sampleRate)) return false;
+
+	u32 dangerChannels = 0, dangerRate = 0;
+	if (loadStem(dangerFile, m_danger, dangerChannels, dangerRate) && (dangerChannels != m_channelCount || dangerRate != sampleRate))
+	{
+		std::cerr << "Danger theme " << dangerFile << " doesn't match the format of the main theme, ignoring it" << std::endl;
+		m_danger.samples.clear();
+	}
+
+	m_stretch.initialize(m_channelCount);
+	m_mix.resize(static_cast<size_t>(TimeStretch::hopFrames) * m_channelCount);
+	m_stretched.resize(m_mix.size());
+	m_samples.resize(m_mix.size() * hopsPerChunk);
+	m_dangerStep = 1.0f / (crossfadeSeconds * sampleRate);
+	initialize(m_channelCount, sampleRate);
+	return true;
+}
+
+/// <summary>
+/// Sets how fast the music should play. The audio thread eases into it over the next few hops.
+/// </summary>
+/// <param name="tempo">1 is normal speed</param>
+void MusicStream::setTempo(const float tempo)
+{
+	m_targetTempo.store(std::clamp(tempo, TimeStretch::minTempo, TimeStretch::maxTempo), std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Crossfades into the danger stem, or back to the theme
+/// </summary>
+void MusicStream::setDanger(const bool danger)
+{
+	m_targetDanger.store(danger, std::memory_order_relaxed);
+}
+
+const bool MusicStream::hasDangerStem() const
+{
+	return !m_danger.samples.empty();
+}
+
+/// <summary>
+/// Sets the game events the audio thread listens to, so it can react to them without the game thread calling in
+/// </summary>
+/// <param name="events">The queue to drain, or null</param>
+void MusicStream::setEventQueue(EventBus::Queue* const events)
+{
+	m_events.store(events, std::memory_order_release);
+}
+
+/// <summary>
+/// Called on SFML's audio thread for the next chunk. The theme loops forever, so this keeps returning true until the game is over,
+/// when the chunk fades out and the stream stops after it.
+/// </summary>
+bool MusicStream::onGetData(Chunk& data)
+{
+	const AllocationTracker::Scope allocationScope(AllocationPhase::Audio);
+	Tracer::setThreadName("audio");
+	const Tracer::Scope traceScope("music");
+	readEvents();
+
+	const float targetTempo = m_targetTempo.load(std::memory_order_relaxed);
+	const size_t hopSamples = m_stretched.size();
+	for (u32 hop = 0; hop < hopsPerChunk; ++hop)
+	{
+		m_tempo = m_tempo < targetTempo ? std::min(m_tempo + tempoStep, targetTempo) : std::max(m_tempo - tempoStep, targetTempo);
+		while (!m_stretch.process(m_stretched.data(), m_tempo))
+		{
+			mixInput();
+		}
+
+		s16* const samples = m_samples.data() + hop * hopSamples;
+		for (size_t sample = 0; sample < hopSamples; ++sample)
+		{
+			samples[sample] = static_cast<s16>(std::clamp(std::lround(m_stretched[sample] * 32768.0f), -32768l, 32767l));
+		}
+	}
+
+	if (m_fadingOut)
+	{
+		const float step = 1.0f / m_samples.size();
+		for (size_t sample = 0; sample < m_samples.size(); ++sample)
+		{
+			m_samples[sample] = static_cast<s16>(m_samples[sample] * (1.0f - sample * step));
+		}
+	}
+
+	data.samples = m_samples.data();
+	data.sampleCount = m_samples.size();
+	return !m_fadingOut;
+}
+
+/// <summary>
+/// Called by SFML while the audio thread is stopped, including every time the music starts playing.
+/// Jumps straight to the targets instead of easing into them, so a new game starts at its own tempo.
+/// </summary>
+void MusicStream::onSeek(sf::Time timeOffset)
+{
+	const size_t frame = static_cast<size_t>(std::max<s64>(timeOffset.asMicroseconds(), 0) * getSampleRate() / 1000000);
+	if (!m_theme.samples.empty()) m_theme.position = frame * m_channelCount % m_theme.samples.size();
+	if (!m_danger.samples.empty()) m_danger.position = frame * m_channelCount % m_danger.samples.size();
+	m_stretch.reset();
+	m_tempo = m_targetTempo.load(std::memory_order_relaxed);
+	m_dangerMix = m_targetDanger.load(std::memory_order_relaxed) && hasDangerStem() ? 1.0f : 0.0f;
+
+	//Anything still queued is from before the music started, including a game over that stopped it
+	EventBus::Queue* const events = m_events.load(std::memory_order_acquire);
+	GameEvent event;
+	while (events != nullptr && events->pop(event)) {}
+	m_fadingOut = false;
+}
+
+/// <summary>
+/// Handles the game events that arrived since the last chunk
+/// </summary>
+void MusicStream::readEvents()
+{
+	EventBus::Queue* const events = m_events.load(std::memory_order_acquire);
+	if (events == nullptr) return;
+
+	GameEvent event;
+	while (events->pop(event))
+	{
+		if (event.type == GameEvent::Type::GameOver) m_fadingOut = true;
+	}
+}
+
+/// <summary>
+/// Decodes a whole file into memory
+/// </summary>
+/// <returns>Returns false if the file couldn't be opened or is empty</returns>
+bool MusicStream::loadStem(const std::string& file, Stem& stem, u32& channelCount, u32& sampleRate) const
+{
+	sf::InputSoundFile input;
+	if (!input.openFromFile(file) || input.getSampleCount() == 0) return false;
+
+	channelCount = input.getChannelCount();
+	sampleRate = input.getSampleRate();
+	stem.samples.resize(static_cast<size_t>(input.getSampleCount()));
+	stem.samples.resize(static_cast<size_t>(input.read(stem.samples.data(), stem.samples.size())));
+	stem.samples.resize(stem.samples.size() / channelCount * channelCount);
+	stem.position = 0;
+	return !stem.samples.empty();
+}
+
+/// <summary>
+/// Mixes the next hop of both stems and hands it to the time stretch. An equal power crossfade keeps the loudness steady while fading.
+/// </summary>
+void MusicStream::mixInput()
+{
+	constexpr float halfPi = 1.57079632679f;
+	constexpr float scale = 1.0f / 32768.0f;
+	const bool hasDanger = hasDangerStem();
+	const float target = m_targetDanger.load(std::memory_order_relaxed) && hasDanger ? 1.0f : 0.0f;
+
+	float* mix = m_mix.data();
+	for (u32 frame = 0; frame < TimeStretch::hopFrames; ++frame)
+	{
+		if (m_dangerMix != target) m_dangerMix = m_dangerMix < target ? std::min(m_dangerMix + m_dangerStep, target) : std::max(m_dangerMix - m_dangerStep, target);
+		const float themeGain = std::cos(m_dangerMix * halfPi) * scale;
+		const float dangerGain = std::sin(m_dangerMix * halfPi) * scale;
+
+		for (u32 channel = 0; channel < m_channelCount; ++channel)
+		{
+			float sample = m_theme.samples[m_theme.position + channel] * themeGain;
+			if (hasDanger) sample += m_danger.samples[m_danger.position + channel] * dangerGain;
+			*mix++ = sample;
+		}
+		m_theme.position += m_channelCount;
+		if (m_theme.position == m_theme.samples.size()) m_theme.position = 0;
+		if (hasDanger)
+		{
+			m_danger.position += m_channelCount;
+			if (m_danger.position == m_danger.samples.size()) m_danger.position = 0;
+		}
+	}
+	m_stretch.write(m_mix.data(), TimeStretch::hopFrames);
+}
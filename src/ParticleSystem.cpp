@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cmath>
+
+#include "../Headers/ParticleSystem.hpp"
+
+/// <summary>
+/// Allocates every field of the pool at its full capacity
+/// </summary>
+ParticleSystem::ParticleSystem()
+{
+	m_x.resize(capacity);
+	m_y.resize(capacity);
+	m_xSpeed.resize(capacity);
+	m_ySpeed.resize(capacity);
+	m_age.resize(capacity);
+	m_inverseLifetime.resize(capacity);
+	m_size.resize(capacity);
+	m_color.resize(capacity);
+	m_alpha.resize(capacity);
+}
+
+/// <summary>
+/// Removes every particle
+/// </summary>
+void ParticleSystem::clear()
+{
+	m_count = 0;
+}
+
+/// <summary>
+/// Moves every particle, fades it, and removes the ones that have died. Survivors are moved down to keep the pool packed,
+/// so every other loop only ever runs over live particles.
+/// </summary>
+/// <param name="deltaSeconds">How much time has passed since the last update</param>
+void ParticleSystem::update(const float deltaSeconds)
+{
+	const float dt = deltaSeconds;
+	const float damping = std::max(0.0f, 1.0f - drag * dt);
+	const float fall = gravity * dt;
+	float* const x = m_x.data();
+	float* const y = m_y.data();
+	float* const xSpeed = m_xSpeed.data();
+	float* const ySpeed = m_ySpeed.data();
+	float* const age = m_age.data();
+	const float* const inverseLifetime = m_inverseLifetime.data();
+	const u32 count = m_count;
+
+	for (u32 i = 0; i < count; ++i)
+	{
+		xSpeed[i] *= damping;
+		ySpeed[i] = ySpeed[i] * damping + fall;
+	}
+	for (u32 i = 0; i < count; ++i)
+	{
+		x[i] += xSpeed[i] * dt;
+		y[i] += ySpeed[i] * dt;
+		age[i] += dt;
+	}
+
+	u32 alive = 0;
+	for (u32 i = 0; i < count; ++i)
+	{
+		if (age[i] * inverseLifetime[i] >= 1.0f) continue;
+		if (alive != i)
+		{
+			m_x[alive] = m_x[i];
+			m_y[alive] = m_y[i];
+			m_xSpeed[alive] = m_xSpeed[i];
+			m_ySpeed[alive] = m_ySpeed[i];
+			m_age[alive] = m_age[i];
+			m_inverseLifetime[alive] = m_inverseLifetime[i];
+			m_size[alive] = m_size[i];
+			m_color[alive] = m_color[i];
+		}
+		++alive;
+	}
+	m_count = alive;
+
+	u8* const alpha = m_alpha.data();
+	for (u32 i = 0; i < alive; ++i)
+	{
+		alpha[i] = static_cast<u8>(static_cast<s32>(255.0f - 255.0f * (age[i] * inverseLifetime[i])));
+	}
+}
+
+/// <summary>
+/// Sparks bursting up out of a cleared row, in the color of the player who cleared it
+/// </summary>
+/// <param name="row">The board row that was cleared</param>
+/// <param name="boardWidth">How many columns the row has</param>
+/// <param name="color">The color of the player who cleared it</param>
+void ParticleSystem::emitLineClear(const u8 row, const u8 boardWidth, const sf::Color color)
+{
+	constexpr u8 particlesPerCell = 16;
+	for (u8 column = 0; column < boardWidth; ++column)
+	{
+		for (u8 i = 0; i < particlesPerCell; ++i)
+		{
+			emit(column + random(0.0f, 1.0f), row + random(0.0f, 1.0f), random(-6.0f, 6.0f), random(-10.0f, -2.0f), random(0.5f, 1.0f),
+				random(0.08f, 0.2f), i % 3 == 0 ? sf::Color::White : color);
+		}
+	}
+}
+
+/// <summary>
+/// A puff of dust kicked out sideways from under a hard dropped piece
+/// </summary>
+/// <param name="x">The leftmost column of the piece</param>
+/// <param name="y">The lowest row of the piece</param>
+/// <param name="width">How many columns the piece covers</param>
+/// <param name="color">The color of the player who dropped it</param>
+void ParticleSystem::emitHardDrop(const s8 x, const u8 y, const u8 width, const sf::Color color)
+{
+	constexpr u8 particlesPerColumn = 6;
+	for (u8 column = 0; column < width; ++column)
+	{
+		for (u8 i = 0; i < particlesPerColumn; ++i)
+		{
+			emit(x + column + random(0.0f, 1.0f), y + 1.0f, random(-4.0f, 4.0f), random(-5.0f, -1.0f), random(0.25f, 0.45f), random(0.06f, 0.12f), color);
+		}
+	}
+}
+
+/// <summary>
+/// A ring of confetti fired out from the middle of the board
+/// </summary>
+/// <param name="boardWidth">How many columns the board has</param>
+/// <param name="boardHeight">How many rows the board has</param>
+void ParticleSystem::emitLevelUp(const u8 boardWidth, const u8 boardHeight)
+{
+	constexpr u16 particleCount = 400;
+	constexpr float tau = 6.28318530718f;
+	const sf::Color colors[] = { sf::Color::White, sf::Color::Yellow, sf::Color::Cyan, sf::Color::Magenta };
+	const float centerX = boardWidth * 0.5f, centerY = boardHeight * 0.4f;
+	for (u16 i = 0; i < particleCount; ++i)
+	{
+		const float angle = random(0.0f, tau), speed = random(6.0f, 16.0f);
+		emit(centerX, centerY, std::cos(angle) * speed, std::sin(angle) * speed - 6.0f, random(1.0f, 1.6f), random(0.1f, 0.25f), colors[i % std::size(colors)]);
+	}
+}
+
+const u32 ParticleSystem::getCount() const
+{
+	return m_count;
+}
+
+const float* ParticleSystem::getX() const
+{
+	return m_x.data();
+}
+
+const float* ParticleSystem::getY() const
+{
+	return m_y.data();
+}
+
+/// <summary>
+/// The width and height of every particle, in board cells
+/// </summary>
+const float* ParticleSystem::getSizes() const
+{
+	return m_size.data();
+}
+
+const sf::Color* ParticleSystem::getColors() const
+{
+	return m_color.data();
+}
+
+/// <summary>
+/// How opaque every particle is. Use these instead of the alpha of the colors.
+/// </summary>
+const u8* ParticleSystem::getAlphas() const
+{
+	return m_alpha.data();
+}
+
+/// <summary>
+/// Adds a particle if the pool has room for it
+/// </summary>
+void ParticleSystem::emit(const float x, const float y, const float xSpeed, const float ySpeed, const float lifetime, const float size, const sf::Color color)
+{
+	if (m_count == capacity) return;
+
+	m_x[m_count] = x;
+	m_y[m_count] = y;
+	m_xSpeed[m_count] = xSpeed;
+	m_ySpeed[m_count] = ySpeed;
+	m_age[m_count] = 0.0f;
+	m_inverseLifetime[m_count] = 1.0f / lifetime;
+	m_size[m_count] = size;
+	m_color[m_count] = color;
+	m_alpha[m_count] = 255;
+	++m_count;
+}
+
+/// <summary>
+/// A random number between min and max from a xorshift generator. Effects only need to look random, and this never allocates or locks.
+/// </summary>
+float ParticleSystem::random(const float min, const float max)
+{
+	m_random ^= m_random << 13;
+	m_random ^= m_random >> 17;
+	m_random ^= m_random << 5;
+	return min + (max - min) * static_cast<float>(m_random >> 8) * (1.0f / 16777216.0f);
+}
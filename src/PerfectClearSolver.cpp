@@ -0,0 +1,480 @@
+#include <algorithm>
+#include <bit>
+
+#include "../Headers/PerfectClearSolver.hpp"
+#include "../Headers/Tracer.hpp"
+#include "../Headers/Zobrist.hpp"
+
+namespace
+{
+	constexpr size_t visitedTableSize = size_t(1) << 20; //8MB of keys. Must be a power of two
+}
+
+/// <summary>
+/// Works out the distinct rotations of every block as bitmasks and starts the search threads, which wait for requests
+/// </summary>
+/// <param name="pieceState">Used to read the rotated piece data</param>
+/// <param name="blocks">The blocks the game can generate</param>
+/// <param name="lines">The most rows a solution may clear, up to maxLines</param>
+/// <param name="threads">How many threads search. 0 uses half of the cores, leaving the rest to the game</param>
+PerfectClearSolver::PerfectClearSolver(PieceState* const pieceState, const Blocks* const blocks, const u8 lines, const u8 threads)
+	: m_lines(std::clamp<u8>(lines, 1, maxLines)), m_visited(visitedTableSize)
+{
+	const RotationSystem rotationSystem(pieceState, blocks);
+	for (u8 type = 0; type < std::min<size_t>(blocks->getBlockTypeCount(), m_shapes.size()); ++type)
+	{
+		for (u8 rotation = 0; rotation < 4; ++rotation)
+		{
+			const RotationSystem::PieceMask& mask = rotationSystem.getMask(type, rotation);
+			Shape shape;
+			shape.rotation = rotation;
+			u8 leftColumn = 8, rightColumn = 0;
+			for (s8 row = static_cast<s8>(mask.size()) - 1; row >= 0; --row)
+			{
+				if (mask[row] == 0) continue;
+				if (shape.height == 0) shape.bottomRow = row;
+				shape.rows[shape.height++] = mask[row];
+				leftColumn = std::min<u8>(leftColumn, static_cast<u8>(std::countr_zero(mask[row])));
+				rightColumn = std::max<u8>(rightColumn, static_cast<u8>(std::bit_width(mask[row])));
+			}
+			if (shape.height == 0) continue;
+
+			shape.leftColumn = leftColumn;
+			shape.width = rightColumn - leftColumn;
+			for (u8 row = 0; row < shape.height; ++row) shape.rows[row] >>= leftColumn;
+
+			//Rotations that cover the same cells, like every rotation of the O piece, would only search the same boards again
+			std::vector<Shape>& shapes = m_shapes[type];
+			const bool duplicate = std::any_of(shapes.begin(), shapes.end(), [&](const Shape& other) { return other.rows == shape.rows; });
+			if (!duplicate) shapes.push_back(shape);
+		}
+	}
+
+	const u8 threadCount = threads > 0 ? threads : static_cast<u8>(std::max(1u, std::thread::hardware_concurrency() / 2));
+	m_coordinator = std::thread(&PerfectClearSolver::coordinate, this);
+	for (u8 helper = 1; helper < threadCount; ++helper)
+	{
+		m_helpers.emplace_back(&PerfectClearSolver::help, this);
+	}
+}
+
+/// <summary>
+/// Cancels any search that is running and waits for the threads to finish
+/// </summary>
+PerfectClearSolver::~PerfectClearSolver()
+{
+	{
+		std::lock_guard lock(m_poolMutex);
+		m_stopping = true;
+	}
+	m_poolCondition.notify_all();
+	m_requestCount.fetch_add(1, std::memory_order_release);
+	m_requestCount.notify_all();
+
+	m_coordinator.join();
+	for (std::thread& helper : m_helpers)
+	{
+		helper.join();
+	}
+}
+
+/// <summary>
+/// Starts looking for perfect clears from the given position, cancelling the previous search. Never blocks. Game thread only.
+/// </summary>
+/// <param name="board">The board</param>
+/// <param name="width">The width of the playing field</param>
+/// <param name="height">The height of the playing field</param>
+/// <param name="state">The player's piece, next piece and held piece</param>
+/// <param name="preview">The pieces that come after the next piece, in order</param>
+/// <returns>The number of the request, which the solution for it will carry</returns>
+u32 PerfectClearSolver::request(const Board& board, const u8 width, const u8 height, const PieceState::State& state, std::span<const u8> preview)
+{
+	Request& request = m_requests.writeBuffer();
+	const u32 id = m_requestCount.load(std::memory_order_relaxed) + 1;
+	request.id = id;
+	request.width = width;
+	request.height = height;
+	request.rows.fill(0);
+	request.stackHeight = 0;
+	const u64 columns = (u64(1) << width) - 1;
+	for (u8 row = 0; row < height; ++row)
+	{
+		const u32 cells = static_cast<u32>((board.getRowMask(height - 1 - row) >> Board::rowMaskMargin) & columns);
+		if (cells == 0) continue;
+		request.stackHeight = row + 1;
+		if (row < maxLines) request.rows[row] = cells;
+	}
+
+	request.queueLength = 0;
+	request.queue[request.queueLength++] = state.piece->type;
+	request.queue[request.queueLength++] = state.nextPiece->type;
+	for (const u8 type : preview)
+	{
+		if (request.queueLength == maxQueue) break;
+		request.queue[request.queueLength++] = type;
+	}
+	request.hold = state.heldPiece != nullptr ? state.heldPiece->type : noPiece;
+	request.canHold = state.canHoldPiece;
+
+	m_requests.publish();
+	m_requestCount.store(id, std::memory_order_release);
+	m_requestCount.notify_one();
+	return id;
+}
+
+/// <summary>
+/// The newest result. Check its request number against the one request() returned, older results are for positions that are gone.
+/// Game thread only.
+/// </summary>
+/// <returns></returns>
+const PerfectClearSolver::Solution& PerfectClearSolver::getSolution()
+{
+	return m_solutions.read();
+}
+
+const u8 PerfectClearSolver::getLines() const
+{
+	return m_lines;
+}
+
+/// <summary>
+/// Waits for requests and searches each one with the helpers, trying solutions that clear fewer rows first
+/// </summary>
+void PerfectClearSolver::coordinate()
+{
+	Tracer::setThreadName("perfect clear solver");
+	u32 seen = 0;
+	while (true)
+	{
+		m_requestCount.wait(seen, std::memory_order_acquire);
+		if (m_stopping) return;
+		seen = m_requestCount.load(std::memory_order_acquire);
+
+		const Request& request = m_requests.read();
+		const Tracer::Scope traceScope("perfect clear search");
+		Solution status;
+		status.request = request.id;
+		status.status = Solution::Status::Searching;
+		publish(status);
+
+		m_found = false;
+		u32 filled = 0;
+		for (const u32 row : request.rows) filled += std::popcount(row);
+		for (u8 lines = std::max<u8>(request.stackHeight, 1); lines <= m_lines && !m_found && !isCancelled(request.id); ++lines)
+		{
+			if ((lines * request.width - filled) % 4 == 0) search(request, lines);
+		}
+
+		if (!m_found && !isCancelled(request.id))
+		{
+			status.status = Solution::Status::NotFound;
+			publish(status);
+		}
+	}
+}
+
+/// <summary>
+/// A helper thread. Joins every search the coordinator starts, taking first moves off the shared list until there are none left.
+/// </summary>
+void PerfectClearSolver::help()
+{
+	Tracer::setThreadName("perfect clear helper");
+	u32 joined = 0;
+	while (true)
+	{
+		const Request* request;
+		{
+			std::unique_lock lock(m_poolMutex);
+			m_poolCondition.wait(lock, [&]() { return m_stopping || (m_activeRequest != nullptr && m_searchesStarted != joined); });
+			if (m_stopping) return;
+			joined = m_searchesStarted;
+			request = m_activeRequest;
+			++m_helpersSearching;
+		}
+
+		runTasks(*request);
+
+		{
+			std::lock_guard lock(m_poolMutex);
+			--m_helpersSearching;
+		}
+		m_poolCondition.notify_all();
+	}
+}
+
+/// <summary>
+/// Searches for a perfect clear that uses exactly the given number of rows. Coordinator thread only.
+/// </summary>
+/// <param name="request">The position to search from</param>
+/// <param name="lines">How many rows the solution clears</param>
+void PerfectClearSolver::search(const Request& request, const u8 lines)
+{
+	++m_searchNumber;
+	m_searchLines = lines;
+
+	Node root;
+	root.rows = request.rows;
+	root.height = lines;
+	root.hold = request.hold;
+	root.canHold = request.canHold;
+
+	//Every first move is a task. There are a few dozen of them, enough to keep every thread busy while one has a big subtree left.
+	m_tasks.clear();
+	for (const bool hold : { false, true })
+	{
+		u8 queueIndex;
+		const u8 piece = getPiece(request, root, hold, queueIndex);
+		if (piece == noPiece) continue;
+
+		for (const Shape& shape : m_shapes[piece])
+		{
+			for (u8 column = 0; column + shape.width <= request.width; ++column)
+			{
+				Task task;
+				if (!place(request, root, piece, shape, column, task.node, task.placement)) continue;
+				task.placement.hold = hold;
+				task.node.queueIndex = queueIndex;
+				task.node.hold = hold ? request.queue[root.queueIndex] : root.hold;
+				task.node.canHold = true;
+				if (isSolvable(request, task.node)) m_tasks.push_back(task);
+			}
+		}
+	}
+
+	m_nextTask = 0;
+	{
+		std::lock_guard lock(m_poolMutex);
+		m_activeRequest = &request;
+		++m_searchesStarted;
+	}
+	m_poolCondition.notify_all();
+
+	runTasks(request);
+
+	//Helpers that haven't picked the search up yet mustn't join it once the task list starts changing
+	std::unique_lock lock(m_poolMutex);
+	m_activeRequest = nullptr;
+	m_poolCondition.wait(lock, [&]() { return m_helpersSearching == 0; });
+}
+
+/// <summary>
+/// Takes first moves off the task list and searches everything after them, until a solution is found or the tasks run out
+/// </summary>
+void PerfectClearSolver::runTasks(const Request& request)
+{
+	std::array<Placement, maxPlacements> path;
+	for (u32 task = m_nextTask++; task < m_tasks.size() && !m_found.load(std::memory_order_relaxed) && !isCancelled(request.id); task = m_nextTask++)
+	{
+		path[0] = m_tasks[task].placement;
+		searchNode(request, m_tasks[task].node, path, 1);
+	}
+}
+
+/// <summary>
+/// Depth first search from a position. Publishes the first solution it finds.
+/// </summary>
+/// <param name="request">The position the search started from</param>
+/// <param name="node">The position to search from</param>
+/// <param name="path">The placements that led to this position</param>
+/// <param name="depth">How many placements led to this position</param>
+/// <returns>Returns true if a solution was found</returns>
+bool PerfectClearSolver::searchNode(const Request& request, const Node& node, std::array<Placement, maxPlacements>& path, const u8 depth)
+{
+	if (node.height == 0)
+	{
+		if (m_found.exchange(true)) return true; //Another thread got there first
+		Solution solution;
+		solution.request = request.id;
+		solution.status = Solution::Status::Found;
+		solution.lines = m_searchLines;
+		solution.placementCount = depth;
+		std::copy(path.begin(), path.begin() + depth, solution.placements.begin());
+		publish(solution);
+		return true;
+	}
+	if (depth == maxPlacements || m_found.load(std::memory_order_relaxed) || isCancelled(request.id) || !markVisited(node)) return false;
+
+	for (const bool hold : { false, true })
+	{
+		u8 queueIndex;
+		const u8 piece = getPiece(request, node, hold, queueIndex);
+		if (piece == noPiece) continue;
+
+		for (const Shape& shape : m_shapes[piece])
+		{
+			for (u8 column = 0; column + shape.width <= request.width; ++column)
+			{
+				Node child;
+				Placement& placement = path[depth];
+				if (!place(request, node, piece, shape, column, child, placement)) continue;
+				placement.hold = hold;
+				child.queueIndex = queueIndex;
+				child.hold = hold ? request.queue[node.queueIndex] : node.hold;
+				child.canHold = true;
+				if (isSolvable(request, child) && searchNode(request, child, path, depth + 1)) return true;
+			}
+		}
+	}
+	return false;
+}
+
+/// <summary>
+/// Which piece is placed next, with or without holding first.
+/// Without holding it is the next piece from the queue. Holding swaps it for the held piece, or for the piece after it if nothing is held.
+/// </summary>
+/// <param name="request">The position the search started from</param>
+/// <param name="node">The position the piece is placed in</param>
+/// <param name="hold">Whether the player holds first</param>
+/// <param name="queueIndex">Set to the next piece to come out of the queue after this one</param>
+/// <returns>The piece type, or noPiece if the queue has run out or holding isn't allowed</returns>
+u8 PerfectClearSolver::getPiece(const Request& request, const Node& node, const bool hold, u8& queueIndex) const
+{
+	queueIndex = node.queueIndex + 1;
+	if (node.queueIndex >= request.queueLength || (hold && !node.canHold)) return noPiece;
+	if (!hold) return request.queue[node.queueIndex];
+	if (node.hold != noPiece) return node.hold;
+	if (node.queueIndex + 1 >= request.queueLength) return noPiece;
+	++queueIndex;
+	return request.queue[node.queueIndex + 1];
+}
+
+/// <summary>
+/// Hard drops a piece from above the stack in the given column
+/// </summary>
+/// <param name="request">The position the search started from</param>
+/// <param name="node">The position the piece is placed in</param>
+/// <param name="piece">The piece type</param>
+/// <param name="shape">The piece in the rotation it is placed in</param>
+/// <param name="column">The column the piece's leftmost cell lands in</param>
+/// <param name="result">The position after the piece has landed and any full rows are cleared</param>
+/// <param name="placement">Where the piece landed</param>
+/// <returns>Returns false if the piece would stick out of the top of the rows being cleared</returns>
+bool PerfectClearSolver::place(const Request& request, const Node& node, const u8 piece, const Shape& shape, const u8 column, Node& result, Placement& placement) const
+{
+	const auto fits = [&](const u8 y)
+	{
+		for (u8 row = 0; row < shape.height && y + row < node.height; ++row)
+		{
+			if (node.rows[y + row] & (shape.rows[row] << column)) return false;
+		}
+		return true;
+	};
+
+	//Rows at and above the height are always empty, so the piece starts there and falls until it lands
+	u8 y = node.height;
+	while (y > 0 && fits(y - 1)) --y;
+	if (y + shape.height > node.height) return false;
+
+	const u32 fullRow = (u32(1) << request.width) - 1;
+	std::array<u32, maxLines> rows = node.rows;
+	for (u8 row = 0; row < shape.height; ++row) rows[y + row] |= shape.rows[row] << column;
+
+	result = node;
+	result.rows.fill(0);
+	u8 kept = 0;
+	for (u8 row = 0; row < node.height; ++row)
+	{
+		if (rows[row] != fullRow) result.rows[kept++] = rows[row];
+	}
+	result.height = kept;
+	result.linesCleared = node.linesCleared + (node.height - kept);
+
+	placement.piece = piece;
+	placement.rotation = shape.rotation;
+	placement.xOffset = static_cast<s8>(column - shape.leftColumn);
+	placement.yOffset = static_cast<u8>(request.height - 1 - y - shape.bottomRow);
+	placement.linesClearedBefore = node.linesCleared;
+	return true;
+}
+
+/// <summary>
+/// Quick checks that rule out positions that can't lead to a perfect clear
+/// </summary>
+/// <returns>Returns false if the position can't be cleared with the pieces that are left</returns>
+bool PerfectClearSolver::isSolvable(const Request& request, const Node& node) const
+{
+	if (node.height == 0) return true;
+
+	const u32 fullRow = (u32(1) << request.width) - 1;
+	std::array<u32, maxLines> empty{};
+	u32 emptyCells = 0;
+	for (u8 row = 0; row < node.height; ++row)
+	{
+		empty[row] = ~node.rows[row] & fullRow;
+		emptyCells += std::popcount(empty[row]);
+	}
+	const u32 piecesLeft = (node.queueIndex < request.queueLength ? request.queueLength - node.queueIndex : 0) + (node.hold != noPiece ? 1 : 0);
+	if (emptyCells % 4 != 0 || emptyCells / 4 > piecesLeft) return false;
+
+	//Every enclosed area of empty cells has to be filled by whole pieces, so each one must be a multiple of four cells.
+	//Areas are flood filled a row at a time with bit operations.
+	for (u8 start = 0; start < node.height; ++start)
+	{
+		while (empty[start] != 0)
+		{
+			std::array<u32, maxLines> area{};
+			area[start] = empty[start] & (~empty[start] + 1);
+			bool grown = true;
+			while (grown)
+			{
+				grown = false;
+				for (u8 row = 0; row < node.height; ++row)
+				{
+					u32 cells = area[row] | (row > 0 ? area[row - 1] : 0) | (row + 1 < node.height ? area[row + 1] : 0);
+					cells &= empty[row];
+					for (u32 previous = 0; cells != previous;)
+					{
+						previous = cells;
+						cells |= ((cells << 1) | (cells >> 1)) & empty[row];
+					}
+					if (cells != area[row])
+					{
+						area[row] = cells;
+						grown = true;
+					}
+				}
+			}
+
+			u32 areaCells = 0;
+			for (u8 row = 0; row < node.height; ++row)
+			{
+				areaCells += std::popcount(area[row]);
+				empty[row] &= ~area[row];
+			}
+			if (areaCells % 4 != 0) return false;
+		}
+	}
+	return true;
+}
+
+bool PerfectClearSolver::isCancelled(const u32 requestId) const
+{
+	return m_requestCount.load(std::memory_order_relaxed) != requestId || m_stopping.load(std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Records a position in the transposition table. Entries can be overwritten by other positions, which only costs searching a position twice.
+/// </summary>
+/// <returns>Returns false if the position has already been searched, or is being searched by another thread</returns>
+bool PerfectClearSolver::markVisited(const Node& node)
+{
+	u64 key = Zobrist::mix(m_searchNumber);
+	for (u8 row = 0; row < node.height; ++row) key = Zobrist::mix(key ^ node.rows[row]);
+	key = Zobrist::mix(key ^ (node.height | node.queueIndex << 8 | node.hold << 16 | static_cast<u32>(node.canHold) << 24)) | 1;
+
+	std::atomic<u64>& entry = m_visited[key & (visitedTableSize - 1)];
+	if (entry.load(std::memory_order_relaxed) == key) return false;
+	entry.store(key, std::memory_order_relaxed);
+	return true;
+}
+
+/// <summary>
+/// Hands a result to the game thread. Results for requests that have been replaced are dropped.
+/// </summary>
+void PerfectClearSolver::publish(const Solution& solution)
+{
+	std::lock_guard lock(m_solutionMutex);
+	if (isCancelled(solution.request)) return;
+	m_solutions.writeBuffer() = solution;
+	m_solutions.publish();
+}
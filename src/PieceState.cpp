@@ -1,11 +1,91 @@
 #include "../Headers/PieceState.hpp"
+#include "../Headers/Zobrist.hpp"
 
-void PieceState::renderPiece(Renderer* const renderer, const std::unique_ptr<Piece>& piece, const u8 rotation, const s8 xOffset, const u8 yOffset,
-	PlayerColor* const playerColor, const PieceToDraw pieceToDraw, const u8 ghostPieceOffset)
+namespace
 {
-	for (int y = 0; y < piece->width; ++y)
+	u64 getPieceKey(const Zobrist::Feature slot, const PieceState::Piece* const piece)
 	{
-		for (int x = 0; x < piece->width; ++x)
+		return Zobrist::key(slot, 0, piece != nullptr ? piece->type + 1u : 0u);
+	}
+
+	u64 getOffsetKey(const s8 xOffset, const u8 yOffset)
+	{
+		return Zobrist::key(Zobrist::Feature::XOffset, 0, static_cast<u8>(xOffset)) ^ Zobrist::key(Zobrist::Feature::YOffset, 0, yOffset);
+	}
+}
+
+void PieceState::State::setPiece(const Piece* const newPiece)
+{
+	hash ^= getPieceKey(Zobrist::Feature::Piece, piece) ^ getPieceKey(Zobrist::Feature::Piece, newPiece);
+	piece = newPiece;
+}
+
+void PieceState::State::setNextPiece(const Piece* const newPiece)
+{
+	hash ^= getPieceKey(Zobrist::Feature::NextPiece, nextPiece) ^ getPieceKey(Zobrist::Feature::NextPiece, newPiece);
+	nextPiece = newPiece;
+}
+
+void PieceState::State::setHeldPiece(const Piece* const newPiece)
+{
+	hash ^= getPieceKey(Zobrist::Feature::HeldPiece, heldPiece) ^ getPieceKey(Zobrist::Feature::HeldPiece, newPiece);
+	heldPiece = newPiece;
+}
+
+/// <summary>
+/// Swaps the current piece with the held piece
+/// </summary>
+void PieceState::State::swapHeldPiece()
+{
+	const Piece* const held = heldPiece;
+	setHeldPiece(piece);
+	setPiece(held);
+}
+
+void PieceState::State::setRotation(const u8 newRotation)
+{
+	hash ^= Zobrist::key(Zobrist::Feature::Rotation, 0, rotation) ^ Zobrist::key(Zobrist::Feature::Rotation, 0, newRotation);
+	rotation = newRotation;
+}
+
+void PieceState::State::setPosition(const s8 x, const u8 y)
+{
+	hash ^= getOffsetKey(xOffset, yOffset) ^ getOffsetKey(x, y);
+	xOffset = x;
+	yOffset = y;
+}
+
+/// <summary>
+/// Moves the piece relative to where it is
+/// </summary>
+/// <param name="x">How many columns to move right, negative to move left</param>
+/// <param name="y">How many rows to move down, negative to move up</param>
+void PieceState::State::move(const s8 x, const s8 y)
+{
+	setPosition(static_cast<s8>(xOffset + x), static_cast<u8>(yOffset + y));
+}
+
+void PieceState::State::setCanHoldPiece(const bool canHold)
+{
+	hash ^= Zobrist::key(Zobrist::Feature::CanHoldPiece, 0, canHoldPiece) ^ Zobrist::key(Zobrist::Feature::CanHoldPiece, 0, canHold);
+	canHoldPiece = canHold;
+}
+
+/// <summary>
+/// Works the hash out from scratch, for checking that the incremental hash hasn't drifted
+/// </summary>
+u64 PieceState::State::computeHash() const
+{
+	return getPieceKey(Zobrist::Feature::Piece, piece) ^ getPieceKey(Zobrist::Feature::NextPiece, nextPiece) ^ getPieceKey(Zobrist::Feature::HeldPiece, heldPiece)
+		^ Zobrist::key(Zobrist::Feature::Rotation, 0, rotation) ^ getOffsetKey(xOffset, yOffset) ^ Zobrist::key(Zobrist::Feature::CanHoldPiece, 0, canHoldPiece);
+}
+
+void PieceState::renderPiece(Renderer* const renderer, const Piece& piece, const u8 rotation, const s8 xOffset, const float yOffset,
+	const PlayerColor* const playerColor, const PieceToDraw pieceToDraw, const u8 ghostPieceOffset)
+{
+	for (int y = 0; y < piece.width; ++y)
+	{
+		for (int x = 0; x < piece.width; ++x)
 		{
 			if (getPieceData(x, y, piece, rotation))
 			{
@@ -37,18 +117,18 @@ void PieceState::renderPiece(Renderer* const renderer, const std::unique_ptr<Pie
 /// <param name="p">The piece</param>
 /// <param name="rotation">The piece's rotation, or the rotation to check if checking for rotation validity</param>
 /// <returns>Returns false if the data is 0, true if data is greater than 0</returns>
-bool PieceState::getPieceData(const u8 x, const u8 y, const std::unique_ptr<Piece>& piece, const u8 rotation)
+bool PieceState::getPieceData(const u8 x, const u8 y, const Piece& piece, const u8 rotation)
 {
 	switch (rotation)
 	{
 	case 0:
-		return (piece->data[y * piece->width + x]);
+		return (piece.data[y * piece.width + x]);
 	case 1:
-		return (piece->data[(piece->width - x - 1) * piece->width + y]);
+		return (piece.data[(piece.width - x - 1) * piece.width + y]);
 	case 2:
-		return (piece->data[(piece->width - y - 1) * piece->width + (piece->width - x - 1)]);
+		return (piece.data[(piece.width - y - 1) * piece.width + (piece.width - x - 1)]);
 	case 3:
-		return (piece->data[(piece->width * x) + (piece->width - y - 1)]);
+		return (piece.data[(piece.width * x) + (piece.width - y - 1)]);
 	default:
 		return 0;
 	}
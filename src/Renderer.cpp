@@ -1,38 +1,10 @@
-#include <filesystem>
-#include <iostream>
-#include "../Headers/Globals.hpp"
 #include "../Headers/Renderer.hpp"
 
 /// <summary>
-/// Initializes the window pointer
+/// Sets up the size every board cell is drawn at
 /// </summary>
-/// <param name="window">A pointer to the main window</param>
-Renderer::Renderer(const u8 pieceSize, sf::RenderWindow* const window) : m_pieceSize(pieceSize), m_window(window) {}
-
-/// <summary>
-/// Returns the state of the window
-/// </summary>
-/// <returns></returns>
-const bool Renderer::isWindowOpen()
-{
-	return m_window->isOpen();
-}
-
-/// <summary>
-/// Clears the renderer
-/// </summary>
-void Renderer::clearRenderer()
-{
-	m_window->clear();
-}
-
-/// <summary>
-/// Displays the renderer
-/// </summary>
-void Renderer::showRenderer()
-{
-	m_window->display();
-}
+/// <param name="pieceSize">The width and height of a board cell, in pixels</param>
+Renderer::Renderer(const u8 pieceSize) : m_pieceSize(pieceSize) {}
 
 void Renderer::drawBorder(const u8 width, const u8 height)
 {
@@ -49,47 +21,60 @@ void Renderer::drawBorder(const u8 width, const u8 height)
 }
 
 /// <summary>
-/// Draws the current piece depending on its position
+/// Moves everything drawn after this to the right, so several boards can share one frame
 /// </summary>
-/// <param name="x">The x position of the piece</param>
-/// <param name="y">The y position of the piece</param>
-/// <param name="fill">The fill color of the piece</param>
-/// <param name="outline">The outline color of the piece</param>
-void Renderer::drawPiece(const s8 x, const s8 y, const sf::Color fill, const sf::Color outline)
+/// <param name="xOffset">How far to move everything, in board cells</param>
+void Renderer::setBoardOffset(const u16 xOffset)
 {
-	sf::RectangleShape rect;
+	m_boardOffset = xOffset;
+}
 
-	rect.setFillColor(fill);
-	rect.setOutlineColor(outline);
-	rect.setOutlineThickness(1);
+/// <summary>
+/// Changes the size everything is drawn at, so one renderer can be reused for layouts with different piece sizes
+/// </summary>
+/// <param name="pieceSize">The width and height of one board cell, in pixels</param>
+void Renderer::setPieceSize(const u8 pieceSize)
+{
+	m_pieceSize = pieceSize;
+}
 
-	rect.setSize(sf::Vector2f(m_pieceSize, m_pieceSize));
-	rect.setPosition((x * m_pieceSize) + (sideBuffer * m_pieceSize), y * m_pieceSize + (verticalBuffer * m_pieceSize) + m_pieceSize);
+/// <summary>
+/// Converts a board column to the pixel position of its left edge
+/// </summary>
+/// <param name="x">The board column</param>
+/// <returns></returns>
+float Renderer::getPieceX(const float x) const
+{
+	return (x * m_pieceSize) + ((sideBuffer + m_boardOffset) * m_pieceSize);
+}
 
-	m_window->draw(rect);
+/// <summary>
+/// Converts a board row to the pixel position of its top edge
+/// </summary>
+/// <param name="y">The board row. Can be fractional for interpolated falling pieces</param>
+/// <returns></returns>
+float Renderer::getPieceY(const float y) const
+{
+	return y * m_pieceSize + (verticalBuffer * m_pieceSize) + m_pieceSize;
 }
 
+
 /// <summary>
-/// Draws the text to the board using the specified font
+/// Converts a text position, laid out for the reference piece size, to a pixel position
 /// </summary>
 /// <param name="x">The x position of the text</param>
-/// <param name="y">The y position of the text</param>
-/// <param name="strToDisplay">The text to display</param>
-void Renderer::drawText(const u16 x, const u16 y, const std::string& strToDisplay)
+/// <returns></returns>
+float Renderer::getTextX(const u16 x) const
 {
-	if (!m_font.loadFromFile("./tetris-font.ttf"))
-	{
-		std::cout << "Error Loading Font" << std::endl;
-	}
-	else
-	{
-		m_text.setFont(m_font);
-		m_text.setString(strToDisplay);
-		m_text.setCharacterSize(24);
-		m_text.setFillColor(sf::Color::Cyan);
-		m_text.setStyle(sf::Text::Bold);
-		m_text.setPosition(x, y);
+	return m_boardOffset * m_pieceSize + x * getTextScale();
+}
 
-		m_window->draw(m_text);
-	}
-}
\ No newline at end of file
+float Renderer::getTextY(const u16 y) const
+{
+	return y * getTextScale();
+}
+
+float Renderer::getTextScale() const
+{
+	return static_cast<float>(m_pieceSize) / referencePieceSize;
+}
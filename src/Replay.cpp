@@ -0,0 +1,180 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "../Headers/Replay.hpp"
+
+/// <summary>
+/// Creates an empty replay. Room for a few thousand moves is reserved so recording doesn't allocate mid-game.
+/// </summary>
+Replay::Replay() : m_header()
+{
+	m_moves.reserve(4096);
+	reset(0, 0, 0, 0, 0, Gravity());
+}
+
+/// <summary>
+/// Clears all recorded moves and starts a new recording with the given settings
+/// </summary>
+/// <param name="seed">The seed the block generator was started with</param>
+/// <param name="numPlayers">The number of players in the game</param>
+/// <param name="gameWidth">The width of the playing field</param>
+/// <param name="gameHeight">The height of the playing field</param>
+/// <param name="boardHeight">The height of the board, including the rows below the playing field</param>
+/// <param name="gravity">The gravity and lock delay the game is played with</param>
+void Replay::reset(const u32 seed, const u8 numPlayers, const u8 gameWidth, const u8 gameHeight, const u8 boardHeight, const Gravity& gravity)
+{
+	m_header.magic = replayMagic;
+	m_header.version = replayVersion;
+	m_header.numPlayers = numPlayers;
+	m_header.gameWidth = gameWidth;
+	m_header.gameHeight = gameHeight;
+	m_header.boardHeight = boardHeight;
+	m_header.lockDelay = gravity.getLockDelay();
+	m_header.seed = seed;
+	m_header.ticks = 0;
+	m_header.moveCount = 0;
+	m_header.maxLockResets = gravity.getMaxLockResets();
+	m_header.reserved = 0;
+	m_header.gravityLevels = static_cast<u16>(gravity.getCurve().size());
+	m_gravityCurve.assign(gravity.getCurve().begin(), gravity.getCurve().begin() + m_header.gravityLevels);
+	m_moves.clear();
+}
+
+/// <summary>
+/// Appends a move to the recording
+/// </summary>
+/// <param name="tick">The tick the move was applied in</param>
+/// <param name="move">The move and the player who made it</param>
+void Replay::recordMove(const u32 tick, const PlayerMove move)
+{
+	m_moves.push_back(ReplayMove{ tick, move.player, static_cast<u8>(move.move), 0 });
+	m_header.moveCount = static_cast<u32>(m_moves.size());
+}
+
+/// <summary>
+/// Sets how many ticks the recorded game lasted
+/// </summary>
+/// <param name="ticks">The total number of ticks</param>
+void Replay::setTicks(const u32 ticks)
+{
+	m_header.ticks = ticks;
+}
+
+const Replay::Header& Replay::getHeader() const
+{
+	return m_header;
+}
+
+const std::vector<ReplayMove>& Replay::getMoves() const
+{
+	return m_moves;
+}
+
+/// <summary>
+/// The gravity settings the recorded game was played with
+/// </summary>
+/// <returns></returns>
+Gravity Replay::getGravity() const
+{
+	return Gravity(m_gravityCurve, m_header.lockDelay, m_header.maxLockResets);
+}
+
+/// <summary>
+/// Writes the replay to disk, creating the parent directory if needed
+/// </summary>
+/// <param name="path">The file to write</param>
+/// <returns>Returns false if the file couldn't be written</returns>
+bool Replay::saveToFile(const std::filesystem::path& path) const
+{
+	std::error_code error;
+	if (path.has_parent_path()) std::filesystem::create_directories(path.parent_path(), error);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Error saving replay " << path << std::endl;
+		return false;
+	}
+	file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+	file.write(reinterpret_cast<const char*>(m_gravityCurve.data()), m_gravityCurve.size() * sizeof(u32));
+	file.write(reinterpret_cast<const char*>(m_moves.data()), m_moves.size() * sizeof(ReplayMove));
+	return file.good();
+}
+
+/// <summary>
+/// Reads a replay from disk
+/// </summary>
+/// <param name="path">The file to read</param>
+/// <returns>Returns false if the file couldn't be read or isn't a replay of this version</returns>
+bool Replay::loadFromFile(const std::filesystem::path& path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	Header header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+	if (header.magic != replayMagic) return false;
+	if (header.version != replayVersion)
+	{
+		std::cerr << path << " was recorded with replay version " << header.version << ", this build only plays version " << replayVersion << std::endl;
+		return false;
+	}
+
+	//The counts are checked against the file before anything is allocated for them, so a corrupt header can't ask for gigabytes
+	std::error_code error;
+	const u64 fileSize = std::filesystem::file_size(path, error);
+	const u64 replaySize = sizeof(header) + u64(header.gravityLevels) * sizeof(u32) + u64(header.moveCount) * sizeof(ReplayMove);
+	if (error || fileSize < replaySize) return false;
+
+	m_gravityCurve.resize(header.gravityLevels);
+	if (!file.read(reinterpret_cast<char*>(m_gravityCurve.data()), header.gravityLevels * sizeof(u32))) return false;
+
+	m_moves.resize(header.moveCount);
+	if (!file.read(reinterpret_cast<char*>(m_moves.data()), header.moveCount * sizeof(ReplayMove))) return false;
+
+	m_header = header;
+	return true;
+}
+
+/// <summary>
+/// Works out how many bytes the replay at the start of the data takes up, without reading it
+/// </summary>
+/// <param name="data">The start of the replay</param>
+/// <param name="size">How many bytes are available from the start of the replay</param>
+/// <returns>The size of the replay, or 0 if the data isn't a complete replay of this version</returns>
+size_t Replay::measure(const u8* data, const size_t size)
+{
+	Header header;
+	if (size < sizeof(header)) return 0;
+	std::memcpy(&header, data, sizeof(header));
+	if (header.magic != replayMagic || header.version != replayVersion) return 0;
+
+	const size_t replaySize = sizeof(header) + header.gravityLevels * sizeof(u32) + header.moveCount * sizeof(ReplayMove);
+	return size < replaySize ? 0 : replaySize;
+}
+
+/// <summary>
+/// Reads a replay from memory, e.g. from a memory-mapped file. Replay files can be concatenated into one file,
+/// and read back by calling this repeatedly with the data after the previous replay.
+/// </summary>
+/// <param name="data">The start of the replay</param>
+/// <param name="size">How many bytes are available from the start of the replay</param>
+/// <returns>How many bytes the replay took up, or 0 if the data isn't a complete replay of this version</returns>
+size_t Replay::loadFromMemory(const u8* data, const size_t size)
+{
+	const size_t replaySize = measure(data, size);
+	if (replaySize == 0) return 0;
+
+	Header header;
+	std::memcpy(&header, data, sizeof(header));
+	const u8* gravityCurve = data + sizeof(header);
+	const u8* moves = gravityCurve + header.gravityLevels * sizeof(u32);
+	m_gravityCurve.resize(header.gravityLevels);
+	if (!m_gravityCurve.empty()) std::memcpy(m_gravityCurve.data(), gravityCurve, m_gravityCurve.size() * sizeof(u32));
+	m_moves.resize(header.moveCount);
+	if (!m_moves.empty()) std::memcpy(m_moves.data(), moves, m_moves.size() * sizeof(ReplayMove));
+
+	m_header = header;
+	return replaySize;
+}
@@ -0,0 +1,77 @@
+#include "../Headers/RotationSystem.hpp"
+
+/// <summary>
+/// Builds the row masks of every block in every rotation, so kick tests never have to look at individual cells
+/// </summary>
+/// <param name="pieceState">Used to read the rotated piece data</param>
+/// <param name="blocks">The blocks the game can generate</param>
+RotationSystem::RotationSystem(PieceState* const pieceState, const Blocks* const blocks)
+{
+	m_masks.resize(blocks->getBlockTypeCount());
+	for (u8 type = 0; type < blocks->getBlockTypeCount(); ++type)
+	{
+		const PieceState::Piece& piece = blocks->getBlock(type);
+		for (u8 rotation = 0; rotation < 4; ++rotation)
+		{
+			PieceMask& mask = m_masks[type][rotation];
+			mask.fill(0);
+			for (u8 y = 0; y < piece.width; ++y)
+			{
+				for (u8 x = 0; x < piece.width; ++x)
+				{
+					if (pieceState->getPieceData(x, y, piece, rotation)) mask[y] |= 1 << x;
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Gets the kick offsets to try, in order, for rotating the piece in the given direction
+/// </summary>
+/// <param name="piece">The piece being rotated</param>
+/// <param name="fromRotation">The rotation the piece is in now</param>
+/// <param name="direction">Which way the piece is being rotated</param>
+/// <returns>The kicks to test. Empty for the O piece, which doesn't rotate</returns>
+std::span<const RotationSystem::Kick> RotationSystem::getKicks(const PieceState::Piece& piece, const u8 fromRotation, const RotationDirection direction) const
+{
+	constexpr u8 oPieceWidth = 2, iPieceWidth = 4;
+	if (piece.width == oPieceWidth) return {};
+
+	const u8 toRotation = (fromRotation + static_cast<u8>(direction)) % 4;
+	const u8 tests = direction == RotationDirection::Half ? halfKickTests : kickTests;
+	if (piece.width == iPieceWidth) return std::span<const Kick>(m_iKicks[fromRotation][toRotation], tests);
+	return std::span<const Kick>(m_jlstzKicks[fromRotation][toRotation], tests);
+}
+
+/// <summary>
+/// Checks whether a piece in the given rotation and position is inside the board and doesn't overlap any placed blocks
+/// </summary>
+/// <param name="board">The board to check against</param>
+/// <param name="pieceType">The type of the piece</param>
+/// <param name="rotation">The rotation to check</param>
+/// <param name="x">The board column of the piece's left edge</param>
+/// <param name="y">The board row of the piece's top edge</param>
+/// <param name="floor">The first row below the playing field</param>
+/// <returns></returns>
+bool RotationSystem::fits(const Board& board, const u8 pieceType, const u8 rotation, const s8 x, const s8 y, const u8 floor) const
+{
+	const int shift = x + Board::rowMaskMargin;
+	if (shift < 0) return false;
+
+	const PieceMask& mask = m_masks[pieceType][rotation];
+	for (u8 row = 0; row < mask.size(); ++row)
+	{
+		if (mask[row] == 0) continue;
+
+		const s8 boardY = y + row;
+		const u64 boardRow = boardY >= floor ? ~u64(0) : board.getRowMask(boardY);
+		if ((static_cast<u64>(mask[row]) << shift) & boardRow) return false;
+	}
+	return true;
+}
+
+const RotationSystem::PieceMask& RotationSystem::getMask(const u8 pieceType, const u8 rotation) const
+{
+	return m_masks[pieceType][rotation];
+}
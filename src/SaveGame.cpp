@@ -0,0 +1,212 @@
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../Headers/SaveGame.hpp"
+
+static_assert(sizeof(SaveGame::Header) == 32 && sizeof(SaveGame::PlayerRecord) == 16, "The save layout must not contain padding");
+
+namespace
+{
+	/// <summary>
+	/// Writes the data to a new file and waits until it has reached the disk, so a crash after it is renamed can't leave an empty or partial save behind
+	/// </summary>
+	bool writeFileDurably(const std::filesystem::path& path, const std::vector<u8>& data)
+	{
+#ifdef _WIN32
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+		DWORD written = 0;
+		const bool synced = WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &written, nullptr) && written == data.size() && FlushFileBuffers(file);
+		CloseHandle(file);
+		return synced;
+#else
+		const int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (file == -1) return false;
+		size_t written = 0;
+		while (written < data.size())
+		{
+			const ssize_t result = write(file, data.data() + written, data.size() - written);
+			if (result == -1) break;
+			written += static_cast<size_t>(result);
+		}
+		const bool synced = written == data.size() && fsync(file) == 0;
+		return close(file) == 0 && synced;
+#endif
+	}
+
+	/// <summary>
+	/// Makes a rename in the directory durable. Windows has no equivalent, and doesn't need one
+	/// </summary>
+	void syncDirectory(const std::filesystem::path& directory)
+	{
+#ifndef _WIN32
+		const int handle = open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_DIRECTORY);
+		if (handle == -1) return;
+		fsync(handle);
+		close(handle);
+#endif
+	}
+}
+
+/// <summary>
+/// Sets the location of the save file. Nothing is read or written until asked to.
+/// </summary>
+/// <param name="path">The save file</param>
+SaveGame::SaveGame(const std::filesystem::path& path) : m_path(path) {}
+
+/// <summary>
+/// Finishes any write that is still in progress and releases the mapping
+/// </summary>
+SaveGame::~SaveGame()
+{
+	waitForWrite();
+	unmap();
+}
+
+/// <summary>
+/// Returns whether there is a saved game to resume
+/// </summary>
+/// <returns></returns>
+const bool SaveGame::exists() const
+{
+	std::error_code error;
+	return std::filesystem::exists(m_path, error);
+}
+
+/// <summary>
+/// Writes the serialized game to disk on a background thread. The data is copied, so the caller can reuse its buffer straight away.
+/// Only one write is in flight at a time; a new save waits for the previous one to finish first.
+/// </summary>
+/// <param name="data">The serialized game</param>
+void SaveGame::writeAsync(const std::vector<u8>& data)
+{
+	waitForWrite();
+	m_writeBuffer.assign(data.begin(), data.end());
+
+	m_writer = std::thread([this]()
+	{
+		std::filesystem::path tempPath = m_path;
+		tempPath += ".tmp";
+		if (!writeFileDurably(tempPath, m_writeBuffer))
+		{
+			std::cerr << "Error writing save file " << tempPath << std::endl;
+			return;
+		}
+		std::error_code error;
+		std::filesystem::rename(tempPath, m_path, error); //Atomically replaces the previous save
+		if (error)
+		{
+			std::cerr << "Error replacing save file " << m_path << ": " << error.message() << std::endl;
+			return;
+		}
+		syncDirectory(m_path.parent_path());
+	});
+}
+
+/// <summary>
+/// Blocks until the last save has been written
+/// </summary>
+void SaveGame::waitForWrite()
+{
+	if (m_writer.joinable()) m_writer.join();
+}
+
+/// <summary>
+/// Deletes the save file, e.g. once the saved game has ended
+/// </summary>
+void SaveGame::remove()
+{
+	waitForWrite();
+	unmap();
+	std::error_code error;
+	std::filesystem::remove(m_path, error);
+}
+
+/// <summary>
+/// Memory-maps the save file read-only and checks that it is a complete save of this version
+/// </summary>
+/// <returns>Returns false if there is no valid save to load</returns>
+bool SaveGame::map()
+{
+	unmap();
+	std::error_code error;
+	const size_t size = std::filesystem::exists(m_path, error) ? static_cast<size_t>(std::filesystem::file_size(m_path, error)) : 0;
+	if (error || size < sizeof(Header)) return false;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileW(m_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	const void* view = mapping != nullptr ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		if (mapping != nullptr) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+#else
+	const int fd = open(m_path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) return false;
+#endif
+	m_mapped = static_cast<const u8*>(view);
+	m_mappedSize = size;
+
+	const Header* header = getHeader();
+	const size_t expectedSize = sizeof(Header) + boardSize(header->gameWidth, header->boardHeight) + header->numPlayers * sizeof(PlayerRecord);
+	if (header->magic != saveMagic || header->version != saveVersion || header->numPlayers == 0 || header->numPlayers > maxPlayers || m_mappedSize < expectedSize)
+	{
+		std::cerr << "Save file " << m_path << " is not a valid save" << std::endl;
+		unmap();
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Releases the mapped save file. Any pointers returned by the getters are invalid afterwards.
+/// </summary>
+void SaveGame::unmap()
+{
+	if (m_mapped == nullptr) return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_mapped);
+	CloseHandle(m_mappingHandle);
+	CloseHandle(m_fileHandle);
+	m_mappingHandle = m_fileHandle = nullptr;
+#else
+	munmap(const_cast<u8*>(m_mapped), m_mappedSize);
+#endif
+	m_mapped = nullptr;
+	m_mappedSize = 0;
+}
+
+const SaveGame::Header* SaveGame::getHeader() const
+{
+	return reinterpret_cast<const Header*>(m_mapped);
+}
+
+const u8* SaveGame::getBoard() const
+{
+	return m_mapped + sizeof(Header);
+}
+
+const SaveGame::PlayerRecord* SaveGame::getPlayers() const
+{
+	return reinterpret_cast<const PlayerRecord*>(getBoard() + boardSize(getHeader()->gameWidth, getHeader()->boardHeight));
+}
@@ -0,0 +1,232 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#include "../Headers/SoftwareRenderer.hpp"
+#include "../Headers/FrameEncoder.hpp"
+#include "../Headers/ParticleSystem.hpp"
+
+namespace
+{
+	/// <summary>
+	/// A 5x7 bitmap glyph. Each row is 5 bits, with the leftmost pixel in bit 4.
+	/// </summary>
+	struct Glyph
+	{
+		char character;
+		u8 rows[7];
+	};
+
+	//Covers everything the HUD draws. Lowercase letters are drawn as uppercase, anything else is drawn as a space.
+	constexpr Glyph glyphs[] = {
+		{ '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } }, { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+		{ '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } }, { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+		{ '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } }, { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+		{ '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } }, { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+		{ '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } }, { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+		{ ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } }, { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+		{ '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } }, { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+		{ 'A', { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 } }, { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+		{ 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } }, { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+		{ 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } }, { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+		{ 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } }, { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+		{ 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } }, { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+		{ 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } }, { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+		{ 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } }, { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+		{ 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } }, { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+		{ 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } }, { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+		{ 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } }, { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+		{ 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } }, { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+		{ 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } }, { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+		{ 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } }, { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } }
+	};
+
+	const Glyph* findGlyph(const char character)
+	{
+		const char upper = static_cast<char>(std::toupper(static_cast<unsigned char>(character)));
+		for (const Glyph& glyph : glyphs)
+		{
+			if (glyph.character == upper) return &glyph;
+		}
+		return nullptr;
+	}
+}
+
+/// <summary>
+/// Creates a black frame of the given size
+/// </summary>
+/// <param name="pieceSize">The width and height of a board cell, in pixels</param>
+/// <param name="width">The width of the frame, in pixels</param>
+/// <param name="height">The height of the frame, in pixels</param>
+SoftwareRenderer::SoftwareRenderer(const u8 pieceSize, const u16 width, const u16 height) : Renderer(pieceSize), m_width(width), m_height(height)
+{
+	m_pixels.resize(static_cast<size_t>(width) * height * 4);
+	clearRenderer();
+}
+
+/// <summary>
+/// There is no window to close, so the renderer is always open
+/// </summary>
+/// <returns></returns>
+const bool SoftwareRenderer::isWindowOpen()
+{
+	return true;
+}
+
+void SoftwareRenderer::setActive(const bool) {}
+
+void SoftwareRenderer::closeWindow() {}
+
+/// <summary>
+/// Clears the frame to opaque black
+/// </summary>
+void SoftwareRenderer::clearRenderer()
+{
+	for (size_t i = 0; i < m_pixels.size(); i += 4)
+	{
+		m_pixels[i] = 0;
+		m_pixels[i + 1] = 0;
+		m_pixels[i + 2] = 0;
+		m_pixels[i + 3] = 255;
+	}
+}
+
+/// <summary>
+/// Finishes the frame and hands it to the frame encoder
+/// </summary>
+void SoftwareRenderer::showRenderer()
+{
+	++m_framesShown;
+	if (m_frameEncoder != nullptr) m_frameEncoder->submit(m_pixels);
+}
+
+/// <summary>
+/// Draws a board cell the same way the window renderer does: a filled square with a one pixel outline around the outside of it
+/// </summary>
+/// <param name="x">The x position of the piece, in board cells</param>
+/// <param name="y">The y position of the piece, in board cells. Can be fractional for interpolated falling pieces</param>
+/// <param name="fill">The fill color of the piece</param>
+/// <param name="outline">The outline color of the piece</param>
+void SoftwareRenderer::drawPiece(const float x, const float y, const sf::Color fill, const sf::Color outline)
+{
+	const s32 left = static_cast<s32>(std::lround(getPieceX(x)));
+	const s32 top = static_cast<s32>(std::lround(getPieceY(y)));
+	const s32 right = left + m_pieceSize, bottom = top + m_pieceSize;
+
+	fillRect(left, top, right, bottom, fill);
+	fillRect(left - 1, top - 1, right + 1, top, outline);
+	fillRect(left - 1, bottom, right + 1, bottom + 1, outline);
+	fillRect(left - 1, top, left, bottom, outline);
+	fillRect(right, top, right + 1, bottom, outline);
+}
+
+/// <summary>
+/// Draws the text with the built-in bitmap font
+/// </summary>
+/// <param name="x">The x position of the text</param>
+/// <param name="y">The y position of the text</param>
+/// <param name="strToDisplay">The text to display</param>
+void SoftwareRenderer::drawText(const u16 x, const u16 y, const std::string_view strToDisplay)
+{
+	const s32 scale = std::max(1, static_cast<s32>(std::lround(textScale * getTextScale())));
+	const s32 top = static_cast<s32>(std::lround(getTextY(y)));
+	s32 penX = static_cast<s32>(std::lround(getTextX(x)));
+	for (const char character : strToDisplay)
+	{
+		const Glyph* glyph = findGlyph(character);
+		for (u8 row = 0; glyph != nullptr && row < glyphHeight; ++row)
+		{
+			for (u8 column = 0; column < glyphWidth; ++column)
+			{
+				if (glyph->rows[row] & (1 << (glyphWidth - 1 - column)))
+				{
+					const s32 pixelX = penX + column * scale, pixelY = top + row * scale;
+					fillRect(pixelX, pixelY, pixelX + scale, pixelY + scale, m_textColor);
+				}
+			}
+		}
+		penX += (glyphWidth + 1) * scale;
+	}
+}
+
+/// <summary>
+/// Blends every live particle into the frame as a square at least one pixel wide
+/// </summary>
+/// <param name="particles">The particles to draw</param>
+void SoftwareRenderer::drawParticles(const ParticleSystem& particles)
+{
+	const float* const x = particles.getX();
+	const float* const y = particles.getY();
+	const float* const sizes = particles.getSizes();
+	const sf::Color* const colors = particles.getColors();
+	const u8* const alphas = particles.getAlphas();
+	for (u32 i = 0; i < particles.getCount(); ++i)
+	{
+		const s32 size = std::max(1, static_cast<s32>(std::lround(sizes[i] * m_pieceSize)));
+		const s32 left = static_cast<s32>(std::lround(getPieceX(x[i]))) - size / 2;
+		const s32 top = static_cast<s32>(std::lround(getPieceY(y[i]))) - size / 2;
+		fillRect(left, top, left + size, top + size, sf::Color(colors[i].r, colors[i].g, colors[i].b, alphas[i]));
+	}
+}
+
+/// <summary>
+/// Sets the encoder every shown frame is sent to. Pass nullptr to stop sending frames.
+/// </summary>
+/// <param name="frameEncoder">The encoder to use</param>
+void SoftwareRenderer::setFrameEncoder(FrameEncoder* const frameEncoder)
+{
+	m_frameEncoder = frameEncoder;
+}
+
+/// <summary>
+/// The current frame, as rows of RGBA pixels from the top left
+/// </summary>
+/// <returns></returns>
+const std::vector<u8>& SoftwareRenderer::getPixels() const
+{
+	return m_pixels;
+}
+
+const u16 SoftwareRenderer::getWidth() const
+{
+	return m_width;
+}
+
+const u16 SoftwareRenderer::getHeight() const
+{
+	return m_height;
+}
+
+const u32 SoftwareRenderer::getFramesShown() const
+{
+	return m_framesShown;
+}
+
+/// <summary>
+/// Alpha blends a color over a rectangle of the frame. The rectangle is clipped to the frame.
+/// </summary>
+/// <param name="left">The first column</param>
+/// <param name="top">The first row</param>
+/// <param name="right">One past the last column</param>
+/// <param name="bottom">One past the last row</param>
+/// <param name="color">The color to blend in</param>
+void SoftwareRenderer::fillRect(s32 left, s32 top, s32 right, s32 bottom, const sf::Color color)
+{
+	left = std::max(left, 0);
+	top = std::max(top, 0);
+	right = std::min<s32>(right, m_width);
+	bottom = std::min<s32>(bottom, m_height);
+	if (color.a == 0) return;
+
+	const u32 alpha = color.a, inverse = 255 - color.a;
+	for (s32 y = top; y < bottom; ++y)
+	{
+		u8* pixel = m_pixels.data() + (static_cast<size_t>(y) * m_width + left) * 4;
+		for (s32 x = left; x < right; ++x, pixel += 4)
+		{
+			pixel[0] = static_cast<u8>((color.r * alpha + pixel[0] * inverse + 127) / 255);
+			pixel[1] = static_cast<u8>((color.g * alpha + pixel[1] * inverse + 127) / 255);
+			pixel[2] = static_cast<u8>((color.b * alpha + pixel[2] * inverse + 127) / 255);
+		}
+	}
+}
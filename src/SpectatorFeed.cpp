@@ -0,0 +1,114 @@
+#include <iostream>
+#include <algorithm>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define SPECTATOR_FEED_AVAILABLE
+#endif
+
+#include "../Headers/SpectatorFeed.hpp"
+
+static_assert(SpectatorFeedLayout::maxPlayers == maxPlayers, "The feed layout must hold every player");
+static_assert(SpectatorFeedLayout::maxBoardWidth == maxBoardWidth && SpectatorFeedLayout::maxBoardHeight == maxBoardHeight, "The feed layout must hold the largest board");
+static_assert(SpectatorFeedLayout::noPiece == PlayerSnapshot::noPiece, "The feed and the snapshot must agree on what an empty piece is");
+
+/// <summary>
+/// Creates (or takes over) the shared-memory object and writes the feed header.
+/// If the shared memory can't be set up the feed stays closed and publish() does nothing.
+/// </summary>
+/// <param name="name">The POSIX shared-memory object name readers attach to</param>
+SpectatorFeed::SpectatorFeed(const std::string& name) : m_name(name)
+{
+#ifdef SPECTATOR_FEED_AVAILABLE
+	const int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644);
+	if (fd < 0)
+	{
+		std::cerr << "Error opening spectator feed " << m_name << std::endl;
+		return;
+	}
+	if (ftruncate(fd, sizeof(SpectatorFeedLayout::Feed)) != 0)
+	{
+		std::cerr << "Error sizing spectator feed " << m_name << std::endl;
+		close(fd);
+		return;
+	}
+	void* memory = mmap(nullptr, sizeof(SpectatorFeedLayout::Feed), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (memory == MAP_FAILED)
+	{
+		std::cerr << "Error mapping spectator feed " << m_name << std::endl;
+		return;
+	}
+
+	m_feed = new (memory) SpectatorFeedLayout::Feed();
+	m_feed->header.magic = SpectatorFeedLayout::feedMagic;
+	m_feed->header.version = SpectatorFeedLayout::feedVersion;
+	m_feed->header.slotCount = SpectatorFeedLayout::slotCount;
+	m_feed->header.frameSize = sizeof(SpectatorFeedLayout::Frame);
+#endif
+}
+
+/// <summary>
+/// Unmaps and removes the shared-memory object. Readers that are still attached keep their mapping until they detach.
+/// </summary>
+SpectatorFeed::~SpectatorFeed()
+{
+#ifdef SPECTATOR_FEED_AVAILABLE
+	if (m_feed == nullptr) return;
+
+	munmap(m_feed, sizeof(SpectatorFeedLayout::Feed));
+	shm_unlink(m_name.c_str());
+#endif
+}
+
+/// <summary>
+/// Returns whether the shared memory was set up and frames are being published
+/// </summary>
+/// <returns></returns>
+const bool SpectatorFeed::isOpen()
+{
+	return m_feed != nullptr;
+}
+
+/// <summary>
+/// Writes one tick of game state into the next slot of the ring buffer.
+/// The slot's sequence number is made odd while writing so readers can detect and retry torn copies.
+/// </summary>
+/// <param name="snapshot">The game state published for this tick</param>
+void SpectatorFeed::publish(const GameSnapshot& snapshot)
+{
+	if (m_feed == nullptr) return;
+
+	const u64 frameNumber = ++m_publishedFrames;
+	SpectatorFeedLayout::Frame& frame = m_feed->frames[(frameNumber - 1) % SpectatorFeedLayout::slotCount];
+
+	frame.sequence.store(frameNumber * 2 - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	frame.tick = snapshot.tick;
+	frame.stateHash = snapshot.stateHash;
+	frame.lines = snapshot.lines;
+	frame.level = snapshot.level;
+	frame.numPlayers = snapshot.numPlayers;
+	frame.boardWidth = snapshot.boardWidth;
+	frame.boardHeight = maxBoardHeight;
+	frame.gameOver = snapshot.gameOver;
+	for (u8 playerIndex = 0; playerIndex < maxPlayers; ++playerIndex)
+	{
+		const PlayerSnapshot& player = snapshot.players[playerIndex];
+		SpectatorFeedLayout::Player& out = frame.players[playerIndex];
+		out.piece = playerIndex < snapshot.numPlayers ? player.piece : SpectatorFeedLayout::noPiece;
+		out.rotation = player.rotation;
+		out.xOffset = player.xOffset;
+		out.yOffset = player.yOffset;
+		out.nextPiece = playerIndex < snapshot.numPlayers ? player.nextPiece : SpectatorFeedLayout::noPiece;
+		out.heldPiece = playerIndex < snapshot.numPlayers ? player.heldPiece : SpectatorFeedLayout::noPiece;
+	}
+	std::copy(snapshot.board.begin(), snapshot.board.end(), frame.board);
+
+	frame.sequence.store(frameNumber * 2, std::memory_order_release);
+	m_feed->header.publishedFrames.store(frameNumber, std::memory_order_release);
+}
@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "../Headers/Telemetry.hpp"
+
+/// <summary>
+/// A steady wall clock in microseconds, shared by the threads that report and the exporter
+/// </summary>
+static s64 nowMicroseconds()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// <summary>
+/// Starts the exporter thread, which rewrites the metrics file every flush interval
+/// </summary>
+/// <param name="file">The file the metrics are written to</param>
+/// <param name="flushInterval">How often the file is rewritten</param>
+Telemetry::Telemetry(const std::filesystem::path& file, const sf::Time flushInterval) : m_file(file), m_flushInterval(flushInterval)
+{
+	std::error_code error;
+	if (m_file.has_parent_path()) std::filesystem::create_directories(m_file.parent_path(), error);
+	m_sessionStart = nowMicroseconds();
+	m_exporter = std::thread(&Telemetry::exporter, this);
+}
+
+/// <summary>
+/// Writes the final values and stops the exporter
+/// </summary>
+Telemetry::~Telemetry()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_wake.notify_one();
+	m_exporter.join();
+}
+
+/// <summary>
+/// Starts listening to the game's events. Call it once, before any game starts.
+/// </summary>
+/// <param name="eventBus">The bus the games publish to</param>
+void Telemetry::subscribe(EventBus& eventBus)
+{
+	m_eventBus.store(&eventBus, std::memory_order_relaxed);
+	m_events.store(eventBus.subscribe(), std::memory_order_release);
+}
+
+/// <summary>
+/// Resets every counter for a new game
+/// </summary>
+/// <param name="numPlayers">The number of players in the new game</param>
+void Telemetry::startSession(const u8 numPlayers)
+{
+	for (std::atomic<u64>& pieces : m_piecesPlaced) pieces.store(0, std::memory_order_relaxed);
+	for (std::atomic<u64>& clears : m_clears) clears.store(0, std::memory_order_relaxed);
+	for (std::atomic<s64>& levelTime : m_levelMicroseconds) levelTime.store(0, std::memory_order_relaxed);
+	m_level.store(0, std::memory_order_relaxed);
+	m_levelStartMicroseconds.store(0, std::memory_order_relaxed);
+	m_inputQueueDepth.store(0, std::memory_order_relaxed);
+	m_maxInputQueueDepth.store(0, std::memory_order_relaxed);
+	m_frames.store(0, std::memory_order_relaxed);
+	m_droppedFrames.store(0, std::memory_order_relaxed);
+	m_numPlayers.store(numPlayers, std::memory_order_relaxed);
+	m_sessionStart.store(nowMicroseconds(), std::memory_order_relaxed);
+}
+
+void Telemetry::piecePlaced(const u8 playerIndex)
+{
+	m_piecesPlaced[playerIndex].fetch_add(1, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Counts a line clear by how many lines it cleared at once
+/// </summary>
+/// <param name="count">The number of lines cleared together, greater than 0</param>
+void Telemetry::linesCleared(const u8 count)
+{
+	m_clears[std::min(count, maxClearSize) - 1].fetch_add(1, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Adds the time spent in the previous level and starts timing the new one. Does nothing if the level didn't change.
+/// </summary>
+/// <param name="level">The current level</param>
+/// <param name="gameTime">How long the game has been running, in simulation time</param>
+void Telemetry::levelChanged(const u8 level, const sf::Time gameTime)
+{
+	const u8 previousLevel = m_level.load(std::memory_order_relaxed);
+	if (level == previousLevel) return;
+
+	const s64 now = gameTime.asMicroseconds();
+	const s64 levelTime = now - m_levelStartMicroseconds.load(std::memory_order_relaxed);
+	m_levelMicroseconds[std::min(previousLevel, static_cast<u8>(trackedLevels - 1))].fetch_add(levelTime, std::memory_order_relaxed);
+	m_levelStartMicroseconds.store(now, std::memory_order_relaxed);
+	m_level.store(level, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Records how many moves were waiting to be applied at the start of a tick
+/// </summary>
+void Telemetry::inputQueueDepth(const u32 depth)
+{
+	m_inputQueueDepth.store(depth, std::memory_order_relaxed);
+	if (depth > m_maxInputQueueDepth.load(std::memory_order_relaxed))
+	{
+		m_maxInputQueueDepth.store(depth, std::memory_order_relaxed); //Only the game thread writes it, so no compare-exchange is needed
+	}
+}
+
+/// <summary>
+/// Counts a rendered frame, and a dropped frame if it took long enough to have missed a display refresh
+/// </summary>
+/// <param name="frameTime">How long the frame took from start to display</param>
+void Telemetry::frameRendered(const sf::Time frameTime)
+{
+	m_frames.fetch_add(1, std::memory_order_relaxed);
+	if (frameTime.asMicroseconds() > droppedFrameMicroseconds)
+	{
+		m_droppedFrames.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/// <summary>
+/// Formats every metric in the Prometheus text exposition format
+/// </summary>
+/// <returns></returns>
+std::string Telemetry::exportText() const
+{
+	const double sessionSeconds = std::max(1e-6, (nowMicroseconds() - m_sessionStart.load(std::memory_order_relaxed)) / 1e6);
+	const u8 numPlayers = m_numPlayers.load(std::memory_order_relaxed);
+	std::ostringstream out;
+
+	out << "# HELP tetris_session_seconds Time since the current game started.\n# TYPE tetris_session_seconds gauge\n";
+	out << "tetris_session_seconds " << sessionSeconds << "\n";
+
+	out << "# HELP tetris_pieces_placed_total Pieces locked into the board this session.\n# TYPE tetris_pieces_placed_total counter\n";
+	for (u8 playerIndex = 0; playerIndex < numPlayers; ++playerIndex)
+	{
+		out << "tetris_pieces_placed_total{player=\"" << playerIndex + 1 << "\"} " << m_piecesPlaced[playerIndex].load(std::memory_order_relaxed) << "\n";
+	}
+	out << "# HELP tetris_pieces_per_second Pieces locked per second this session.\n# TYPE tetris_pieces_per_second gauge\n";
+	for (u8 playerIndex = 0; playerIndex < numPlayers; ++playerIndex)
+	{
+		out << "tetris_pieces_per_second{player=\"" << playerIndex + 1 << "\"} " << m_piecesPlaced[playerIndex].load(std::memory_order_relaxed) / sessionSeconds << "\n";
+	}
+
+	out << "# HELP tetris_line_clears_total Line clears this session, by how many lines were cleared at once.\n# TYPE tetris_line_clears_total counter\n";
+	for (u8 size = 1; size <= maxClearSize; ++size)
+	{
+		out << "tetris_line_clears_total{lines=\"" << static_cast<int>(size) << "\"} " << m_clears[size - 1].load(std::memory_order_relaxed) << "\n";
+	}
+
+	out << "# HELP tetris_level Current level.\n# TYPE tetris_level gauge\n";
+	out << "tetris_level " << m_level.load(std::memory_order_relaxed) + 1 << "\n";
+	out << "# HELP tetris_level_seconds_total Game time spent in each finished level this session.\n# TYPE tetris_level_seconds_total counter\n";
+	for (u8 level = 0; level < trackedLevels; ++level)
+	{
+		const s64 levelTime = m_levelMicroseconds[level].load(std::memory_order_relaxed);
+		if (levelTime > 0) out << "tetris_level_seconds_total{level=\"" << level + 1 << "\"} " << levelTime / 1e6 << "\n";
+	}
+
+	out << "# HELP tetris_frames_total Frames rendered this session.\n# TYPE tetris_frames_total counter\n";
+	out << "tetris_frames_total " << m_frames.load(std::memory_order_relaxed) << "\n";
+	out << "# HELP tetris_dropped_frames_total Frames that took longer than two display refreshes.\n# TYPE tetris_dropped_frames_total counter\n";
+	out << "tetris_dropped_frames_total " << m_droppedFrames.load(std::memory_order_relaxed) << "\n";
+
+	out << "# HELP tetris_input_queue_depth Moves waiting at the start of the last tick.\n# TYPE tetris_input_queue_depth gauge\n";
+	out << "tetris_input_queue_depth " << m_inputQueueDepth.load(std::memory_order_relaxed) << "\n";
+	out << "# HELP tetris_input_queue_depth_max Most moves waiting at the start of a tick this session.\n# TYPE tetris_input_queue_depth_max gauge\n";
+	out << "tetris_input_queue_depth_max " << m_maxInputQueueDepth.load(std::memory_order_relaxed) << "\n";
+
+	const EventBus* const eventBus = m_eventBus.load(std::memory_order_relaxed);
+	if (eventBus != nullptr)
+	{
+		out << "# HELP tetris_events_dropped_total Gameplay events dropped because a subscriber fell behind, since the game started.\n# TYPE tetris_events_dropped_total counter\n";
+		out << "tetris_events_dropped_total " << eventBus->getDroppedEvents() << "\n";
+	}
+	return out.str();
+}
+
+/// <summary>
+/// The exporter thread. Counts the game's events as they come in, rewrites the metrics file every flush interval,
+/// and once more when shutting down.
+/// </summary>
+void Telemetry::exporter()
+{
+	const std::chrono::microseconds flushInterval(m_flushInterval.asMicroseconds());
+	auto lastFlush = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_stopping)
+	{
+		m_wake.wait_for(lock, eventInterval, [this]() { return m_stopping; });
+		const bool stopping = m_stopping;
+		lock.unlock();
+		readEvents();
+		if (stopping || std::chrono::steady_clock::now() - lastFlush >= flushInterval)
+		{
+			flush();
+			lastFlush = std::chrono::steady_clock::now();
+		}
+		lock.lock();
+	}
+}
+
+/// <summary>
+/// Updates the gameplay counters from the events that arrived since the last time
+/// </summary>
+void Telemetry::readEvents()
+{
+	EventBus::Queue* const events = m_events.load(std::memory_order_acquire);
+	if (events == nullptr) return;
+
+	GameEvent event;
+	while (events->pop(event))
+	{
+		switch (event.type)
+		{
+		case GameEvent::Type::NewGame:
+			startSession(event.value);
+			break;
+		case GameEvent::Type::Lock:
+			piecePlaced(event.player);
+			break;
+		case GameEvent::Type::LineClear:
+			linesCleared(event.value);
+			break;
+		case GameEvent::Type::LevelUp:
+			levelChanged(event.value, sf::microseconds(event.tick * microsecondsPerTick));
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/// <summary>
+/// Writes the metrics to a temporary file and renames it over the old one, so a collector never reads a half-written file
+/// </summary>
+void Telemetry::flush()
+{
+	std::filesystem::path tempPath = m_file;
+	tempPath += ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::trunc);
+		file << exportText();
+		if (!file.good())
+		{
+			std::cerr << "Error writing metrics to " << tempPath << std::endl;
+			return;
+		}
+	}
+	std::error_code error;
+	std::filesystem::rename(tempPath, m_file, error);
+}
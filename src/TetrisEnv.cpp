@@ -0,0 +1,89 @@
+#include "../Headers/TetrisEnv.h"
+#include "../Headers/EnvironmentBatch.hpp"
+
+#include <iostream>
+
+/**
+* The C API of libtetris_env, see TetrisEnv.h. Every function forwards to the EnvironmentBatch behind the handle.
+*/
+
+struct TetrisEnv
+{
+	explicit TetrisEnv(const TetrisEnvConfig& config) : batch(config) {}
+
+	EnvironmentBatch batch;
+};
+
+namespace
+{
+	const TetrisEnvBuffers noBuffers{};
+
+	const TetrisEnvBuffers& orNoBuffers(const TetrisEnvBuffers* const buffers)
+	{
+		return buffers != nullptr ? *buffers : noBuffers;
+	}
+}
+
+uint32_t tetris_env_api_version(void)
+{
+	return TETRIS_ENV_API_VERSION;
+}
+
+TetrisEnv* tetris_env_create(const TetrisEnvConfig* config)
+{
+	if (config == nullptr || !EnvironmentBatch::isValid(*config)) return nullptr;
+	//No exception may cross the C API, a batch that can't get its memory or threads is reported like an invalid config
+	try
+	{
+		return new TetrisEnv(*config);
+	}
+	catch (const std::exception& exception)
+	{
+		std::cerr << "Could not create the tetris_env batch: " << exception.what() << std::endl;
+	}
+	catch (...)
+	{
+		std::cerr << "Could not create the tetris_env batch" << std::endl;
+	}
+	return nullptr;
+}
+
+void tetris_env_destroy(TetrisEnv* env)
+{
+	delete env;
+}
+
+uint32_t tetris_env_count(const TetrisEnv* env)
+{
+	return env->batch.getCount();
+}
+
+uint8_t tetris_env_players(const TetrisEnv* env)
+{
+	return env->batch.getPlayers();
+}
+
+uint8_t tetris_env_board_width(const TetrisEnv* env)
+{
+	return env->batch.getBoardWidth();
+}
+
+uint8_t tetris_env_board_height(const TetrisEnv* env)
+{
+	return env->batch.getBoardHeight();
+}
+
+void tetris_env_reset(TetrisEnv* env, uint32_t seed, const TetrisEnvBuffers* buffers)
+{
+	env->batch.reset(seed, orNoBuffers(buffers));
+}
+
+void tetris_env_reset_one(TetrisEnv* env, uint32_t index, uint32_t seed, const TetrisEnvBuffers* buffers)
+{
+	env->batch.resetOne(index, seed, orNoBuffers(buffers));
+}
+
+void tetris_env_step(TetrisEnv* env, const uint8_t* actions, const TetrisEnvBuffers* buffers)
+{
+	env->batch.step(actions, orNoBuffers(buffers));
+}
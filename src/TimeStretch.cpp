@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "../Headers/TimeStretch.hpp"
+
+/// <summary>
+/// Allocates the buffers for a channel count and starts from the beginning of the stream
+/// </summary>
+/// <param name="channelCount">How many interleaved channels every frame has</param>
+void TimeStretch::initialize(const u32 channelCount)
+{
+	m_channelCount = channelCount;
+	m_input.assign(static_cast<size_t>(capacityFrames) * channelCount, 0.0f);
+	m_mono.assign(capacityFrames, 0.0f);
+	m_overlap.assign(static_cast<size_t>(hopFrames) * channelCount, 0.0f);
+
+	constexpr double pi = 3.14159265358979323846;
+	for (u32 i = 0; i < windowFrames; ++i)
+	{ //A periodic Hann window, so two windows a hop apart always add up to exactly 1
+		m_window[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / windowFrames));
+	}
+	reset();
+}
+
+/// <summary>
+/// Forgets all input and output, for seeking
+/// </summary>
+void TimeStretch::reset()
+{
+	std::fill(m_overlap.begin(), m_overlap.end(), 0.0f);
+	m_inputStart = 0;
+	m_inputFrames = 0;
+	m_position = 0;
+	m_previous = 0;
+	m_started = false;
+}
+
+/// <summary>
+/// How many frames write() can take right now. Input that process() no longer needs is dropped to make room first.
+/// </summary>
+const u32 TimeStretch::getFreeFrames() const
+{
+	return capacityFrames - m_inputFrames + getDroppableFrames();
+}
+
+/// <summary>
+/// How many frames at the front of the input are before anything the next segment search could read
+/// </summary>
+const u32 TimeStretch::getDroppableFrames() const
+{
+	const s64 needed = m_started ? std::min<s64>(std::llround(m_position) - searchFrames, m_previous + hopFrames) : m_inputStart;
+	return static_cast<u32>(std::clamp<s64>(needed - m_inputStart, 0, m_inputFrames));
+}
+
+/// <summary>
+/// Appends interleaved frames to the input. Never write more than getFreeFrames() at once.
+/// </summary>
+void TimeStretch::write(const float* const frames, const u32 frameCount)
+{
+	if (m_inputFrames + frameCount > capacityFrames) compact();
+	const u32 count = std::min(frameCount, capacityFrames - m_inputFrames);
+
+	float* const input = m_input.data() + static_cast<size_t>(m_inputFrames) * m_channelCount;
+	std::memcpy(input, frames, sizeof(float) * count * m_channelCount);
+	for (u32 frame = 0; frame < count; ++frame)
+	{
+		float sum = 0.0f;
+		for (u32 channel = 0; channel < m_channelCount; ++channel)
+			sum += frames[frame * m_channelCount + channel];
+		m_mono[m_inputFrames + frame] = sum;
+	}
+	m_inputFrames += count;
+}
+
+/// <summary>
+/// Produces the next hop of output if enough input has been written for it
+/// </summary>
+/// <param name="output">Where to write hopFrames interleaved frames</param>
+/// <param name="tempo">How fast to play, 2 plays twice as fast. Clamped between minTempo and maxTempo.</param>
+/// <returns>Returns false without writing anything if more input is needed first</returns>
+bool TimeStretch::process(float* const output, const float tempo)
+{
+	const s64 ideal = std::llround(m_position);
+	const s64 continuation = m_previous + hopFrames; //Where the last segment would naturally have carried on
+	const s64 inputEnd = m_inputStart + m_inputFrames;
+	if (ideal + searchFrames + windowFrames > inputEnd || continuation + hopFrames > inputEnd) return false;
+
+	const s64 segment = m_started ? findBestSegment(ideal, continuation) : ideal;
+	const float* const input = m_input.data() + static_cast<size_t>(segment - m_inputStart) * m_channelCount;
+	for (u32 frame = 0; frame < hopFrames; ++frame)
+	{
+		for (u32 channel = 0; channel < m_channelCount; ++channel)
+		{
+			const size_t sample = static_cast<size_t>(frame) * m_channelCount + channel;
+			output[sample] = m_overlap[sample] + input[sample] * m_window[frame];
+			m_overlap[sample] = input[sample + static_cast<size_t>(hopFrames) * m_channelCount] * m_window[frame + hopFrames];
+		}
+	}
+
+	m_previous = segment;
+	m_started = true;
+	m_position += hopFrames * static_cast<double>(std::clamp(tempo, minTempo, maxTempo));
+	return true;
+}
+
+/// <summary>
+/// Finds the segment near the ideal position whose start looks most like the natural continuation of the last segment.
+/// Searches coarsely over the whole tolerance first, then every position around the best coarse match.
+/// </summary>
+const s64 TimeStretch::findBestSegment(const s64 ideal, const s64 continuation) const
+{
+	const s64 first = std::max<s64>(ideal - searchFrames, m_inputStart);
+	const s64 last = ideal + searchFrames;
+
+	s64 best = first;
+	float bestSimilarity = std::numeric_limits<float>::lowest();
+	for (s64 candidate = first; candidate <= last; candidate += coarseStep)
+	{
+		const float similarity = getSimilarity(candidate, continuation, coarseStride);
+		if (similarity > bestSimilarity)
+		{
+			bestSimilarity = similarity;
+			best = candidate;
+		}
+	}
+
+	const s64 coarseBest = best;
+	bestSimilarity = std::numeric_limits<float>::lowest();
+	for (s64 candidate = std::max(coarseBest - coarseStep + 1, first); candidate <= std::min(coarseBest + coarseStep - 1, last); ++candidate)
+	{
+		const float similarity = getSimilarity(candidate, continuation, 1);
+		if (similarity > bestSimilarity)
+		{
+			bestSimilarity = similarity;
+			best = candidate;
+		}
+	}
+	return best;
+}
+
+/// <summary>
+/// Normalized cross-correlation between the overlapping half of a candidate segment and the natural continuation
+/// </summary>
+const float TimeStretch::getSimilarity(const s64 candidate, const s64 continuation, const u32 stride) const
+{
+	const float* const a = m_mono.data() + (candidate - m_inputStart);
+	const float* const b = m_mono.data() + (continuation - m_inputStart);
+	float correlation = 0.0f, energy = 0.0f;
+	for (u32 frame = 0; frame < hopFrames; frame += stride)
+	{
+		correlation += a[frame] * b[frame];
+		energy += a[frame] * a[frame];
+	}
+	return correlation / std::sqrt(energy + 1e-9f);
+}
+
+/// <summary>
+/// Moves the input that is still needed to the front of the buffers
+/// </summary>
+void TimeStretch::compact()
+{
+	const u32 dropped = getDroppableFrames();
+	if (dropped == 0) return;
+
+	const u32 kept = m_inputFrames - dropped;
+	std::memmove(m_input.data(), m_input.data() + static_cast<size_t>(dropped) * m_channelCount, sizeof(float) * kept * m_channelCount);
+	std::memmove(m_mono.data(), m_mono.data() + dropped, sizeof(float) * kept);
+	m_inputStart += dropped;
+	m_inputFrames = kept;
+}
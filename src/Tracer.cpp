@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "../Headers/Tracer.hpp"
+
+std::atomic<bool> Tracer::m_enabled = false;
+std::chrono::steady_clock::time_point Tracer::m_start;
+std::filesystem::path Tracer::m_file;
+std::mutex Tracer::m_mutex;
+std::vector<std::unique_ptr<Tracer::ThreadBuffer>> Tracer::m_buffers;
+thread_local Tracer::ThreadBuffer* Tracer::t_buffer = nullptr;
+
+/// <summary>
+/// Turns tracing on. Call it before starting the threads being traced.
+/// </summary>
+/// <param name="file">The Chrome trace JSON file that flush() writes to</param>
+void Tracer::start(const std::filesystem::path& file)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_file = file;
+		m_start = std::chrono::steady_clock::now();
+	}
+	m_enabled.store(true, std::memory_order_release);
+}
+
+/// <summary>
+/// Turns tracing off and writes everything that was recorded. Safe to call when tracing was never started.
+/// </summary>
+void Tracer::stop()
+{
+	if (!m_enabled.exchange(false, std::memory_order_acq_rel)) return;
+	flush();
+}
+
+/// <summary>
+/// Writes the newest events of every thread to the trace file, replacing what was written before. The events are copied without
+/// stopping the threads that are recording them, and any event that was overwritten while it was being copied is left out.
+/// </summary>
+/// <returns>Returns false if the file couldn't be written</returns>
+bool Tracer::flush()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_file.empty()) return false;
+
+	if (m_file.has_parent_path())
+	{
+		std::error_code error;
+		std::filesystem::create_directories(m_file.parent_path(), error);
+	}
+	std::ofstream file(m_file, std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cerr << "Error writing trace file " << m_file << std::endl;
+		return false;
+	}
+
+	struct Copy
+	{
+		const char* name;
+		u64 timestamp;
+		s64 arg;
+		char phase;
+	};
+	std::vector<Copy> events;
+	events.reserve(eventsPerThread);
+
+	file << "{\"traceEvents\":[\n";
+	file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Tetris\"}}";
+	file << std::fixed << std::setprecision(3);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : m_buffers)
+	{
+		const char* const threadName = buffer->name.load(std::memory_order_relaxed);
+		if (threadName != nullptr)
+		{
+			file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":\"" << threadName << "\"}}";
+		}
+
+		const u64 head = buffer->head.load(std::memory_order_acquire);
+		const u64 first = head > eventsPerThread ? head - eventsPerThread : 0;
+		events.clear();
+		for (u64 index = first; index < head; ++index)
+		{
+			const Event& event = buffer->events[index % eventsPerThread];
+			events.push_back(Copy{ event.name.load(std::memory_order_relaxed), event.timestamp.load(std::memory_order_relaxed),
+				event.arg.load(std::memory_order_relaxed), event.phase.load(std::memory_order_relaxed) });
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		//The thread may have lapped the copy. The slot of the event being written now, and every slot before it that was rewritten, can't be trusted
+		const u64 writing = buffer->head.load(std::memory_order_relaxed);
+		const u64 firstIntact = writing >= eventsPerThread ? writing - eventsPerThread + 1 : 0;
+		for (u64 index = std::max(first, firstIntact); index < head; ++index)
+		{
+			const Copy& event = events[index - first];
+			file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << event.timestamp / 1000.0
+				<< ",\"pid\":1,\"tid\":" << buffer->threadId;
+			if (event.phase == 'i') file << ",\"s\":\"t\"";
+			if (event.arg != noArg) file << ",\"args\":{\"value\":" << event.arg << "}";
+			file << "}";
+		}
+	}
+	file << "\n]}\n";
+	file.flush();
+	if (!file.good())
+	{
+		std::cerr << "Error writing trace file " << m_file << std::endl;
+		return false;
+	}
+	std::cout << "Trace written to " << m_file << std::endl;
+	return true;
+}
+
+/// <summary>
+/// Records the start of a span on the calling thread
+/// </summary>
+/// <param name="name">The span's name</param>
+/// <param name="arg">An optional value shown with the span, e.g. the player it is for</param>
+void Tracer::begin(const char* const name, const s64 arg)
+{
+	if (isEnabled()) record('B', name, arg);
+}
+
+/// <summary>
+/// Records the end of the calling thread's most recent span
+/// </summary>
+/// <param name="name">The span's name</param>
+void Tracer::end(const char* const name)
+{
+	if (isEnabled()) record('E', name, noArg);
+}
+
+/// <summary>
+/// Records something that happened at a single point in time on the calling thread
+/// </summary>
+/// <param name="name">The event's name</param>
+/// <param name="arg">An optional value shown with the event</param>
+void Tracer::instant(const char* const name, const s64 arg)
+{
+	if (isEnabled()) record('i', name, arg);
+}
+
+/// <summary>
+/// Names the calling thread in the trace
+/// </summary>
+/// <param name="name">The thread's name</param>
+void Tracer::setThreadName(const char* const name)
+{
+	if (isEnabled()) getThreadBuffer()->name.store(name, std::memory_order_relaxed);
+}
+
+/// <summary>
+/// Writes an event into the calling thread's ring buffer, overwriting its oldest event once the buffer is full.
+/// A seqlock style write: the release fence orders the head of the previous event before the new event's fields,
+/// so flush() can tell when it has read a slot that was being rewritten.
+/// </summary>
+void Tracer::record(const char phase, const char* const name, const s64 arg)
+{
+	const u64 timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+	ThreadBuffer* const buffer = getThreadBuffer();
+	const u64 index = buffer->head.load(std::memory_order_relaxed);
+	Event& event = buffer->events[index % eventsPerThread];
+
+	std::atomic_thread_fence(std::memory_order_release);
+	event.name.store(name, std::memory_order_relaxed);
+	event.timestamp.store(timestamp, std::memory_order_relaxed);
+	event.arg.store(arg, std::memory_order_relaxed);
+	event.phase.store(phase, std::memory_order_relaxed);
+	buffer->head.store(index + 1, std::memory_order_release);
+}
+
+/// <summary>
+/// Gets the calling thread's ring buffer, creating it the first time the thread records an event.
+/// Buffers are kept until the program exits, so the events of threads that have finished can still be written.
+/// </summary>
+Tracer::ThreadBuffer* Tracer::getThreadBuffer()
+{
+	if (t_buffer == nullptr)
+	{
+		std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+		std::lock_guard<std::mutex> lock(m_mutex);
+		buffer->threadId = static_cast<u32>(m_buffers.size() + 1);
+		t_buffer = buffer.get();
+		m_buffers.push_back(std::move(buffer));
+	}
+	return t_buffer;
+}
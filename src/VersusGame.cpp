@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <array>
+
+#include "../Headers/VersusGame.hpp"
+
+/// <summary>
+/// Sets up one board and one game per player and starts the worker threads that simulate them
+/// </summary>
+/// <param name="numPlayers">How many players are competing</param>
+/// <param name="gameWidth">The width of every player's board</param>
+/// <param name="gameHeight">The playable height of every player's board</param>
+/// <param name="boardHeight">The height of every player's board, including the rows above the playing field</param>
+/// <param name="panelWidth">The width of one player's part of the window, laid out for the reference piece size</param>
+/// <param name="panelHeight">The height of the window, laid out for the reference piece size</param>
+/// <param name="seed">The seed every player's pieces and the garbage holes are generated from</param>
+VersusGame::VersusGame(const u8 numPlayers, const u8 gameWidth, const u8 gameHeight, const u8 boardHeight, const u16 panelWidth, const u16 panelHeight,
+	Renderer* const renderer, InputController* const inputController, MusicController* const musicController, PieceState* const pieceState, const u32 seed) :
+	m_numPlayers(numPlayers), m_gameWidth(gameWidth), m_gameHeight(gameHeight), m_boardHeight(boardHeight), m_panelWidth(panelWidth), m_panelHeight(panelHeight),
+	m_renderer(renderer), m_inputController(inputController), m_musicController(musicController), m_pieceState(pieceState),
+	m_tickStart(numPlayers + 1), m_tickDone(numPlayers + 1)
+{
+	setUp(seed);
+	startWorkers();
+}
+
+/// <summary>
+/// Stops the render thread and the workers before the games they use are destroyed
+/// </summary>
+VersusGame::~VersusGame()
+{
+	stopRenderThread();
+	stopWorkers();
+}
+
+/// <summary>
+/// Starts the match. The calling thread polls input and runs the simulation while a separate thread renders it.
+/// Returns once the window has been closed, or the players have gone back to the menu after the match. The window is left open in that case.
+/// </summary>
+void VersusGame::run()
+{
+	Tracer::setThreadName("versus");
+	startRenderThread();
+	if (m_musicController != nullptr) m_musicController->startMusic();
+	loop();
+
+	stopRenderThread();
+	if (m_musicController != nullptr) m_musicController->stopMusic();
+}
+
+/// <summary>
+/// Creates every player's board, pieces and game. Every player draws from the same seed so nobody gets luckier pieces.
+/// </summary>
+/// <param name="seed">The seed for the pieces and the garbage holes</param>
+void VersusGame::setUp(const u32 seed)
+{
+	m_players.clear();
+	m_players.resize(m_numPlayers);
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		Player& player = m_players[playerIndex];
+		player.board = std::make_unique<Board>(m_gameWidth, m_boardHeight);
+		player.blocks = std::make_unique<Blocks>(seed);
+		player.game = std::make_unique<Game>(1, m_gameWidth, m_gameHeight, sideBuffer, verticalBuffer, m_panelWidth, m_panelHeight,
+			m_renderer, player.board.get(), nullptr, nullptr, m_pieceState, player.blocks.get());
+		player.game->setPlayerColor(0, Game::getPlayerColor(playerIndex));
+	}
+	m_garbageGenerator.seed(seed);
+	m_tick = 0;
+	m_gameOver = false;
+	m_winner = noWinner;
+}
+
+void VersusGame::startWorkers()
+{
+	m_stopWorkers = false;
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		m_workers.emplace_back(&VersusGame::worker, this, playerIndex);
+	}
+}
+
+/// <summary>
+/// Releases the workers from the tick barrier with the stop flag set and waits for them to exit. Safe to call more than once.
+/// </summary>
+void VersusGame::stopWorkers()
+{
+	if (m_workers.empty()) return;
+
+	m_stopWorkers = true;
+	m_tickStart.arrive_and_wait();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+}
+
+/// <summary>
+/// Simulates one player's board. Waits for every tick to start, ticks the game and publishes its snapshot, then waits for the other boards.
+/// The barriers also order every access to the game between the worker and the thread calling tick.
+/// </summary>
+/// <param name="playerIndex">The player whose board this worker simulates</param>
+void VersusGame::worker(const u8 playerIndex)
+{
+	Tracer::setThreadName("player");
+	while (true)
+	{
+		m_tickStart.arrive_and_wait();
+		if (m_stopWorkers) return;
+
+		Game& game = *m_players[playerIndex].game;
+		if (!game.isGameOver())
+		{
+			game.tick();
+			game.publishSnapshot();
+		}
+		m_tickDone.arrive_and_wait();
+	}
+}
+
+/// <summary>
+/// Queues a move for the next tick on the board of the player who made it
+/// </summary>
+/// <param name="move">The move and the player who made it</param>
+void VersusGame::queueMove(const PlayerMove move)
+{
+	if (move.player >= m_numPlayers || m_gameOver) return;
+	m_players[move.player].game->queueMove(PlayerMove{ move.move, 0 });
+}
+
+/// <summary>
+/// Advances every board by one tick in parallel, then exchanges the garbage sent during the tick
+/// </summary>
+void VersusGame::tick()
+{
+	if (m_gameOver) return;
+
+	m_tickStart.arrive_and_wait();
+	m_tickDone.arrive_and_wait();
+	exchangeGarbage();
+	updateWinner();
+	updateMusic();
+	++m_tick;
+}
+
+/// <summary>
+/// How many garbage rows clearing lines at once sends: nothing for a single, one row for a double, two for a triple and four for a Tetris
+/// </summary>
+/// <param name="linesCleared">How many lines were cleared at once</param>
+/// <returns></returns>
+const u8 VersusGame::getAttack(const u32 linesCleared)
+{
+	constexpr u8 attacks[] = { 0, 0, 1, 2, 4 };
+	return attacks[std::min<u32>(linesCleared, std::size(attacks) - 1)];
+}
+
+/// <summary>
+/// Sends garbage from every player who cleared lines this tick to the next player still in the game.
+/// All attacks are worked out before any garbage is added, and added in player order, so the result never depends on thread timing.
+/// </summary>
+void VersusGame::exchangeGarbage()
+{
+	std::array<u8, maxPlayers> incoming{};
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		Player& player = m_players[playerIndex];
+		const u32 lines = player.game->getLines();
+		const u8 attack = getAttack(lines - player.lines);
+		player.lines = lines;
+		if (attack == 0 || player.game->isGameOver()) continue;
+
+		for (u8 step = 1; step < m_numPlayers; ++step)
+		{
+			const u8 target = (playerIndex + step) % m_numPlayers;
+			if (!m_players[target].game->isGameOver())
+			{
+				incoming[target] += attack;
+				break;
+			}
+		}
+	}
+
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		if (incoming[playerIndex] == 0) continue;
+
+		Game& game = *m_players[playerIndex].game;
+		game.addGarbage(incoming[playerIndex], static_cast<u8>(m_garbageGenerator() % m_gameWidth));
+		game.publishSnapshot();
+	}
+}
+
+/// <summary>
+/// Plays the music for the player in the most trouble. The highest level sets the tempo, and the highest stack decides on the danger theme.
+/// </summary>
+void VersusGame::updateMusic()
+{
+	if (m_musicController == nullptr) return;
+
+	u8 level = 0, stackHeight = 0;
+	for (const Player& player : m_players)
+	{
+		if (player.game->isGameOver()) continue;
+		level = std::max(level, player.game->getLevel());
+		stackHeight = std::max(stackHeight, player.board->getStackHeight());
+	}
+	m_musicController->update(level, stackHeight, m_players.front().board->getBoardHeight());
+}
+
+/// <summary>
+/// Ends the match once one player or fewer is left
+/// </summary>
+void VersusGame::updateWinner()
+{
+	u8 playersLeft = 0, lastPlayer = noWinner;
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		if (!m_players[playerIndex].game->isGameOver())
+		{
+			++playersLeft;
+			lastPlayer = playerIndex;
+		}
+	}
+	if (playersLeft > 1 || (playersLeft == 1 && m_numPlayers == 1)) return;
+
+	m_winner = lastPlayer; //No winner if the last players topped out on the same tick
+	m_gameOver = true;
+	if (m_musicController != nullptr) m_musicController->stopMusic();
+}
+
+const bool VersusGame::isGameOver() const
+{
+	return m_gameOver;
+}
+
+/// <summary>
+/// The player who won the match
+/// </summary>
+/// <returns>The winner's index, or noWinner if the match isn't over or ended in a draw</returns>
+const u8 VersusGame::getWinner() const
+{
+	return m_winner;
+}
+
+const u32 VersusGame::getTick() const
+{
+	return m_tick;
+}
+
+/// <summary>
+/// A hash of every player's game state. Two matches with the same hash on the same tick play out the same way given the same moves.
+/// </summary>
+/// <returns></returns>
+const u64 VersusGame::getStateHash() const
+{
+	u64 hash = 14695981039346656037ull; //FNV-1a over the hash of every board
+	for (const Player& player : m_players)
+	{
+		hash ^= player.game->getStateHash();
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+const Game& VersusGame::getGame(const u8 playerIndex) const
+{
+	return *m_players[playerIndex].game;
+}
+
+/// <summary>
+/// The main loop. Advances the match at a fixed tick rate, independent of how fast the render thread can draw.
+/// </summary>
+void VersusGame::loop()
+{
+	sf::Clock clock;
+	sf::Time accumulator = sf::Time::Zero;
+	while (!m_quit && m_renderer->isWindowOpen())
+	{
+		input();
+		accumulator += clock.restart();
+		while (accumulator >= m_timePerTick && !m_quit)
+		{
+			tick();
+			accumulator -= m_timePerTick;
+		}
+		if (m_gameOver) accumulator = sf::Time::Zero;
+		sf::sleep(m_timePerTick - accumulator);
+	}
+}
+
+/// <summary>
+/// Handles window input. Moves are routed to the board of the player who made them.
+/// </summary>
+void VersusGame::input()
+{
+	PlayerMove pm = m_inputController->input(m_gameOver);
+
+	switch (pm.move)
+	{
+	case Move::Quit:
+		m_quit = true;
+		stopRenderThread();
+		m_renderer->closeWindow();
+		break;
+
+	case Move::PlayAgain:
+		restart();
+		break;
+
+	case Move::ReturnToMenu:
+		m_quit = true; //Leaves the window open for the menu
+		break;
+
+	case Move::SaveTrace:
+		Tracer::flush();
+		break;
+
+	case Move::None:
+		break;
+
+	default:
+		queueMove(pm);
+		break;
+	}
+}
+
+/// <summary>
+/// Starts a new match with a new seed by resetting every game in place. The workers are waiting for the next tick and the render thread
+/// only reads published snapshots, so neither has to be stopped, and nothing is reallocated.
+/// </summary>
+void VersusGame::restart()
+{
+	const u32 seed = std::random_device()();
+	for (Player& player : m_players)
+	{
+		player.game->restart(seed);
+		player.lines = 0;
+	}
+	m_garbageGenerator.seed(seed);
+	m_tick = 0;
+	m_winner = noWinner;
+	m_gameOver = false;
+	if (m_musicController != nullptr) m_musicController->startMusic();
+}
+
+/// <summary>
+/// The render thread. Draws the newest published snapshot of every board as often as the window allows, until the match stops it.
+/// </summary>
+void VersusGame::renderLoop()
+{
+	m_renderer->setActive(true);
+	Tracer::setThreadName("render");
+	while (m_rendering.load(std::memory_order_acquire))
+	{
+		render();
+	}
+	m_renderer->setActive(false);
+}
+
+/// <summary>
+/// Publishes the starting state of every board and hands the window's context to a new render thread
+/// </summary>
+void VersusGame::startRenderThread()
+{
+	for (Player& player : m_players)
+	{
+		player.game->publishSnapshot();
+	}
+	m_renderer->setActive(false);
+	m_rendering = true;
+	m_renderThread = std::thread(&VersusGame::renderLoop, this);
+}
+
+/// <summary>
+/// Stops the render thread and gives the window's context back to the calling thread. Safe to call more than once.
+/// </summary>
+void VersusGame::stopRenderThread()
+{
+	m_rendering.store(false, std::memory_order_release);
+	if (m_renderThread.joinable())
+	{
+		m_renderThread.join();
+		m_renderer->setActive(true);
+	}
+}
+
+/// <summary>
+/// Draws every board side by side, and the result once the match is over
+/// </summary>
+void VersusGame::render()
+{
+	const Tracer::Scope traceScope("renderGame");
+	const u16 panelCells = sideBuffer * 2 + m_gameWidth;
+	m_renderer->clearRenderer();
+	for (u8 playerIndex = 0; playerIndex < m_numPlayers; ++playerIndex)
+	{
+		m_renderer->setBoardOffset(playerIndex * panelCells);
+		m_players[playerIndex].game->drawLatestSnapshot();
+	}
+
+	if (m_gameOver)
+	{
+		const u8 winner = m_winner;
+		m_renderer->setBoardOffset(winner != noWinner ? winner * panelCells : 0);
+		m_renderer->drawText(m_panelWidth / 2 - 60, m_panelHeight / 2, winner != noWinner ? "Winner!" : "Draw!");
+	}
+	m_renderer->setBoardOffset(0);
+	const Tracer::Scope showScope("showRenderer");
+	m_renderer->showRenderer();
+}
@@ -0,0 +1,144 @@
+#include <filesystem>
+#include <iostream>
+#include "../Headers/Globals.hpp"
+#include "../Headers/WindowRenderer.hpp"
+#include "../Headers/ParticleSystem.hpp"
+
+/// <summary>
+/// Initializes the window pointer, and loads the font and sets up the shapes that are reused for every frame
+/// </summary>
+/// <param name="window">A pointer to the main window</param>
+WindowRenderer::WindowRenderer(const u8 pieceSize, sf::RenderWindow* const window) : Renderer(pieceSize), m_window(window)
+{
+	m_fontLoaded = m_font.loadFromFile("./tetris-font.ttf");
+	if (!m_fontLoaded)
+	{
+		std::cout << "Error Loading Font" << std::endl;
+	}
+	m_text.setFont(m_font);
+	m_text.setFillColor(sf::Color::Cyan);
+	m_text.setStyle(sf::Text::Bold);
+	m_rect.setOutlineThickness(1);
+	m_particleVertices.resize(ParticleSystem::capacity * 4);
+	setPieceSize(pieceSize);
+}
+
+/// <summary>
+/// Returns the state of the window
+/// </summary>
+/// <returns></returns>
+const bool WindowRenderer::isWindowOpen()
+{
+	return m_window->isOpen();
+}
+
+/// <summary>
+/// Activates or deactivates the window's OpenGL context on the calling thread.
+/// The context has to be released by one thread before another thread can draw to the window.
+/// </summary>
+/// <param name="active">Whether the calling thread should own the context</param>
+void WindowRenderer::setActive(const bool active)
+{
+	m_window->setActive(active);
+}
+
+/// <summary>
+/// Closes the window. Must only be called once no other thread is drawing to it.
+/// </summary>
+void WindowRenderer::closeWindow()
+{
+	m_window->close();
+}
+
+/// <summary>
+/// Clears the renderer
+/// </summary>
+void WindowRenderer::clearRenderer()
+{
+	m_window->clear();
+}
+
+/// <summary>
+/// Displays the renderer
+/// </summary>
+void WindowRenderer::showRenderer()
+{
+	m_window->display();
+}
+
+/// <summary>
+/// Changes the size everything is drawn at, and resizes the shared piece shape and text to match
+/// </summary>
+/// <param name="pieceSize">The width and height of one board cell, in pixels</param>
+void WindowRenderer::setPieceSize(const u8 pieceSize)
+{
+	Renderer::setPieceSize(pieceSize);
+	m_text.setCharacterSize(static_cast<unsigned>(24 * getTextScale()));
+	m_rect.setSize(sf::Vector2f(m_pieceSize, m_pieceSize));
+}
+
+/// <summary>
+/// Draws the current piece depending on its position
+/// </summary>
+/// <param name="x">The x position of the piece, in board cells</param>
+/// <param name="y">The y position of the piece, in board cells. Can be fractional for interpolated falling pieces</param>
+/// <param name="fill">The fill color of the piece</param>
+/// <param name="outline">The outline color of the piece</param>
+void WindowRenderer::drawPiece(const float x, const float y, const sf::Color fill, const sf::Color outline)
+{
+	m_rect.setFillColor(fill);
+	m_rect.setOutlineColor(outline);
+	m_rect.setPosition(getPieceX(x), getPieceY(y));
+
+	m_window->draw(m_rect);
+}
+
+/// <summary>
+/// Draws the text to the board using the specified font
+/// </summary>
+/// <param name="x">The x position of the text</param>
+/// <param name="y">The y position of the text</param>
+/// <param name="strToDisplay">The text to display</param>
+void WindowRenderer::drawText(const u16 x, const u16 y, const std::string_view strToDisplay)
+{
+	if (!m_fontLoaded) return;
+
+	m_string.clear();
+	for (const char character : strToDisplay)
+	{
+		m_string += static_cast<sf::Uint32>(static_cast<unsigned char>(character));
+	}
+	m_text.setString(m_string);
+	m_text.setPosition(getTextX(x), getTextY(y));
+
+	m_window->draw(m_text);
+}
+
+/// <summary>
+/// Draws every live particle as a square, batched into a single draw call
+/// </summary>
+/// <param name="particles">The particles to draw</param>
+void WindowRenderer::drawParticles(const ParticleSystem& particles)
+{
+	const u32 count = particles.getCount();
+	if (count == 0) return;
+
+	const float* const x = particles.getX();
+	const float* const y = particles.getY();
+	const float* const sizes = particles.getSizes();
+	const sf::Color* const colors = particles.getColors();
+	const u8* const alphas = particles.getAlphas();
+	for (u32 i = 0; i < count; ++i)
+	{
+		const float halfSize = sizes[i] * m_pieceSize * 0.5f;
+		const float centerX = getPieceX(x[i]), centerY = getPieceY(y[i]);
+		const sf::Color color(colors[i].r, colors[i].g, colors[i].b, alphas[i]);
+
+		sf::Vertex* const quad = &m_particleVertices[i * 4];
+		quad[0] = sf::Vertex(sf::Vector2f(centerX - halfSize, centerY - halfSize), color);
+		quad[1] = sf::Vertex(sf::Vector2f(centerX + halfSize, centerY - halfSize), color);
+		quad[2] = sf::Vertex(sf::Vector2f(centerX + halfSize, centerY + halfSize), color);
+		quad[3] = sf::Vertex(sf::Vector2f(centerX - halfSize, centerY + halfSize), color);
+	}
+	m_window->draw(m_particleVertices.data(), count * 4, sf::Quads);
+}
@@ -1,6 +1,45 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
 #include "../MainMenu/Headers/MainMenu.hpp"
+#include "../Headers/Tracer.hpp"
+
+/// <summary>
+/// Starts the game. Passing --trace [file] records a Chrome trace of the game loop, written on exit or when F9 is pressed.
+/// Passing --bot {player} {command} hands that player over to a bot engine in co-op games (see BotPlayer.hpp).
+/// Passing --hints [lines] shows how to clear the whole board within that many lines (4 by default) in single player games.
+/// Passing --player-windows opens a window per player in co-op games, and --spectator-window one more showing everything.
+/// </summary>
+int main(int argc, char** argv) {
+	std::array<std::string, maxPlayers> botCommands;
+	u8 hintLines = 0;
+	DisplayWindowSettings displayWindows;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--hints") == 0)
+		{
+			const bool hasLines = i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0;
+			hintLines = static_cast<u8>(std::clamp(hasLines ? std::atoi(argv[++i]) : 4, 1, static_cast<int>(PerfectClearSolver::maxLines)));
+		}
+		if (std::strcmp(argv[i], "--player-windows") == 0) displayWindows.perPlayer = true;
+		if (std::strcmp(argv[i], "--spectator-window") == 0) displayWindows.spectator = true;
+		if (std::strcmp(argv[i], "--bot") == 0 && i + 2 < argc)
+		{
+			const int player = std::atoi(argv[++i]);
+			if (player >= 1 && player <= maxPlayers) botCommands[player - 1] = argv[i + 1];
+			++i;
+		}
+		if (std::strcmp(argv[i], "--trace") == 0)
+		{
+			const bool hasFile = i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0;
+			Tracer::start(std::filesystem::current_path() / (hasFile ? argv[++i] : "trace.json"));
+		}
+	}
 
-int main() {
-	MainMenu mainMenu;
+	MainMenu mainMenu(botCommands, hintLines, displayWindows);
+	Tracer::stop();
 	return 0;
-}
\ No newline at end of file
+}